@@ -0,0 +1,123 @@
+﻿using System;
+using Microsoft.Xna.Framework;
+using JPLOPS.Imaging;
+
+namespace JPLOPS.Geometry
+{
+    /// <summary>
+    /// Native single pass replacement for MeshUVs.UVBounds(), ComputeUVArea(), ComputePixelArea(), RescaleUVs(),
+    /// RescaleUVsForTexture() and Mesh.SurfaceArea(), which each make their own pass over the mesh.
+    /// </summary>
+    public class MeshUVStats
+    {
+        public BoundingBox UVBounds; //z is 0
+        public double Area; //3D surface area
+        public double UVArea;
+        public double PixelArea; //0 unless texture size was given
+        public double MinFaceArea, MaxFaceArea; //3D
+        public double MinStretch, MaxStretch; //texels (or uv units) per unit length, over faces with nonzero area
+
+        /// <summary>
+        /// null unless requested, otherwise 3D area of faces binned by texel density, see Compute()
+        /// </summary>
+        public double[] DensityHistogram;
+
+        public bool Rescaled;
+
+        /// <summary>
+        /// Stats of mesh in one pass over its vertices and one over its faces.
+        /// Pixel area and stretch are in texels of a texWidth x texHeight texture if both are positive, otherwise
+        /// pixel area is 0 and stretch is in uv units.
+        /// If histogramBins is positive DensityHistogram gets the 3D area of faces with texel density, in texels per
+        /// unit length, evenly binned in log2 from minDensity to maxDensity, clamped at both ends.
+        /// UV stats of a mesh without uvs are meaningless.
+        /// Throws ArgumentException if the native pass fails, e.g. on a NaN area.
+        /// </summary>
+        public static MeshUVStats Compute(Mesh mesh, int texWidth = 0, int texHeight = 0, int histogramBins = 0,
+                                          double minDensity = 1, double maxDensity = 1 << 16, int maxThreads = 0)
+        {
+            return Compute(mesh, null, texWidth, texHeight, histogramBins, minDensity, maxDensity, maxThreads);
+        }
+
+        /// <summary>
+        /// Same as MeshUVs.RescaleUVs(targetBounds, maxStretch, growThreshold), returning the stats of the remapped
+        /// uvs, or null if the mesh has no vertices.
+        /// </summary>
+        public static MeshUVStats RescaleUVs(Mesh mesh, BoundingBox targetBounds, double maxStretch = 1,
+                                             double growThreshold = 0.1, int texWidth = 0, int texHeight = 0,
+                                             int maxThreads = 0)
+        {
+            if (!mesh.HasVertices)
+            {
+                return null;
+            }
+            if (!mesh.HasUVs)
+            {
+                throw new Exception("mesh does not have UVs");
+            }
+            var rescale = new UVAtlasNET.UVAtlas.UVRescale()
+            {
+                minU = targetBounds.Min.X,
+                minV = targetBounds.Min.Y,
+                maxU = targetBounds.Max.X,
+                maxV = targetBounds.Max.Y,
+                maxStretch = maxStretch,
+                growThreshold = growThreshold
+            };
+            return Compute(mesh, rescale, texWidth, texHeight, 0, 0, 0, maxThreads);
+        }
+
+        /// <summary>
+        /// Same as MeshUVs.RescaleUVsForTexture(), returning the stats of the remapped uvs with pixel area and stretch
+        /// in texels of the texture, or null if the mesh has no vertices.
+        /// </summary>
+        public static MeshUVStats RescaleUVsForTexture(Mesh mesh, int texWidth, int texHeight,
+                                                       double borderPixels = 2, double maxStretch = 1,
+                                                       double growThreshold = 0.1, int maxThreads = 0)
+        {
+            var border = borderPixels * Vector2.One;
+            var targetMin = Image.PixelToUV(border, texWidth, texHeight);
+            var targetMax = Image.PixelToUV(new Vector2(texWidth, texHeight) - border, texWidth, texHeight);
+            return RescaleUVs(mesh, BoundingBoxExtensions.CreateXY(targetMin, targetMax), maxStretch, growThreshold,
+                              texWidth, texHeight, maxThreads);
+        }
+
+        private static MeshUVStats Compute(Mesh mesh, UVAtlasNET.UVAtlas.UVRescale? rescale, int texWidth,
+                                           int texHeight, int histogramBins, double minDensity, double maxDensity,
+                                           int maxThreads)
+        {
+            var bakeMesh = UVBaker.GetBakeMesh(mesh);
+            var histogram = histogramBins > 0 ? new double[histogramBins] : null;
+            int w = Math.Max(texWidth, 0), h = Math.Max(texHeight, 0);
+            var rc = UVAtlasNET.UVAtlas.ComputeUVStats(bakeMesh, w, h, out UVAtlasNET.UVAtlas.UVStats stats, rescale,
+                                                       histogram, minDensity, maxDensity, maxThreads: maxThreads);
+            if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                throw new ArgumentException("failed to compute uv stats: " + rc);
+            }
+            bool rescaled = stats.rescaled != 0;
+            if (rescaled)
+            {
+                for (int i = 0; i < mesh.Vertices.Count; i++)
+                {
+                    mesh.Vertices[i].UV = new Vector2(bakeMesh.UVs[2 * i], bakeMesh.UVs[2 * i + 1]);
+                }
+            }
+            var uvMin = new Vector3(stats.minU, stats.minV, 0);
+            var uvMax = new Vector3(stats.maxU, stats.maxV, 0);
+            return new MeshUVStats()
+            {
+                UVBounds = new BoundingBox(uvMin, uvMax),
+                Area = stats.area,
+                UVArea = stats.uvArea,
+                PixelArea = w > 0 && h > 0 ? stats.pixelArea : 0,
+                MinFaceArea = stats.minFaceArea,
+                MaxFaceArea = stats.maxFaceArea,
+                MinStretch = stats.minStretch,
+                MaxStretch = stats.maxStretch,
+                DensityHistogram = histogram,
+                Rescaled = rescaled
+            };
+        }
+    }
+}
@@ -1,5 +1,9 @@
 ﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
 using System.Threading;
+using Microsoft.Xna.Framework;
 using JPLOPS.Util;
 
 namespace JPLOPS.Geometry
@@ -18,6 +22,65 @@ namespace JPLOPS.Geometry
 
         public const int DEF_MAX_SEC = 5 * 60;
 
+        //extra time given to the native call to stop on its own after maxSec before it is cancelled
+        public const int WATCHDOG_GRACE_SEC = 10;
+
+        //optional directory of cached atlas results, keyed by a hash of the mesh and all atlas parameters
+        //so that re-processing an unchanged site reuses the results of earlier runs instead of re-atlasing
+        //null disables the cache
+        public static string CacheDir;
+
+        //optional directory where the native inputs of failed, slow or sampled atlas calls are captured as .uvajob
+        //files, so that problem tiles can be reproduced offline with UVAtlasReplay
+        //null disables capture
+        public static string CaptureDir;
+        public static double CaptureSlowSec = 60;
+        public static double CaptureSampleRate = 0;
+
+        //native UVAtlas contexts own scratch memory that is reused across calls
+        //so that allocations stay flat no matter how many tiles are atlased
+        //a context is only returned after its call completes, so one abandoned on timeout is never shared
+        //at most one idle context per core is kept, and one that atlased a mesh with more than
+        //MAX_POOLED_CONTEXT_FACES faces is destroyed instead, so that a rare huge mesh doesn't pin its scratch memory
+        //for the life of the process
+        private static ConcurrentBag<IntPtr> contextPool = new ConcurrentBag<IntPtr>();
+        private static readonly int MAX_POOLED_CONTEXTS = Environment.ProcessorCount;
+        private const int MAX_POOLED_CONTEXT_FACES = 1 << 20;
+
+        /// <summary>
+        /// Measured properties of a successful UVAtlas result.
+        /// </summary>
+        public class AtlasStats
+        {
+            public double Stretch; //as measured by the partition, 0 for none
+            public int NumCharts;
+
+            //chart id of each mesh face, or null if the atlased mesh faces don't correspond one to one with the atlas
+            //output faces (e.g. Clean() dropped some degenerate ones)
+            public int[] FaceCharts;
+        }
+
+        private static IntPtr TakeContext()
+        {
+            return contextPool.TryTake(out IntPtr context) ? context : UVAtlasNET.UVAtlas.CreateContext();
+        }
+
+        private static void ReturnContext(IntPtr context, int numFaces)
+        {
+            if (context == IntPtr.Zero)
+            {
+                return;
+            }
+            if (numFaces <= MAX_POOLED_CONTEXT_FACES && contextPool.Count < MAX_POOLED_CONTEXTS)
+            {
+                contextPool.Add(context);
+            }
+            else
+            {
+                UVAtlasNET.UVAtlas.DestroyContext(context);
+            }
+        }
+
         private class ThreadState
         {
             public volatile UVAtlasNET.UVAtlas.ReturnCode rc = UVAtlasNET.UVAtlas.ReturnCode.UNKNOWN;
@@ -31,34 +94,27 @@ namespace JPLOPS.Geometry
         /// UV Atlas will have at most `maxCharts` disconnected components (0 inidicates no limit)
         /// `maxStretch` should be 0-1, 0 being no stretch, 1 being no limit
         /// `gutter` indicates minimum distance between components in pixels
+        /// `stats`, if not null, is filled when UVAtlas succeeds, but not on naive fallback
+        /// `welded` asserts that the mesh has no duplicate vertices (e.g. after Clean()), so adjacency can be found by
+        /// exact vertex index equality, which is faster than the default `adjacencyEpsilon` search
+        /// `preflight` drops degenerate faces and natively cleans the mesh if it fails validation, e.g. bowties
+        /// `weld` natively merges coincident vertices (within `adjacencyEpsilon`) before charting, e.g. those left by
+        /// clipping or merging, which would otherwise become spurious chart boundaries
+        /// `optimize` reorders the atlased faces and vertices for vertex cache and fetch locality, e.g. for tilesets
+        /// `lowMemory` frees native buffers as soon as they are consumed, for very large meshes
         /// </summary>
         public static bool Atlas(Mesh mesh, int width = DEF_RESOLUTION, int height = DEF_RESOLUTION,
                                  int maxCharts = DEF_MAX_CHARTS, double maxStretch = DEF_MAX_STRETCH,
                                  double gutter = DEF_GUTTER, bool forceHighestQuality = false,
                                  double adjacencyEpsilon = 0, ILogger logger = null, bool fallbackToNaive = true,
-                                 int maxSec = DEF_MAX_SEC)
+                                 int maxSec = DEF_MAX_SEC, AtlasStats stats = null, bool welded = false,
+                                 bool preflight = false, bool weld = false, bool optimize = false,
+                                 bool lowMemory = false)
         {
-            int nVerts = mesh.Vertices.Count;
-            float[] inX = new float[nVerts];
-            float[] inY = new float[nVerts];
-            float[] inZ = new float[nVerts];
-
-            for (int i = 0; i < mesh.Vertices.Count; i++)
-            {
-                var p = mesh.Vertices[i].Position;
-                inX[i] = (float)p.X;
-                inY[i] = (float)p.Y;
-                inZ[i] = (float)p.Z;
-            }
-
-            int[] indices = new int[mesh.Faces.Count * 3];
-            for (int i = 0; i < mesh.Faces.Count; i++)
-            {
-                var f = mesh.Faces[i];
-                indices[i * 3 + 0] = f.P0;
-                indices[i * 3 + 1] = f.P1;
-                indices[i * 3 + 2] = f.P2;
-            }
+            double[] inPositions = GetPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            int numFaces = mesh.Faces.Count;
+            var attributes = GetAttributes(mesh, inPositions);
 
             float[] outU = null, outV = null;
             int[] outVertexRemap = null;
@@ -69,47 +125,66 @@ namespace JPLOPS.Geometry
             //ThreadState fields are volatile to ensure safe publication (memory fencing) from the worker thread to us
             //need to put them in the ThreadState class because local variables can't be volatile in c#
             var ts = new ThreadState();
+            var charts = stats != null ? new UVAtlasNET.UVAtlas.ChartInfo() : null;
+            var cancel = new CancellationTokenSource();
+            var control = WithCapture(new UVAtlasNET.UVAtlas.AtlasControl()
+            {
+                MaxSec = maxSec,
+                Cancel = cancel.Token,
+                CacheDir = CacheDir,
+                Welded = welded,
+                Preflight = (preflight ? UVAtlasNET.UVAtlas.Preflight.CLEAN | UVAtlasNET.UVAtlas.Preflight.BREAK_BOWTIES :
+                             UVAtlasNET.UVAtlas.Preflight.NONE) |
+                    (weld ? UVAtlasNET.UVAtlas.Preflight.WELD : UVAtlasNET.UVAtlas.Preflight.NONE),
+                Optimize = optimize,
+                LowMemory = lowMemory
+            });
             try
             {
                 var thread = new Thread(() =>
                 {
+                    IntPtr context = IntPtr.Zero;
                     try
                     {
-                        ts.rc = UVAtlasNET.UVAtlas.Atlas(inX, inY, inZ, indices,
+                        context = TakeContext();
+                        ts.rc = UVAtlasNET.UVAtlas.Atlas(inPositions, indices,
                                                          out outU, out outV, out indices, out outVertexRemap,
                                                          maxCharts, (float)maxStretch, (float)gutter, width, height,
-                                                         quality, (float)adjacencyEpsilon);
+                                                         quality, (float)adjacencyEpsilon, context, control,
+                                                         charts, attributes);
                         ts.done = true;
                     }
                     catch (Exception ex)
                     {
                         ts.error = ex;
                     }
+                    finally
+                    {
+                        //the context holds no state between calls, so it is reusable whatever the outcome
+                        ReturnContext(context, numFaces);
+                    }
                 });
                 thread.IsBackground = true; //don't make the process hang around just for this thread
                 double startTime = UTCTime.Now();
                 thread.Start();
-                while (!ts.done)
+                //the native call polls its own deadline while charting and returns TIMED_OUT once maxSec is exceeded
+                //this watchdog is a backstop in case it is stuck somewhere that doesn't poll, e.g. adjacency
+                //it cancels the call and abandons the thread, which then stops at the next poll
+                //typically the entire tactical or contextual mesh pipeline is run in a separate process
+                //and we run UVAtlas as a background thread, so in the worst case it'll die with the process
+                if (!thread.Join(maxSec > 0 ? (maxSec + WATCHDOG_GRACE_SEC) * 1000 : Timeout.Infinite))
                 {
-                    Thread.Sleep(100);
-                    double durationSec = UTCTime.Now() - startTime;
-                    if (durationSec > maxSec)
-                    {
-                        //could call thread.Abort() here but that'll be deprecated in .NET 5
-                        //and also it won't work on unmanaged code
-                        //so for now just let it run, this should be rare...
-                        //the only way to kill UVAtlas would be to run it in a separate subprocess
-                        //but that would mean serializing out the mesh
-                        //and that would take a bit of a rearchitecture to do well
-                        //typically the entire tactical or contextual mesh pipeline is run in a separate process
-                        //and we ran UVAtlas as a background thread, so it'll eat CPU but will die with the process
-                        if (logger != null)
-                        {
-                            logger.LogError("UVAtlas runtime {0} > {1}",
-                                            Fmt.HMS(durationSec * 1000), Fmt.HMS(maxSec * 1000));
-                        }
-                        break;
-                    }
+                    cancel.Cancel();
+                }
+                double durationSec = UTCTime.Now() - startTime;
+                if (maxSec > 0 && durationSec > maxSec && logger != null)
+                {
+                    logger.LogError("UVAtlas runtime {0} > {1}{2}", Fmt.HMS(durationSec * 1000),
+                                    Fmt.HMS(maxSec * 1000), ts.done ? "" : ", cancelled");
+                }
+                if (ts.done && logger != null)
+                {
+                    LogPhases(control, logger);
                 }
             }
             catch (Exception ex)
@@ -124,7 +199,9 @@ namespace JPLOPS.Geometry
 
             if (!ts.done || ts.error != null || ts.rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
             {
-                bool fallback = fallbackToNaive && ts.done;
+                //no fallback if the time budget is already spent
+                bool fallback = fallbackToNaive && ts.done && ts.rc != UVAtlasNET.UVAtlas.ReturnCode.TIMED_OUT &&
+                    ts.rc != UVAtlasNET.UVAtlas.ReturnCode.CANCELLED;
                 if (logger != null)
                 {
                     logger.LogError("UVAtlas failed, return code {0}{1}",
@@ -134,14 +211,515 @@ namespace JPLOPS.Geometry
                 {
                     return false;
                 }
-                if (!NaiveAtlas.Compute(mesh, out outU, out outV, out indices, out outVertexRemap))
+                return ApplyNaive(mesh, width, height, maxStretch, gutter, logger);
+            }
+
+            ApplyExpanded(mesh, outU, outV, indices, attributes);
+
+            mesh.RescaleUVsForTexture(width, height, maxStretch, gutter);
+
+            if (stats != null)
+            {
+                stats.Stretch = charts.Stretch;
+                stats.NumCharts = charts.NumCharts;
+                stats.FaceCharts = mesh.Faces.Count == charts.FacePartitioning.Length ? charts.FacePartitioning : null;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Like Atlas() but tries geodesic quality, then fast, then relaxed stretch, then unlimited charts, then naive
+        /// atlasing in a single native call that only generates adjacency once, instead of the caller re-running
+        /// Atlas() with different settings.  Runs on the calling thread, limited to maxSec by the native deadline.
+        /// strategy is the index of the rung in UVAtlasNET.UVAtlas.DefaultLadder() that succeeded, or -1.
+        /// </summary>
+        public static bool AtlasWithFallbacks(Mesh mesh, out int strategy, int width = DEF_RESOLUTION,
+                                              int height = DEF_RESOLUTION, int maxCharts = DEF_MAX_CHARTS,
+                                              double maxStretch = DEF_MAX_STRETCH, double gutter = DEF_GUTTER,
+                                              double adjacencyEpsilon = 0, ILogger logger = null,
+                                              int maxSec = DEF_MAX_SEC)
+        {
+            double[] inPositions = GetPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            var attributes = GetAttributes(mesh, inPositions);
+
+            var ladder = UVAtlasNET.UVAtlas.DefaultLadder(maxCharts, (float)maxStretch);
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { MaxSec = maxSec };
+
+            IntPtr context = TakeContext();
+            var positionsPin = GCHandle.Alloc(inPositions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            float[] outU, outV;
+            int[] outIndices;
+            try
+            {
+                var rc = UVAtlasNET.UVAtlas.CreateResultLadder(positionsPin.AddrOfPinnedObject(), 0,
+                                                               UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3,
+                                                               inPositions.Length / 3,
+                                                               indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                               ladder, out IntPtr result, out strategy,
+                                                               (float)gutter, width, height, (float)adjacencyEpsilon,
+                                                               context, control);
+                if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
                 {
                     if (logger != null)
                     {
-                        logger.LogError("UVAtlas fallback naive atlasing failed");
+                        logger.LogError("UVAtlas failed with all {0} fallbacks, return code {1}", ladder.Length, rc);
                     }
                     return false;
                 }
+                //the result is owned by the context, so copy it out before the context goes back to the pool
+                UVAtlasNET.UVAtlas.GetResultSize(result, out int numVertices, out int numIndices);
+                outU = new float[numVertices];
+                outV = new float[numVertices];
+                outIndices = new int[numIndices];
+                UVAtlasNET.UVAtlas.CopyResult(result, outU, outV, outIndices, null);
+                UVAtlasNET.UVAtlas.ExpandResult(result, attributes);
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+                ReturnContext(context, mesh.Faces.Count);
+            }
+
+            if (strategy > 0 && logger != null)
+            {
+                logger.LogWarn("UVAtlas succeeded with fallback {0} of {1}", strategy, ladder.Length - 1);
+            }
+
+            ApplyExpanded(mesh, outU, outV, outIndices, attributes);
+
+            mesh.RescaleUVsForTexture(width, height, maxStretch, gutter);
+
+            return true;
+        }
+
+        /// <summary>
+        /// Like Atlas() but runs UVAtlas in a separate UVAtlasWorker process that is killed outright if it outlives
+        /// maxSec, instead of abandoning a stuck native thread that keeps its cpu and memory until this process exits.
+        /// Also bounds the atlas memory to the worker, which always runs in low memory mode.
+        /// Falls back to naive atlasing on failure, except on timeout.
+        /// </summary>
+        public static bool AtlasInWorker(Mesh mesh, int width = DEF_RESOLUTION, int height = DEF_RESOLUTION,
+                                         int maxCharts = DEF_MAX_CHARTS, double maxStretch = DEF_MAX_STRETCH,
+                                         double gutter = DEF_GUTTER, bool forceHighestQuality = false,
+                                         double adjacencyEpsilon = 0, ILogger logger = null,
+                                         bool fallbackToNaive = true, int maxSec = DEF_MAX_SEC, bool welded = false,
+                                         bool preflight = false, bool weld = false, bool optimize = false)
+        {
+            double[] inPositions = GetPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            var attributes = GetAttributes(mesh, inPositions);
+
+            UVAtlasNET.UVAtlas.Quality quality = forceHighestQuality ?
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY :
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_DEFAULT;
+            var control = new UVAtlasNET.UVAtlas.AtlasControl()
+            {
+                MaxSec = maxSec,
+                Welded = welded,
+                Preflight = (preflight ? UVAtlasNET.UVAtlas.Preflight.CLEAN | UVAtlasNET.UVAtlas.Preflight.BREAK_BOWTIES :
+                             UVAtlasNET.UVAtlas.Preflight.NONE) |
+                    (weld ? UVAtlasNET.UVAtlas.Preflight.WELD : UVAtlasNET.UVAtlas.Preflight.NONE),
+                Optimize = optimize
+            };
+
+            var positionsPin = GCHandle.Alloc(inPositions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            var rc = UVAtlasNET.UVAtlas.ReturnCode.UNKNOWN;
+            float[] outU = null, outV = null;
+            int[] outIndices = null;
+            try
+            {
+                rc = UVAtlasNET.UVAtlas.CreateResultOutOfProcess(positionsPin.AddrOfPinnedObject(), 0,
+                                                                 UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3,
+                                                                 inPositions.Length / 3,
+                                                                 indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                                 out IntPtr result, maxCharts, (float)maxStretch,
+                                                                 (float)gutter, width, height, quality,
+                                                                 (float)adjacencyEpsilon, control);
+                if (rc == UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+                {
+                    try
+                    {
+                        UVAtlasNET.UVAtlas.GetResultSize(result, out int numVertices, out int numIndices);
+                        outU = new float[numVertices];
+                        outV = new float[numVertices];
+                        outIndices = new int[numIndices];
+                        UVAtlasNET.UVAtlas.CopyResult(result, outU, outV, outIndices, null);
+                        UVAtlasNET.UVAtlas.ExpandResult(result, attributes);
+                    }
+                    finally
+                    {
+                        UVAtlasNET.UVAtlas.DestroyResult(result);
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                if (logger != null)
+                {
+                    logger.LogError("UVAtlas worker error: " + ex.Message);
+                }
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+
+            if (outU == null)
+            {
+                bool fallback = fallbackToNaive && rc != UVAtlasNET.UVAtlas.ReturnCode.TIMED_OUT;
+                if (logger != null)
+                {
+                    logger.LogError("UVAtlas worker failed, return code {0}{1}",
+                                    rc, fallback ? ", falling back to naive atlasing" : "");
+                }
+                return fallback && ApplyNaive(mesh, width, height, maxStretch, gutter, logger);
+            }
+
+            ApplyExpanded(mesh, outU, outV, outIndices, attributes);
+
+            mesh.RescaleUVsForTexture(width, height, maxStretch, gutter);
+
+            return true;
+        }
+
+        /// <summary>
+        /// Atlas many meshes in one native call, each with the same parameters as Atlas().
+        /// The meshes are atlased concurrently on a native work stealing pool of up to maxThreads threads
+        /// (0 for one per core), which avoids the per-call thread and P/Invoke overhead of Atlas().
+        /// Each mesh is limited to maxSec by the native deadline, so one runaway mesh can't hold up the batch, and
+        /// once cancel fires the remaining meshes fail without being atlased.  As in Atlas() there is no naive
+        /// fallback for meshes that timed out or were cancelled.
+        /// Returns per-mesh success.
+        /// </summary>
+        public static bool[] AtlasBatch(IList<Mesh> meshes, int width = DEF_RESOLUTION, int height = DEF_RESOLUTION,
+                                        int maxCharts = DEF_MAX_CHARTS, double maxStretch = DEF_MAX_STRETCH,
+                                        double gutter = DEF_GUTTER, bool forceHighestQuality = false,
+                                        double adjacencyEpsilon = 0, ILogger logger = null,
+                                        bool fallbackToNaive = true, int maxThreads = 0, int maxSec = DEF_MAX_SEC,
+                                        CancellationToken cancel = default(CancellationToken))
+        {
+            UVAtlasNET.UVAtlas.Quality quality = forceHighestQuality ? 
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY : 
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_DEFAULT;
+
+            var batch = new List<UVAtlasNET.UVAtlas.BatchMesh>(meshes.Count);
+            foreach (var mesh in meshes)
+            {
+                double[] inPositions = GetPositions(mesh);
+                batch.Add(new UVAtlasNET.UVAtlas.BatchMesh()
+                {
+                    DoublePositions = inPositions,
+                    Indices = GetIndices(mesh),
+                    Attributes = GetAttributes(mesh, inPositions),
+                    MaxCharts = maxCharts,
+                    MaxStretch = (float)maxStretch,
+                    Gutter = (float)gutter,
+                    Width = width,
+                    Height = height,
+                    Quality = quality,
+                    AdjacencyEpsilon = (float)adjacencyEpsilon
+                });
+            }
+
+            //each mesh is only touched by the callback for its own index
+            var ok = new bool[meshes.Count];
+            UVAtlasNET.UVAtlas.AtlasBatch(batch, (i, rc, outU, outV, outIndices, outVertexRemap) =>
+            {
+                var mesh = meshes[i];
+                if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+                {
+                    //no fallback if the time budget is already spent
+                    bool fallback = fallbackToNaive && rc != UVAtlasNET.UVAtlas.ReturnCode.TIMED_OUT &&
+                        rc != UVAtlasNET.UVAtlas.ReturnCode.CANCELLED;
+                    if (logger != null)
+                    {
+                        logger.LogError("UVAtlas failed on batch mesh {0}, return code {1}{2}",
+                                        i, rc, fallback ? ", falling back to naive atlasing" : "");
+                    }
+                    ok[i] = fallback && ApplyNaive(mesh, width, height, maxStretch, gutter, logger);
+                    return;
+                }
+                ApplyExpanded(mesh, outU, outV, outIndices, batch[i].Attributes);
+                mesh.RescaleUVsForTexture(width, height, maxStretch, gutter);
+                ok[i] = true;
+            }, maxThreads, WithCapture(new UVAtlasNET.UVAtlas.AtlasControl()
+            {
+                MaxSec = maxSec,
+                Cancel = cancel,
+                CacheDir = CacheDir
+            }));
+
+            return ok;
+        }
+
+        /// <summary>
+        /// A mesh partitioned into charts by Partition() but not yet packed.
+        /// Pack() can be called any number of times, from any thread, to get copies of the mesh atlased at different
+        /// resolutions and gutters for the cost of packing only, instead of redoing the partition each time.
+        /// </summary>
+        public sealed class Charts : IDisposable
+        {
+            private IntPtr handle;
+            private readonly Mesh source;
+            private readonly double maxStretch;
+
+            internal Charts(IntPtr handle, Mesh source, double maxStretch)
+            {
+                this.handle = handle;
+                this.source = source;
+                this.maxStretch = maxStretch;
+            }
+
+            ~Charts()
+            {
+                Dispose();
+            }
+
+            /// <summary>
+            /// Returns a copy of the partitioned mesh with UVs packed for a `width` x `height` image,
+            /// or null if packing failed.
+            /// </summary>
+            public Mesh Pack(int width = DEF_RESOLUTION, int height = DEF_RESOLUTION, double gutter = DEF_GUTTER,
+                             ILogger logger = null)
+            {
+                if (handle == IntPtr.Zero)
+                {
+                    throw new ObjectDisposedException("UVAtlas.Charts");
+                }
+                var rc = UVAtlasNET.UVAtlas.PackCharts(handle, out IntPtr result, (float)gutter, width, height);
+                if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+                {
+                    if (logger != null)
+                    {
+                        logger.LogError("UVAtlas pack failed at {0}x{1}, return code {2}", width, height, rc);
+                    }
+                    return null;
+                }
+                try
+                {
+                    UVAtlasNET.UVAtlas.GetResultSize(result, out int numVertices, out int numIndices);
+                    var outU = new float[numVertices];
+                    var outV = new float[numVertices];
+                    var outIndices = new int[numIndices];
+                    var outVertexRemap = new int[numVertices];
+                    UVAtlasNET.UVAtlas.CopyResult(result, outU, outV, outIndices, outVertexRemap);
+                    var mesh = new Mesh(source);
+                    mesh.ApplyAtlas(outU, outV, outIndices, outVertexRemap);
+                    mesh.RescaleUVsForTexture(width, height, maxStretch, gutter);
+                    return mesh;
+                }
+                finally
+                {
+                    UVAtlasNET.UVAtlas.DestroyResult(result);
+                }
+            }
+
+            public void Dispose()
+            {
+                UVAtlasNET.UVAtlas.DestroyCharts(handle);
+                handle = IntPtr.Zero;
+                GC.SuppressFinalize(this);
+            }
+        }
+
+        /// <summary>
+        /// Partition a mesh into charts once so that it can then be packed at several resolutions and gutters with
+        /// Charts.Pack().  Parameters are the same as Atlas(), the mesh is copied so it may be changed afterwards.
+        /// Returns null on failure; there is no naive fallback since naive atlasing is not partitioned.
+        /// </summary>
+        public static Charts Partition(Mesh mesh, int maxCharts = DEF_MAX_CHARTS, double maxStretch = DEF_MAX_STRETCH,
+                                       bool forceHighestQuality = false, double adjacencyEpsilon = 0,
+                                       ILogger logger = null, int maxSec = DEF_MAX_SEC)
+        {
+            double[] inPositions = GetPositions(mesh);
+            int[] indices = GetIndices(mesh);
+
+            UVAtlasNET.UVAtlas.Quality quality = forceHighestQuality ? 
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY : 
+                UVAtlasNET.UVAtlas.Quality.UVATLAS_DEFAULT;
+
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { MaxSec = maxSec };
+            IntPtr handle;
+            UVAtlasNET.UVAtlas.ReturnCode rc;
+            var positionsPin = GCHandle.Alloc(inPositions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            try
+            {
+                rc = UVAtlasNET.UVAtlas.CreateCharts(positionsPin.AddrOfPinnedObject(), 0,
+                                                     UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3, inPositions.Length / 3,
+                                                     indicesPin.AddrOfPinnedObject(), indices.Length, out handle,
+                                                     maxCharts, (float)maxStretch, quality, (float)adjacencyEpsilon,
+                                                     control);
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+            if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                if (logger != null)
+                {
+                    logger.LogError("UVAtlas partition failed, return code {0}", rc);
+                }
+                return null;
+            }
+            if (logger != null)
+            {
+                LogPhases(control, logger);
+            }
+            return new Charts(handle, new Mesh(mesh), maxStretch);
+        }
+
+        private static UVAtlasNET.UVAtlas.AtlasControl WithCapture(UVAtlasNET.UVAtlas.AtlasControl control)
+        {
+            if (!string.IsNullOrEmpty(CaptureDir))
+            {
+                control.CaptureDir = CaptureDir;
+                control.Capture = UVAtlasNET.UVAtlas.Capture.FAILED | UVAtlasNET.UVAtlas.Capture.SLOW |
+                    (CaptureSampleRate > 0 ? UVAtlasNET.UVAtlas.Capture.SAMPLED : UVAtlasNET.UVAtlas.Capture.NONE);
+                control.CaptureSlowSec = CaptureSlowSec;
+                control.CaptureSampleRate = (float)CaptureSampleRate;
+            }
+            return control;
+        }
+
+        private static void LogPhases(UVAtlasNET.UVAtlas.AtlasControl control, ILogger logger)
+        {
+            for (int i = 0; i < UVAtlasNET.UVAtlas.NUM_PHASES; i++)
+            {
+                var stats = control.Phases[i];
+                logger.LogVerbose("UVAtlas {0}: {1}, private {2}, peak private {3}, peak working set {4}",
+                                  (UVAtlasNET.UVAtlas.Phase)i, Fmt.HMS(stats.wallSec * 1000),
+                                  Fmt.Bytes((long)stats.privateBytes), Fmt.Bytes((long)stats.peakPrivateBytes),
+                                  Fmt.Bytes((long)stats.peakWorkingSetBytes));
+            }
+            var pf = control.PreflightStats;
+            if (control.Preflight != UVAtlasNET.UVAtlas.Preflight.NONE &&
+                (pf.degenerateFaces > 0 || pf.removedFaces > 0 || pf.duplicatedVertices > 0 || pf.weldedVertices > 0))
+            {
+                logger.LogVerbose("UVAtlas preflight: welded {0} vertices, dropped {1} degenerate faces, " +
+                                  "cleaned {2} faces, duplicated {3} vertices", pf.weldedVertices, pf.degenerateFaces,
+                                  pf.removedFaces, pf.duplicatedVertices);
+            }
+        }
+
+        //interleaved double precision positions, which the native side recenters and narrows itself
+        internal static double[] GetPositions(Mesh mesh)
+        {
+            var positions = new double[mesh.Vertices.Count * 3];
+            for (int i = 0; i < mesh.Vertices.Count; i++)
+            {
+                var p = mesh.Vertices[i].Position;
+                positions[i * 3 + 0] = p.X;
+                positions[i * 3 + 1] = p.Y;
+                positions[i * 3 + 2] = p.Z;
+            }
+            return positions;
+        }
+
+        internal static int[] GetIndices(Mesh mesh)
+        {
+            var indices = new int[mesh.Faces.Count * 3];
+            for (int i = 0; i < mesh.Faces.Count; i++)
+            {
+                var f = mesh.Faces[i];
+                indices[i * 3 + 0] = f.P0;
+                indices[i * 3 + 1] = f.P1;
+                indices[i * 3 + 2] = f.P2;
+            }
+            return indices;
+        }
+
+        //positions from GetPositions(), then normals and colors if the mesh has them, as flat per-vertex arrays
+        //which the native side expands through the atlas vertex remap for ApplyExpanded()
+        private static UVAtlasNET.UVAtlas.AttributeStream[] GetAttributes(Mesh mesh, double[] positions)
+        {
+            int nVerts = mesh.Vertices.Count;
+            var normals = mesh.HasNormals ? new double[nVerts * 3] : null;
+            var colors = mesh.HasColors ? new double[nVerts * 4] : null;
+            for (int i = 0; i < nVerts; i++)
+            {
+                var vert = mesh.Vertices[i];
+                if (normals != null)
+                {
+                    normals[i * 3 + 0] = vert.Normal.X;
+                    normals[i * 3 + 1] = vert.Normal.Y;
+                    normals[i * 3 + 2] = vert.Normal.Z;
+                }
+                if (colors != null)
+                {
+                    colors[i * 4 + 0] = vert.Color.X;
+                    colors[i * 4 + 1] = vert.Color.Y;
+                    colors[i * 4 + 2] = vert.Color.Z;
+                    colors[i * 4 + 3] = vert.Color.W;
+                }
+            }
+            var streams = new List<UVAtlasNET.UVAtlas.AttributeStream>();
+            foreach (var input in new double[][] { positions, normals, colors })
+            {
+                if (input != null)
+                {
+                    int components = input == colors ? 4 : 3;
+                    streams.Add(new UVAtlasNET.UVAtlas.AttributeStream() { Input = input, ComponentsPerVertex = components });
+                }
+            }
+            return streams.ToArray();
+        }
+
+        //same as MeshUVs.ApplyAtlas() but builds the vertices from attributes already expanded by the native side
+        //in one pass instead of copying input vertices through the vertex remap one at a time
+        private static void ApplyExpanded(Mesh mesh, float[] u, float[] v, int[] indices,
+                                          UVAtlasNET.UVAtlas.AttributeStream[] attributes)
+        {
+            var positions = (double[])attributes[0].Output;
+            var normals = mesh.HasNormals ? (double[])attributes[1].Output : null;
+            var colors = mesh.HasColors ? (double[])attributes[attributes.Length - 1].Output : null;
+            var verts = new List<Vertex>(u.Length);
+            for (int i = 0; i < u.Length; i++)
+            {
+                var vert = new Vertex(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+                if (normals != null)
+                {
+                    vert.Normal = new Vector3(normals[i * 3 + 0], normals[i * 3 + 1], normals[i * 3 + 2]);
+                }
+                if (colors != null)
+                {
+                    vert.Color = new Vector4(colors[i * 4 + 0], colors[i * 4 + 1], colors[i * 4 + 2], colors[i * 4 + 3]);
+                }
+                vert.UV = new Vector2(u[i], v[i]);
+                verts.Add(vert);
+            }
+            mesh.Vertices = verts;
+            mesh.HasUVs = true;
+
+            var faces = new List<Face>(indices.Length / 3);
+            for (int i = 0; i < indices.Length; i += 3)
+            {
+                faces.Add(new Face(indices[i], indices[i + 1], indices[i + 2]));
+            }
+            mesh.Faces = faces;
+
+            mesh.Clean();
+        }
+
+        private static bool ApplyNaive(Mesh mesh, int width, int height, double maxStretch, double gutter,
+                                       ILogger logger)
+        {
+            if (!NaiveAtlas.Compute(mesh, out float[] outU, out float[] outV, out int[] indices,
+                                    out int[] outVertexRemap))
+            {
+                if (logger != null)
+                {
+                    logger.LogError("UVAtlas fallback naive atlasing failed");
+                }
+                return false;
             }
 
             mesh.ApplyAtlas(outU, outV, indices, outVertexRemap);
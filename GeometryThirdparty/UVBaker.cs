@@ -0,0 +1,176 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using JPLOPS.Imaging;
+
+namespace JPLOPS.Geometry
+{
+    /// <summary>
+    /// Native texture baker: samples a fixed set of textured source meshes onto the uvs of any number of destination
+    /// meshes, rasterizing each destination in uv space and finding the closest source point with a native BVH.
+    /// The source images are pinned, not copied, until the baker is disposed.
+    /// </summary>
+    public class UVBaker : IDisposable
+    {
+        private UVAtlasNET.UVAtlas.Baker baker;
+        private int bands;
+        private bool hasIndex;
+
+        /// <summary>
+        /// indices may be null or have null entries for sources without an index image
+        /// </summary>
+        public UVBaker(IList<Mesh> meshes, IList<Image> images, IList<Image> indices = null)
+        {
+            if (meshes.Count == 0 || meshes.Count != images.Count || (indices != null && indices.Count != meshes.Count))
+            {
+                throw new ArgumentException("baker requires one image per source mesh");
+            }
+            bands = images[0].Bands;
+            hasIndex = indices != null && indices.All(index => index != null && index.Bands >= 3);
+            var sources = new UVAtlasNET.UVAtlas.BakeSource[meshes.Count];
+            for (int i = 0; i < meshes.Count; i++)
+            {
+                if (!meshes[i].HasUVs)
+                {
+                    throw new ArgumentException("all source meshes must have UVs");
+                }
+                sources[i] = new UVAtlasNET.UVAtlas.BakeSource()
+                {
+                    Mesh = GetBakeMesh(meshes[i]),
+                    Image = GetBakeImage(images[i]),
+                    Index = indices != null && indices[i] != null ? GetBakeImage(indices[i]) : null
+                };
+            }
+            var rc = UVAtlasNET.UVAtlas.CreateBaker(sources, out baker);
+            if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                throw new ArgumentException("failed to create texture baker: " + rc);
+            }
+        }
+
+        public void Dispose()
+        {
+            if (baker != null)
+            {
+                baker.Dispose();
+                baker = null;
+            }
+        }
+
+        /// <summary>
+        /// Returns a new image with the same number of bands as the sources, masked where no destination face covers
+        /// the texel.  If withIndex is true and every source has an index then destIndex is baked likewise, otherwise
+        /// it is null.
+        /// Charts are then padded padWidth texels into the gutter, see Dilate(), 0 for none, negative for unlimited.
+        /// </summary>
+        public Image Bake(Mesh dest, int width, int height, out Image destIndex, bool withIndex = true,
+                          int padWidth = 0, int maxThreads = 0)
+        {
+            if (!dest.HasUVs)
+            {
+                throw new ArgumentException("target mesh must have UVs");
+            }
+            var bakeMesh = GetBakeMesh(dest);
+            var image = new Image(bands, width, height);
+            destIndex = withIndex && hasIndex ? new Image(3, width, height) : null;
+            var coverage = new byte[width * height];
+            var rc = baker.Bake(bakeMesh, GetBakeImage(image), destIndex != null ? GetBakeImage(destIndex) : null,
+                                coverage, maxThreads);
+            if (rc == UVAtlasNET.UVAtlas.ReturnCode.NO_INDEX)
+            {
+                //the image is baked, only the index could not be
+                destIndex = null;
+            }
+            else if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                throw new ArgumentException("failed to bake texture: " + rc);
+            }
+            if (padWidth != 0)
+            {
+                var images = destIndex != null ? new Image[] { image, destIndex } : new Image[] { image };
+                Dilate(images, coverage, padWidth, maxThreads);
+            }
+            SetMask(image, coverage);
+            if (destIndex != null)
+            {
+                SetMask(destIndex, coverage);
+            }
+            return image;
+        }
+
+        /// <summary>
+        /// Pads the unmasked texels of image, and of index if not null, into the masked ones in place
+        /// Each masked texel within padWidth texels of an unmasked one (negative for unlimited) takes the value of the
+        /// nearest unmasked texel and is unmasked
+        /// Unlike Inpaint() values are copied, not averaged, so chart colors don't bleed into each other or the gutter
+        /// </summary>
+        public static Image Dilate(Image image, int padWidth = -1, Image index = null, int maxThreads = 0)
+        {
+            if (!image.HasMask || padWidth == 0)
+            {
+                return image;
+            }
+            var coverage = new byte[image.Width * image.Height];
+            for (int i = 0; i < coverage.Length; i++)
+            {
+                coverage[i] = (byte)(image.IsValid(i) ? 1 : 0);
+            }
+            Dilate(index != null ? new Image[] { image, index } : new Image[] { image }, coverage, padWidth,
+                   maxThreads);
+            SetMask(image, coverage);
+            if (index != null)
+            {
+                SetMask(index, coverage);
+            }
+            return image;
+        }
+
+        private static void Dilate(Image[] images, byte[] coverage, int padWidth, int maxThreads)
+        {
+            var rc = UVAtlasNET.UVAtlas.Dilate(images.Select(GetBakeImage).ToArray(), coverage, padWidth, maxThreads);
+            if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                throw new ArgumentException("failed to dilate texture: " + rc);
+            }
+        }
+
+        internal static UVAtlasNET.UVAtlas.BakeMesh GetBakeMesh(Mesh mesh)
+        {
+            var uvs = new double[mesh.Vertices.Count * 2];
+            for (int i = 0; i < mesh.Vertices.Count; i++)
+            {
+                uvs[i * 2 + 0] = mesh.Vertices[i].UV.X;
+                uvs[i * 2 + 1] = mesh.Vertices[i].UV.Y;
+            }
+            return new UVAtlasNET.UVAtlas.BakeMesh()
+            {
+                Positions = UVAtlas.GetPositions(mesh),
+                UVs = uvs,
+                Indices = UVAtlas.GetIndices(mesh)
+            };
+        }
+
+        //band data is shared with the image, not copied, so the baker writes destination images in place
+        private static UVAtlasNET.UVAtlas.BakeImage GetBakeImage(Image image)
+        {
+            return new UVAtlasNET.UVAtlas.BakeImage()
+            {
+                Bands = Enumerable.Range(0, image.Bands).Select(b => image.GetBandData(b)).ToArray(),
+                Width = image.Width,
+                Height = image.Height
+            };
+        }
+
+        private static void SetMask(Image image, byte[] coverage)
+        {
+            image.CreateMask(true);
+            for (int i = 0; i < coverage.Length; i++)
+            {
+                if (coverage[i] != 0)
+                {
+                    image.SetMaskValue(i, false);
+                }
+            }
+        }
+    }
+}
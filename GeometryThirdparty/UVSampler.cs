@@ -0,0 +1,119 @@
+﻿using System;
+using System.Collections.Generic;
+using Microsoft.Xna.Framework;
+
+namespace JPLOPS.Geometry
+{
+    /// <summary>
+    /// Texel center samples of a mesh's uv space, in row major order, from UVSampler.Sample()
+    /// </summary>
+    public class UVSamples
+    {
+        public int Width, Height;
+
+        public int[] Pixels; //row * Width + col
+        public int[] Faces;
+        public double[] Barycentrics; //3 per sample
+        public double[] Points; //3 per sample
+
+        public int Count { get { return Pixels.Length; } }
+
+        public Vector3 Point(int i)
+        {
+            return new Vector3(Points[3 * i], Points[3 * i + 1], Points[3 * i + 2]);
+        }
+
+        /// <summary>
+        /// texel center, the same as the pixels of MeshOperator.SampleUVSpace()
+        /// </summary>
+        public Vector2 Pixel(int i)
+        {
+            return new Vector2(Pixels[i] % Width + 0.5, Pixels[i] / Width + 0.5);
+        }
+
+        /// <summary>
+        /// index of the sample of pixel row * Width + col, or -1 if it was not covered or not kept in a subsample
+        /// </summary>
+        public int IndexOf(int pixel)
+        {
+            int i = Array.BinarySearch(Pixels, pixel);
+            return i >= 0 ? i : -1;
+        }
+
+        /// <summary>
+        /// pixels are texel centers, the same as MeshOperator.SampleUVSpace()
+        /// </summary>
+        public List<PixelPoint> ToPixelPoints()
+        {
+            var ret = new List<PixelPoint>(Count);
+            for (int i = 0; i < Count; i++)
+            {
+                ret.Add(new PixelPoint(Pixel(i), Point(i)));
+            }
+            return ret;
+        }
+    }
+
+    /// <summary>
+    /// Native replacement for MeshOperator.SampleUVSpace() and SubsampleUVSpace() which scan converts the uv triangles
+    /// instead of querying a uv face tree per texel.
+    /// </summary>
+    public static class UVSampler
+    {
+        /// <summary>
+        /// Finds the face, barycentric coordinates and mesh point at the center of each texel of a width x height
+        /// texture covered by the mesh uvs.
+        /// If fraction is in (0, 1) an evenly spread and repeatable subset of about that fraction of them is returned,
+        /// the same subset MeshOperator.SubsampleUVSpace() would pick.
+        /// </summary>
+        public static UVSamples Sample(Mesh mesh, int width, int height, double fraction = 1, int maxThreads = 0)
+        {
+            if (!mesh.HasUVs)
+            {
+                throw new ArgumentException("mesh needs uvs to sample uv space");
+            }
+            return Sample(UVBaker.GetBakeMesh(mesh), width, height, fraction, maxThreads);
+        }
+
+        /// <summary>
+        /// Same as Sample() but at the (width + 1) x (height + 1) texel corners of a width x height texture, the pixel
+        /// coordinates (col, row) that MeshOperator.UVToBarycentric() would get from Image.PixelToUV() and
+        /// Image.GetPixelCorners().  Width and Height of the result are width + 1 and height + 1.
+        /// </summary>
+        public static UVSamples SampleCorners(Mesh mesh, int width, int height, int maxThreads = 0)
+        {
+            if (!mesh.HasUVs)
+            {
+                throw new ArgumentException("mesh needs uvs to sample uv space");
+            }
+            //the texel centers of a texture one texel larger land on the corners once the uvs are scaled to match
+            var bakeMesh = UVBaker.GetBakeMesh(mesh);
+            for (int i = 0; i < bakeMesh.UVs.Length; i += 2)
+            {
+                bakeMesh.UVs[i] = (bakeMesh.UVs[i] * width + 0.5) / (width + 1);
+                bakeMesh.UVs[i + 1] = 1 - ((1 - bakeMesh.UVs[i + 1]) * height + 0.5) / (height + 1);
+            }
+            return Sample(bakeMesh, width + 1, height + 1, 1, maxThreads);
+        }
+
+        private static UVSamples Sample(UVAtlasNET.UVAtlas.BakeMesh bakeMesh, int width, int height, double fraction,
+                                        int maxThreads)
+        {
+            var rc = UVAtlasNET.UVAtlas.SampleUVs(bakeMesh, width, height, out int[] pixels, out int[] faces,
+                                                 out double[] barycentrics, out double[] points, fraction, maxThreads);
+            if (rc != UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                throw new ArgumentException("failed to sample uv space: " + rc);
+            }
+            return new UVSamples()
+            {
+                Width = width,
+                Height = height,
+                Pixels = pixels,
+                Faces = faces,
+                Barycentrics = barycentrics,
+                Points = points
+            };
+        }
+    }
+}
@@ -1,5 +1,11 @@
-﻿using System.Collections.Generic;
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
+using Microsoft.Xna.Framework;
 using JPLOPS.Geometry;
 
 namespace GeometryThirdpartyTest
@@ -29,5 +35,1483 @@ namespace GeometryThirdpartyTest
                 }
             }
         }
+
+        private static void AssertUVsInRange(Mesh mesh)
+        {
+            Assert.IsTrue(mesh.HasUVs);
+            foreach (var v in mesh.Vertices)
+            {
+                Assert.IsTrue(v.UV.X >= 0 && v.UV.X <= 1 && v.UV.Y >= 0 && v.UV.Y <= 1);
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasBatchTest()
+        {
+            var meshes = new List<Mesh>();
+            for (int i = 0; i < 4; i++)
+            {
+                var mesh = TestMeshCreator.CreateMesh(true, false, true);
+                mesh.Scale(i + 1);
+                meshes.Add(mesh);
+            }
+            var areas = meshes.Select(m => m.SurfaceArea()).ToList();
+            bool[] ok = UVAtlas.AtlasBatch(meshes, fallbackToNaive: false, maxThreads: 2);
+            for (int i = 0; i < meshes.Count; i++)
+            {
+                Assert.IsTrue(ok[i]);
+                AssertUVsInRange(meshes[i]);
+                Assert.IsTrue(meshes[i].HasNormals && meshes[i].HasColors);
+                //attributes are expanded natively, so the atlased mesh covers the same surface
+                Assert.AreEqual(areas[i], meshes[i].SurfaceArea(), 1e-6 * areas[i]);
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasBatchCancelTest()
+        {
+            var meshes = new List<Mesh>() { TestMeshCreator.CreateMesh(false, false, false),
+                                            TestMeshCreator.CreateMesh(false, false, false) };
+            var cancel = new CancellationTokenSource();
+            cancel.Cancel();
+            //cancelled meshes are not atlased and don't fall back to naive atlasing
+            bool[] ok = UVAtlas.AtlasBatch(meshes, cancel: cancel.Token);
+            Assert.IsFalse(ok.Any(b => b));
+            Assert.IsFalse(meshes.Any(m => m.HasUVs));
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void PartitionPackTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            double area = mesh.SurfaceArea();
+            using (var charts = UVAtlas.Partition(mesh))
+            {
+                Assert.IsNotNull(charts);
+                //the partition is copied, so changing the source afterwards doesn't affect packing
+                mesh.Scale(2);
+                var small = charts.Pack(256, 256);
+                var large = charts.Pack(1024, 1024);
+                Assert.IsNotNull(small);
+                Assert.IsNotNull(large);
+                AssertUVsInRange(small);
+                AssertUVsInRange(large);
+                //both packings share the one partition, so only the uvs differ
+                Assert.AreEqual(small.Vertices.Count, large.Vertices.Count);
+                Assert.AreEqual(small.Faces.Count, large.Faces.Count);
+                for (int i = 0; i < small.Vertices.Count; i++)
+                {
+                    Assert.AreEqual(small.Vertices[i].Position, large.Vertices[i].Position);
+                }
+                for (int i = 0; i < small.Faces.Count; i++)
+                {
+                    Assert.AreEqual(small.Faces[i].P0, large.Faces[i].P0);
+                    Assert.AreEqual(small.Faces[i].P1, large.Faces[i].P1);
+                    Assert.AreEqual(small.Faces[i].P2, large.Faces[i].P2);
+                }
+                Assert.AreEqual(area, small.SurfaceArea(), 1e-6 * area);
+                //the gutter is in pixels, so the packings differ
+                Assert.IsTrue(Enumerable.Range(0, small.Vertices.Count)
+                              .Any(i => small.Vertices[i].UV != large.Vertices[i].UV));
+            }
+        }
+
+        /// <summary>
+        /// Two triangles that don't touch, so any atlas has at least two charts.
+        /// </summary>
+        private static Mesh CreateDisconnectedMesh()
+        {
+            Triangle t1 = new Triangle(new Vertex(0, 0, 0), new Vertex(0, 1, 0), new Vertex(1, 0, 0));
+            Triangle t2 = new Triangle(new Vertex(3, 0, 0), new Vertex(3, 1, 0), new Vertex(4, 0, 1));
+            return new Mesh(new List<Triangle> { t1, t2 });
+        }
+
+        private static UVAtlasNET.UVAtlas.ReturnCode AtlasLadder(Mesh mesh, UVAtlasNET.UVAtlas.Strategy[] ladder,
+                                                                 out int strategy,
+                                                                 UVAtlasNET.UVAtlas.AtlasControl control = null)
+        {
+            var positions = mesh.Vertices.SelectMany(v => new[] { v.Position.X, v.Position.Y, v.Position.Z }).ToArray();
+            var indices = mesh.Faces.SelectMany(f => new[] { f.P0, f.P1, f.P2 }).ToArray();
+            var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            try
+            {
+                var rc = UVAtlasNET.UVAtlas.CreateResultLadder(positionsPin.AddrOfPinnedObject(), 0,
+                                                               UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3,
+                                                               mesh.Vertices.Count,
+                                                               indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                               ladder, out IntPtr result, out strategy,
+                                                               control: control);
+                Assert.AreEqual(rc == UVAtlasNET.UVAtlas.ReturnCode.SUCCESS, result != IntPtr.Zero);
+                UVAtlasNET.UVAtlas.DestroyResult(result);
+                return rc;
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasWithFallbacksTest()
+        {
+            //a connected grid succeeds on the first rung
+            var grid = TestMeshCreator.CreateMesh(false, false, false);
+            Assert.IsTrue(UVAtlas.AtlasWithFallbacks(grid, out int strategy));
+            Assert.AreEqual(0, strategy);
+            AssertUVsInRange(grid);
+
+            //two charts can't be had with maxCharts = 1, so every limited rung fails before the unlimited one
+            var ladder = UVAtlasNET.UVAtlas.DefaultLadder(1);
+            int unlimited = Array.FindIndex(ladder, s => s.naive == 0 && s.maxCharts == 0);
+            Assert.AreEqual(ladder.Length - 2, unlimited);
+            Assert.AreEqual(1, ladder.Last().naive);
+            var mesh = CreateDisconnectedMesh();
+            Assert.IsTrue(UVAtlas.AtlasWithFallbacks(mesh, out strategy, maxCharts: 1));
+            Assert.AreEqual(unlimited, strategy);
+            AssertUVsInRange(mesh);
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasLadderTest()
+        {
+            var quality = UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY;
+            var mesh = CreateDisconnectedMesh();
+
+            //the naive last resort is reached when every atlas rung fails
+            var ladder = new[] { UVAtlasNET.UVAtlas.Strategy.Atlas(1, 0.1666f, quality),
+                                 UVAtlasNET.UVAtlas.Strategy.Naive() };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS, AtlasLadder(mesh, ladder, out int strategy));
+            Assert.AreEqual(1, strategy);
+
+            //a later atlas rung is used in preference to naive
+            ladder = new[] { UVAtlasNET.UVAtlas.Strategy.Atlas(1, 0.1666f, quality),
+                             UVAtlasNET.UVAtlas.Strategy.Atlas(0, 0.1666f, quality),
+                             UVAtlasNET.UVAtlas.Strategy.Naive() };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS, AtlasLadder(mesh, ladder, out strategy));
+            Assert.AreEqual(1, strategy);
+
+            //cancellation and timeout stop the ladder instead of falling through to the rungs that would succeed
+            var cancel = new CancellationTokenSource();
+            cancel.Cancel();
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { Cancel = cancel.Token };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.CANCELLED, AtlasLadder(mesh, ladder, out strategy, control));
+            Assert.AreEqual(-1, strategy);
+
+            control = new UVAtlasNET.UVAtlas.AtlasControl() { MaxSec = 1e-9 };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.TIMED_OUT, AtlasLadder(mesh, ladder, out strategy, control));
+            Assert.AreEqual(-1, strategy);
+        }
+
+        private static UVAtlasNET.UVAtlas.ReturnCode AtlasUVs(Mesh mesh, bool outOfProcess,
+                                                              out float[] u, out float[] v, out int[] outIndices)
+        {
+            var positions = mesh.Vertices.SelectMany(p => new[] { p.Position.X, p.Position.Y, p.Position.Z }).ToArray();
+            var indices = mesh.Faces.SelectMany(f => new[] { f.P0, f.P1, f.P2 }).ToArray();
+            var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            u = v = null;
+            outIndices = null;
+            try
+            {
+                IntPtr result;
+                var rc = outOfProcess ?
+                    UVAtlasNET.UVAtlas.CreateResultOutOfProcess(positionsPin.AddrOfPinnedObject(), 0,
+                                                                UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3,
+                                                                mesh.Vertices.Count, indicesPin.AddrOfPinnedObject(),
+                                                                indices.Length, out result) :
+                    UVAtlasNET.UVAtlas.CreateResult(positionsPin.AddrOfPinnedObject(), 0,
+                                                    UVAtlasNET.UVAtlas.PositionFormat.DOUBLE3,
+                                                    mesh.Vertices.Count, indicesPin.AddrOfPinnedObject(),
+                                                    indices.Length, out result);
+                if (rc == UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+                {
+                    UVAtlasNET.UVAtlas.GetResultSize(result, out int numVertices, out int numIndices);
+                    u = new float[numVertices];
+                    v = new float[numVertices];
+                    outIndices = new int[numIndices];
+                    UVAtlasNET.UVAtlas.CopyResult(result, u, v, outIndices, null);
+                    UVAtlasNET.UVAtlas.DestroyResult(result);
+                }
+                return rc;
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        [DeploymentItem("UVAtlasWorker_x32.exe")]
+        [DeploymentItem("UVAtlasWorker_x64.exe")]
+        public void AtlasOutOfProcessTest()
+        {
+            //the worker atlases the job file the same way as an in process call, so the uvs are identical
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            AtlasUVs(mesh, false, out float[] u, out float[] v, out int[] indices));
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            AtlasUVs(mesh, true, out float[] workerU, out float[] workerV, out int[] workerIndices));
+            CollectionAssert.AreEqual(u, workerU);
+            CollectionAssert.AreEqual(v, workerV);
+            CollectionAssert.AreEqual(indices, workerIndices);
+
+            //a missing worker is a failure, not an exception
+            string workerPath = UVAtlasNET.UVAtlas.WorkerPath;
+            try
+            {
+                UVAtlasNET.UVAtlas.WorkerPath = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N") + ".exe");
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.UNKNOWN, AtlasUVs(mesh, true, out u, out v, out indices));
+            }
+            finally
+            {
+                UVAtlasNET.UVAtlas.WorkerPath = workerPath;
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void UVSamplerTest()
+        {
+            //texel centers never land on the outer uv edges of the test mesh at this resolution, so both cover exactly
+            //the same texels, but they can land on a shared diagonal where each may pick a different face
+            var mesh = TestMeshCreator.CreateMesh(false, true, false);
+            var meshOp = new MeshOperator(mesh, buildFaceTree: false, buildVertexTree: false, buildUVFaceTree: true);
+            int res = 100;
+
+            var expected = meshOp.SampleUVSpace(res, res, sorted: true);
+            var samples = UVSampler.Sample(mesh, res, res);
+            Assert.AreEqual(expected.Count, samples.Count);
+            for (int i = 0; i < samples.Count; i++)
+            {
+                Assert.AreEqual(expected[i].Pixel, samples.Pixel(i));
+                Assert.AreEqual(0, Vector3.Distance(expected[i].Point, samples.Point(i)), 1e-6);
+
+                //the sample's face and barycentrics must give the same point
+                var face = mesh.Faces[samples.Faces[i]];
+                double b1 = samples.Barycentrics[3 * i + 1], b2 = samples.Barycentrics[3 * i + 2];
+                double b0 = samples.Barycentrics[3 * i];
+                Assert.IsTrue(b0 >= -1e-9 && b1 >= -1e-9 && b2 >= -1e-9);
+                Vector3 facePoint = b0 * mesh.Vertices[face.P0].Position + b1 * mesh.Vertices[face.P1].Position +
+                    b2 * mesh.Vertices[face.P2].Position;
+                Assert.AreEqual(0, Vector3.Distance(expected[i].Point, facePoint), 1e-6);
+            }
+
+            foreach (double pct in new double[] { 0.01, 0.1, 0.5 })
+            {
+                var expectedSubset = meshOp.SubsampleUVSpace(pct, res, res);
+                var subset = UVSampler.Sample(mesh, res, res, pct);
+                Assert.AreEqual(expectedSubset.Count, subset.Count);
+                for (int i = 0; i < subset.Count; i++)
+                {
+                    Assert.AreEqual(expectedSubset[i].Pixel, subset.Pixel(i));
+                    Assert.AreEqual(0, Vector3.Distance(expectedSubset[i].Point, subset.Point(i)), 1e-6);
+                }
+            }
+
+            //texel corners at a resolution where only the u = 0 and v = 0 corners land on the outer uv edges, which
+            //UVToBarycentric() may round off the mesh, so those are left out
+            int cornerRes = 97;
+            var corners = UVSampler.SampleCorners(mesh, cornerRes, cornerRes);
+            Assert.AreEqual(cornerRes + 1, corners.Width);
+            for (int row = 0; row < cornerRes; row++)
+            {
+                for (int col = 1; col <= cornerRes; col++)
+                {
+                    var uv = new Vector2(col / (double)cornerRes, 1 - row / (double)cornerRes);
+                    var bary = meshOp.UVToBarycentric(uv);
+                    int i = corners.IndexOf(row * corners.Width + col);
+                    Assert.AreEqual(bary != null, i >= 0);
+                    if (bary != null)
+                    {
+                        Assert.AreEqual(0, Vector3.Distance(bary.Position, corners.Point(i)), 1e-6);
+                    }
+                }
+            }
+        }
+
+        //the test mesh with its uvs moved into [min, max]
+        private static Mesh CreateMeshWithUVs(Vector2 min, Vector2 max)
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, true, false);
+            var b = mesh.UVBounds();
+            var sz = new Vector2(b.Max.X - b.Min.X, b.Max.Y - b.Min.Y);
+            foreach (var v in mesh.Vertices)
+            {
+                v.UV = min + (v.UV - new Vector2(b.Min.X, b.Min.Y)) / sz * (max - min);
+            }
+            return mesh;
+        }
+
+        private static Mesh[] CreateUVStatsMeshes()
+        {
+            return new Mesh[] {
+                TestMeshCreator.CreateMesh(false, true, false),
+                CreateMeshWithUVs(new Vector2(0.1, 0.2), new Vector2(0.4, 0.9)), //non square, rescaled by stretch
+                CreateMeshWithUVs(new Vector2(0.01, 0.02), new Vector2(0.95, 0.97)) //within the grow threshold
+            };
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void MeshUVStatsTest()
+        {
+            foreach (var mesh in CreateUVStatsMeshes())
+            {
+                var stats = MeshUVStats.Compute(mesh);
+                var bounds = mesh.UVBounds();
+                Assert.AreEqual(bounds.Min.X, stats.UVBounds.Min.X, 1e-12);
+                Assert.AreEqual(bounds.Min.Y, stats.UVBounds.Min.Y, 1e-12);
+                Assert.AreEqual(bounds.Max.X, stats.UVBounds.Max.X, 1e-12);
+                Assert.AreEqual(bounds.Max.Y, stats.UVBounds.Max.Y, 1e-12);
+                Assert.AreEqual(mesh.ComputeUVArea(), stats.UVArea, 1e-9);
+                Assert.AreEqual(mesh.SurfaceArea(), stats.Area, 1e-9 * stats.Area);
+                Assert.IsFalse(stats.Rescaled);
+            }
+        }
+
+        //rescales a copy of mesh with managed and mesh itself with native, checks they agree and returns native stats
+        private static MeshUVStats AssertRescaleMatches(Mesh mesh, Action<Mesh> managed, Func<Mesh, MeshUVStats> native)
+        {
+            var original = new Mesh(mesh);
+            var expected = new Mesh(mesh);
+            managed(expected);
+            var stats = native(mesh);
+            bool changed = false;
+            for (int i = 0; i < mesh.Vertices.Count; i++)
+            {
+                Assert.AreEqual(expected.Vertices[i].UV.X, mesh.Vertices[i].UV.X, 1e-12);
+                Assert.AreEqual(expected.Vertices[i].UV.Y, mesh.Vertices[i].UV.Y, 1e-12);
+                changed |= expected.Vertices[i].UV != original.Vertices[i].UV;
+            }
+            Assert.AreEqual(changed, stats.Rescaled);
+            var bounds = expected.UVBounds();
+            Assert.AreEqual(bounds.Min.X, stats.UVBounds.Min.X, 1e-12);
+            Assert.AreEqual(bounds.Min.Y, stats.UVBounds.Min.Y, 1e-12);
+            Assert.AreEqual(bounds.Max.X, stats.UVBounds.Max.X, 1e-12);
+            Assert.AreEqual(bounds.Max.Y, stats.UVBounds.Max.Y, 1e-12);
+            Assert.AreEqual(expected.ComputeUVArea(), stats.UVArea, 1e-9);
+            return stats;
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void MeshUVStatsRescaleTest()
+        {
+            //maxStretch <= 0 forces isometric scaling, < 1 limits the aspect ratio and 1 leaves it free
+            //only the last mesh is within the grow threshold of target, and a threshold of 0 rescales it anyway
+            var target = BoundingBoxExtensions.CreateXY(new Vector2(0.005, 0.005), new Vector2(0.995, 0.995));
+            int res = 1024;
+            foreach (double maxStretch in new double[] { -1, 0, 0.5, 1 })
+            {
+                foreach (double growThreshold in new double[] { 0, 0.1 })
+                {
+                    var meshes = CreateUVStatsMeshes();
+                    for (int m = 0; m < meshes.Length; m++)
+                    {
+                        var stats = AssertRescaleMatches(meshes[m],
+                                                         mesh => mesh.RescaleUVs(target, maxStretch, growThreshold),
+                                                         mesh => MeshUVStats.RescaleUVs(mesh, target, maxStretch,
+                                                                                        growThreshold));
+                        Assert.AreEqual(m != meshes.Length - 1 || growThreshold <= 0, stats.Rescaled);
+                    }
+
+                    //the texture target is v flipped, which the native rescale must reproduce
+                    foreach (var mesh in CreateUVStatsMeshes())
+                    {
+                        AssertRescaleMatches(mesh,
+                                             m => m.RescaleUVsForTexture(res, res, 2, maxStretch, growThreshold),
+                                             m => MeshUVStats.RescaleUVsForTexture(m, res, res, 2, maxStretch,
+                                                                                   growThreshold));
+                    }
+                }
+            }
+        }
+
+        private static int[] GetIndices(Mesh mesh)
+        {
+            return mesh.Faces.SelectMany(f => new[] { f.P0, f.P1, f.P2 }).ToArray();
+        }
+
+        private static float[] GetFloatPositions(Mesh mesh)
+        {
+            return mesh.Vertices
+                .SelectMany(v => new[] { (float)v.Position.X, (float)v.Position.Y, (float)v.Position.Z })
+                .ToArray();
+        }
+
+        /// <summary>
+        /// Corner positions of each face, sorted so that meshes with the same faces in any order compare equal.
+        /// </summary>
+        private static List<string> FaceKeys(Mesh mesh)
+        {
+            return mesh.Faces
+                .Select(f => string.Join(" ", new[] { f.P0, f.P1, f.P2 }.Select(i => mesh.Vertices[i].Position)
+                                         .Select(p => $"{p.X:R},{p.Y:R},{p.Z:R}")))
+                .OrderBy(k => k, StringComparer.Ordinal)
+                .ToList();
+        }
+
+        /// <summary>
+        /// Asserts that each output face has the same corner positions as the input face with the same index.
+        /// </summary>
+        private static void AssertSameFaces(float[] positions, int[] indices, int[] outIndices, int[] outVertexRemap)
+        {
+            Assert.AreEqual(indices.Length, outIndices.Length);
+            for (int i = 0; i < indices.Length; i++)
+            {
+                int remapped = outVertexRemap[outIndices[i]];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    Assert.AreEqual(positions[3 * indices[i] + axis], positions[3 * remapped + axis]);
+                }
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasInterleavedTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            int numVertices = mesh.Vertices.Count;
+            var success = UVAtlasNET.UVAtlas.ReturnCode.SUCCESS;
+
+            var xs = Enumerable.Range(0, numVertices).Select(i => positions[3 * i]).ToArray();
+            var ys = Enumerable.Range(0, numVertices).Select(i => positions[3 * i + 1]).ToArray();
+            var zs = Enumerable.Range(0, numVertices).Select(i => positions[3 * i + 2]).ToArray();
+            Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(xs, ys, zs, indices, out float[] u, out float[] v,
+                                                              out int[] outIndices, out int[] remap));
+            AssertSameFaces(positions, indices, outIndices, remap);
+
+            //interleaved positions are read in place, and give the same atlas as the per-axis copies
+            Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] interleavedU,
+                                                              out float[] interleavedV, out int[] interleavedIndices,
+                                                              out int[] interleavedRemap));
+            CollectionAssert.AreEqual(u, interleavedU);
+            CollectionAssert.AreEqual(v, interleavedV);
+            CollectionAssert.AreEqual(outIndices, interleavedIndices);
+            CollectionAssert.AreEqual(remap, interleavedRemap);
+
+            //so do strided positions, whose padding is skipped
+            var padded = new float[4 * numVertices];
+            for (int i = 0; i < numVertices; i++)
+            {
+                Array.Copy(positions, 3 * i, padded, 4 * i, 3);
+                padded[4 * i + 3] = float.NaN;
+            }
+            var paddedPin = GCHandle.Alloc(padded, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            try
+            {
+                Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(paddedPin.AddrOfPinnedObject(), 4 * sizeof(float),
+                                                                  UVAtlasNET.UVAtlas.PositionFormat.FLOAT3, numVertices,
+                                                                  indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                                  out float[] stridedU, out float[] stridedV,
+                                                                  out int[] stridedIndices, out int[] stridedRemap));
+                CollectionAssert.AreEqual(u, stridedU);
+                CollectionAssert.AreEqual(v, stridedV);
+                CollectionAssert.AreEqual(outIndices, stridedIndices);
+                CollectionAssert.AreEqual(remap, stridedRemap);
+            }
+            finally
+            {
+                paddedPin.Free();
+                indicesPin.Free();
+            }
+
+            //the Mesh overload keeps the faces of the mesh
+            var atlased = new Mesh(mesh);
+            Assert.IsTrue(UVAtlas.Atlas(atlased, fallbackToNaive: false));
+            AssertUVsInRange(atlased);
+            CollectionAssert.AreEqual(FaceKeys(mesh), FaceKeys(atlased));
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void CreateResultTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                     out int[] outIndices, out int[] remap));
+
+            var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            IntPtr result = IntPtr.Zero;
+            try
+            {
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                UVAtlasNET.UVAtlas.CreateResult(positionsPin.AddrOfPinnedObject(), 0,
+                                                                UVAtlasNET.UVAtlas.PositionFormat.FLOAT3,
+                                                                mesh.Vertices.Count, indicesPin.AddrOfPinnedObject(),
+                                                                indices.Length, out result));
+                UVAtlasNET.UVAtlas.GetResultSize(result, out int numVertices, out int numIndices);
+                Assert.AreEqual(u.Length, numVertices);
+                Assert.AreEqual(outIndices.Length, numIndices);
+
+                //caller arrays may be longer than the result, e.g. pooled ones, and their tails are left alone
+                int extra = 7;
+                var pooledU = Enumerable.Repeat(-1f, numVertices + extra).ToArray();
+                var pooledV = Enumerable.Repeat(-1f, numVertices + extra).ToArray();
+                var pooledIndices = Enumerable.Repeat(-1, numIndices + extra).ToArray();
+                var pooledRemap = Enumerable.Repeat(-1, numVertices + extra).ToArray();
+                UVAtlasNET.UVAtlas.CopyResult(result, pooledU, pooledV, pooledIndices, pooledRemap);
+                CollectionAssert.AreEqual(u, pooledU.Take(numVertices).ToArray());
+                CollectionAssert.AreEqual(v, pooledV.Take(numVertices).ToArray());
+                CollectionAssert.AreEqual(outIndices, pooledIndices.Take(numIndices).ToArray());
+                CollectionAssert.AreEqual(remap, pooledRemap.Take(numVertices).ToArray());
+                Assert.IsTrue(pooledU.Skip(numVertices).All(x => x == -1));
+                Assert.IsTrue(pooledIndices.Skip(numIndices).All(x => x == -1));
+
+                //null arrays are skipped
+                var onlyV = new float[numVertices];
+                UVAtlasNET.UVAtlas.CopyResult(result, null, onlyV, null, null);
+                CollectionAssert.AreEqual(v, onlyV);
+
+                //short arrays are rejected before anything is copied
+                bool threw = false;
+                try
+                {
+                    UVAtlasNET.UVAtlas.CopyResult(result, null, null, new int[numIndices - 1], null);
+                }
+                catch (ArgumentException)
+                {
+                    threw = true;
+                }
+                Assert.IsTrue(threw);
+            }
+            finally
+            {
+                UVAtlasNET.UVAtlas.DestroyResult(result);
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void ContextReuseTest()
+        {
+            //a context keeps only the capacity of its scratch memory between calls, so whatever it atlased before,
+            //successfully or not, its results are the same as those of a fresh call
+            var success = UVAtlasNET.UVAtlas.ReturnCode.SUCCESS;
+            var quality = UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY;
+            var grid = TestMeshCreator.CreateMesh(false, false, false);
+            var disconnected = CreateDisconnectedMesh();
+            IntPtr context = UVAtlasNET.UVAtlas.CreateContext();
+            try
+            {
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    foreach (var mesh in new[] { grid, disconnected, grid })
+                    {
+                        float[] positions = GetFloatPositions(mesh);
+                        int[] indices = GetIndices(mesh);
+                        var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+                        Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u,
+                                                                          out float[] v, out int[] outIndices,
+                                                                          out int[] remap, charts: charts));
+                        var reusedCharts = new UVAtlasNET.UVAtlas.ChartInfo();
+                        Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] reusedU,
+                                                                          out float[] reusedV,
+                                                                          out int[] reusedIndices,
+                                                                          out int[] reusedRemap, context: context,
+                                                                          charts: reusedCharts));
+                        CollectionAssert.AreEqual(u, reusedU);
+                        CollectionAssert.AreEqual(v, reusedV);
+                        CollectionAssert.AreEqual(outIndices, reusedIndices);
+                        CollectionAssert.AreEqual(remap, reusedRemap);
+                        CollectionAssert.AreEqual(charts.FacePartitioning, reusedCharts.FacePartitioning);
+                        Assert.AreEqual(charts.NumCharts, reusedCharts.NumCharts);
+                        Assert.AreEqual(charts.Stretch, reusedCharts.Stretch);
+                    }
+
+                    //two charts can't be had with maxCharts = 1, and the failure leaves nothing behind either
+                    Assert.AreNotEqual(success,
+                                       UVAtlasNET.UVAtlas.Atlas(GetFloatPositions(disconnected),
+                                                                GetIndices(disconnected), out float[] failedU,
+                                                                out float[] failedV, out int[] failedIndices,
+                                                                out int[] failedRemap, maxCharts: 1, quality: quality,
+                                                                context: context));
+                }
+            }
+            finally
+            {
+                UVAtlasNET.UVAtlas.DestroyContext(context);
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void PhaseStatsTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            var progressed = new bool[UVAtlasNET.UVAtlas.NUM_PHASES];
+            var control = new UVAtlasNET.UVAtlas.AtlasControl();
+            control.Progress = (phase, pct) => progressed[(int)phase] = true;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                //each call refills every phase, including the output phase timed by the wrapper
+                for (int i = 0; i < UVAtlasNET.UVAtlas.NUM_PHASES; i++)
+                {
+                    control.Phases[i] = new UVAtlasNET.UVAtlas.PhaseStats();
+                }
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                         out int[] outIndices, out int[] remap, control: control));
+                for (int i = 0; i < UVAtlasNET.UVAtlas.NUM_PHASES; i++)
+                {
+                    var stats = control.Phases[i];
+                    Assert.IsTrue(stats.wallSec >= 0);
+                    Assert.IsTrue(stats.privateBytes > 0);
+                    Assert.IsTrue(stats.peakWorkingSetBytes > 0);
+                    Assert.IsTrue(stats.peakPrivateBytes >= stats.privateBytes);
+                }
+            }
+            Assert.IsTrue(progressed[(int)UVAtlasNET.UVAtlas.Phase.PARTITION]);
+        }
+
+        private static bool CachedAtlas(float[] positions, int[] indices, string cacheDir, float maxStretch,
+                                        out float[] u, out float[] v, out int[] outIndices, out int[] remap)
+        {
+            //a cache hit skips partitioning, so it never reports partition progress
+            bool partitioned = false;
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { CacheDir = cacheDir };
+            control.Progress = (phase, pct) => partitioned |= phase == UVAtlasNET.UVAtlas.Phase.PARTITION;
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out u, out v, out outIndices, out remap,
+                                                     maxStretch: maxStretch, control: control));
+            return !partitioned;
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void AtlasCacheTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            string cacheDir = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N"));
+            try
+            {
+                Assert.IsFalse(CachedAtlas(positions, indices, cacheDir, 0.1666f,
+                                           out float[] u, out float[] v, out int[] outIndices, out int[] remap));
+                var files = Directory.GetFiles(cacheDir, "*.uvatlas");
+                Assert.AreEqual(1, files.Length);
+                var entry = File.ReadAllBytes(files[0]);
+
+                //an identical call is served from the cache with the same result
+                Assert.IsTrue(CachedAtlas(positions, indices, cacheDir, 0.1666f, out float[] hitU, out float[] hitV,
+                                          out int[] hitIndices, out int[] hitRemap));
+                CollectionAssert.AreEqual(u, hitU);
+                CollectionAssert.AreEqual(v, hitV);
+                CollectionAssert.AreEqual(outIndices, hitIndices);
+                CollectionAssert.AreEqual(remap, hitRemap);
+
+                //a different parameter or input is a different key
+                Assert.IsFalse(CachedAtlas(positions, indices, cacheDir, 0.25f,
+                                           out hitU, out hitV, out hitIndices, out hitRemap));
+                var moved = positions.Select(p => p + 1).ToArray();
+                Assert.IsFalse(CachedAtlas(moved, indices, cacheDir, 0.1666f,
+                                           out hitU, out hitV, out hitIndices, out hitRemap));
+                Assert.AreEqual(3, Directory.GetFiles(cacheDir, "*.uvatlas").Length);
+
+                //truncated and corrupt entries are misses which are recomputed and rewritten
+                var truncated = new byte[entry.Length / 2];
+                Array.Copy(entry, truncated, truncated.Length);
+                var badRemap = (byte[])entry.Clone();
+                int remapOffset = 6 * sizeof(int) + 2 * sizeof(float) * remap.Length;
+                BitConverter.GetBytes(int.MaxValue).CopyTo(badRemap, remapOffset);
+                var badChart = (byte[])entry.Clone();
+                BitConverter.GetBytes(-1).CopyTo(badChart, badChart.Length - sizeof(int));
+                foreach (var bad in new[] { truncated, badRemap, badChart })
+                {
+                    File.WriteAllBytes(files[0], bad);
+                    Assert.IsFalse(CachedAtlas(positions, indices, cacheDir, 0.1666f,
+                                               out hitU, out hitV, out hitIndices, out hitRemap));
+                    CollectionAssert.AreEqual(u, hitU);
+                    CollectionAssert.AreEqual(v, hitV);
+                    CollectionAssert.AreEqual(outIndices, hitIndices);
+                    CollectionAssert.AreEqual(remap, hitRemap);
+                    CollectionAssert.AreEqual(entry, File.ReadAllBytes(files[0]));
+                }
+            }
+            finally
+            {
+                if (Directory.Exists(cacheDir))
+                {
+                    Directory.Delete(cacheDir, true);
+                }
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void ChartInfoTest()
+        {
+            foreach (var mesh in new[] { TestMeshCreator.CreateMesh(false, false, false), CreateDisconnectedMesh() })
+            {
+                float[] positions = GetFloatPositions(mesh);
+                int[] indices = GetIndices(mesh);
+                var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                         out int[] outIndices, out int[] remap, charts: charts));
+
+                //every output face has a chart, and every chart has a face
+                Assert.IsTrue(charts.NumCharts > 0);
+                Assert.IsTrue(charts.Stretch >= 0 && !float.IsNaN(charts.Stretch));
+                Assert.AreEqual(outIndices.Length / 3, charts.FacePartitioning.Length);
+                Assert.IsTrue(charts.FacePartitioning.All(c => c >= 0 && c < charts.NumCharts));
+                Assert.AreEqual(charts.NumCharts, charts.FacePartitioning.Distinct().Count());
+
+                //the two phase API reports the same charts
+                var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+                var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+                try
+                {
+                    Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                    UVAtlasNET.UVAtlas.CreateResult(positionsPin.AddrOfPinnedObject(), 0,
+                                                                    UVAtlasNET.UVAtlas.PositionFormat.FLOAT3,
+                                                                    mesh.Vertices.Count,
+                                                                    indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                                    out IntPtr result));
+                    var facePartitioning = new int[charts.FacePartitioning.Length];
+                    UVAtlasNET.UVAtlas.GetResultCharts(result, out float stretch, out int numCharts,
+                                                       facePartitioning);
+                    UVAtlasNET.UVAtlas.DestroyResult(result);
+                    Assert.AreEqual(charts.Stretch, stretch);
+                    Assert.AreEqual(charts.NumCharts, numCharts);
+                    CollectionAssert.AreEqual(charts.FacePartitioning, facePartitioning);
+                }
+                finally
+                {
+                    positionsPin.Free();
+                    indicesPin.Free();
+                }
+
+                //so does the Mesh overload, per mesh face
+                var stats = new UVAtlas.AtlasStats();
+                Assert.IsTrue(UVAtlas.Atlas(new Mesh(mesh), fallbackToNaive: false, stats: stats));
+                Assert.AreEqual(charts.NumCharts, stats.NumCharts);
+                Assert.AreEqual(mesh.Faces.Count, stats.FaceCharts.Length);
+                Assert.IsTrue(stats.FaceCharts.All(c => c >= 0 && c < stats.NumCharts));
+            }
+
+            //faces that don't touch can't share a chart
+            var disconnected = new UVAtlasNET.UVAtlas.ChartInfo();
+            var disconnectedMesh = CreateDisconnectedMesh();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(GetFloatPositions(disconnectedMesh), GetIndices(disconnectedMesh),
+                                                     out float[] du, out float[] dv, out int[] dIndices,
+                                                     out int[] dRemap, charts: disconnected));
+            Assert.IsTrue(disconnected.NumCharts >= 2);
+            Assert.AreNotEqual(disconnected.FacePartitioning[0], disconnected.FacePartitioning[1]);
+        }
+
+        /// <summary>
+        /// Adjacency from shared vertex indices, in the layout UVAtlas expects: the face across the edge from corner
+        /// k to corner k + 1 of each face, or -1 for none.
+        /// </summary>
+        private static int[] ComputeAdjacency(int[] indices)
+        {
+            var edgeFaces = new Dictionary<long, List<int>>();
+            Func<int, int, long> edgeKey = (a, b) => ((long)Math.Min(a, b) << 32) | (uint)Math.Max(a, b);
+            for (int i = 0; i < indices.Length; i++)
+            {
+                long key = edgeKey(indices[i], indices[i - i % 3 + (i + 1) % 3]);
+                if (!edgeFaces.ContainsKey(key))
+                {
+                    edgeFaces[key] = new List<int>();
+                }
+                edgeFaces[key].Add(i / 3);
+            }
+            var adjacency = new int[indices.Length];
+            for (int i = 0; i < indices.Length; i++)
+            {
+                var faces = edgeFaces[edgeKey(indices[i], indices[i - i % 3 + (i + 1) % 3])];
+                adjacency[i] = faces.Count == 2 ? faces[0] + faces[1] - i / 3 : -1;
+            }
+            return adjacency;
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void SuppliedAdjacencyTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            int[] adjacency = ComputeAdjacency(indices);
+            Assert.IsTrue(adjacency.Any(f => f < 0));
+
+            //supplied adjacency is the same topology that welded input implies
+            var welded = new UVAtlasNET.UVAtlas.AtlasControl() { Welded = true };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                     out int[] outIndices, out int[] remap, control: welded));
+            var supplied = new UVAtlasNET.UVAtlas.AtlasControl() { Adjacency = adjacency };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] suppliedU, out float[] suppliedV,
+                                                     out int[] suppliedIndices, out int[] suppliedRemap,
+                                                     control: supplied));
+            AssertSameFaces(positions, indices, suppliedIndices, suppliedRemap);
+            CollectionAssert.AreEqual(u, suppliedU);
+            CollectionAssert.AreEqual(v, suppliedV);
+            CollectionAssert.AreEqual(outIndices, suppliedIndices);
+            CollectionAssert.AreEqual(remap, suppliedRemap);
+
+            //a neighbor that isn't a face is rejected rather than read past the end of the faces
+            foreach (int bad in new[] { indices.Length / 3, int.MaxValue, -2 })
+            {
+                var badAdjacency = (int[])adjacency.Clone();
+                badAdjacency[7] = bad;
+                var control = new UVAtlasNET.UVAtlas.AtlasControl() { Adjacency = badAdjacency };
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.GENERATE_ADJACENCY_FAILED,
+                                UVAtlasNET.UVAtlas.Atlas(positions, indices, out u, out v, out outIndices, out remap,
+                                                         control: control));
+            }
+
+            //as is adjacency that doesn't have 3 entries per face
+            bool threw = false;
+            try
+            {
+                var control = new UVAtlasNET.UVAtlas.AtlasControl() { Adjacency = adjacency.Take(3).ToArray() };
+                UVAtlasNET.UVAtlas.Atlas(positions, indices, out u, out v, out outIndices, out remap, control: control);
+            }
+            catch (ArgumentException)
+            {
+                threw = true;
+            }
+            Assert.IsTrue(threw);
+        }
+
+        private static UVAtlasNET.UVAtlas.ReturnCode PreflightAtlas(float[] positions, int[] indices,
+                                                                    UVAtlasNET.UVAtlas.Preflight preflight,
+                                                                    out UVAtlasNET.UVAtlas.PreflightStats stats,
+                                                                    out int[] outIndices)
+        {
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { Preflight = preflight };
+            var rc = UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v, out outIndices,
+                                              out int[] remap, control: control);
+            if (rc == UVAtlasNET.UVAtlas.ReturnCode.SUCCESS)
+            {
+                Assert.IsTrue(remap.All(src => src >= 0 && src < positions.Length / 3));
+            }
+            stats = control.PreflightStats;
+            return rc;
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void PreflightTest()
+        {
+            var clean = UVAtlasNET.UVAtlas.Preflight.CLEAN;
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            int numFaces = indices.Length / 3;
+
+            //degenerate faces, with a repeated corner or collinear corners, are dropped
+            var collinear = positions.Concat(new[] { 0f, 0, 0, 1, 0, 0, 2, 0, 0 }).ToArray();
+            int n = positions.Length / 3;
+            var degenerate = indices.Concat(new[] { 0, 0, 1, 2, 3, 3, n, n + 1, n + 2 }).ToArray();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            PreflightAtlas(collinear, degenerate, clean, out var stats, out int[] outIndices));
+            Assert.AreEqual(3u, stats.degenerateFaces);
+            Assert.AreEqual(numFaces, outIndices.Length / 3);
+
+            //leaving nothing to atlas if all faces are degenerate
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SET_INDEX_FAILED,
+                            PreflightAtlas(collinear, degenerate.Skip(indices.Length).ToArray(), clean,
+                                           out stats, out outIndices));
+            Assert.AreEqual(3u, stats.degenerateFaces);
+
+            //or if they all collapse when coincident vertices are welded
+            var coincident = new float[] { 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 1, 0 };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SET_INDEX_FAILED,
+                            PreflightAtlas(coincident, new[] { 0, 2, 1, 1, 3, 0 }, UVAtlasNET.UVAtlas.Preflight.WELD,
+                                           out stats, out outIndices));
+
+            //a bowtie vertex joining two fans is split into one vertex per fan
+            var bowtie = new float[] { 0, 0, 0, 1, 0, 0, 1, 1, 0, -1, 0, 0, -1, -1, 0 };
+            int[] bowtieIndices = { 0, 1, 2, 0, 3, 4 };
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            PreflightAtlas(bowtie, bowtieIndices, clean | UVAtlasNET.UVAtlas.Preflight.BREAK_BOWTIES,
+                                           out stats, out outIndices));
+            Assert.IsTrue(stats.validateResult < 0);
+            Assert.AreEqual(1u, stats.duplicatedVertices);
+            Assert.AreEqual(2, outIndices.Length / 3);
+
+            //out of range indices are rejected whether or not preflight is on
+            var outOfRange = (int[])indices.Clone();
+            outOfRange[4] = positions.Length / 3;
+            foreach (var preflight in new[] { UVAtlasNET.UVAtlas.Preflight.NONE, clean })
+            {
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SET_INDEX_FAILED,
+                                PreflightAtlas(positions, outOfRange, preflight, out stats, out outIndices));
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void WeldTest()
+        {
+            //every face gets its own copy of its corners, as clipping can leave them
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            var split = indices.SelectMany(v => new[] { positions[3 * v], positions[3 * v + 1], positions[3 * v + 2] })
+                .ToArray();
+            var splitIndices = Enumerable.Range(0, indices.Length).ToArray();
+
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { Preflight = UVAtlasNET.UVAtlas.Preflight.WELD };
+            var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(split, splitIndices, out float[] u, out float[] v,
+                                                     out int[] outIndices, out int[] remap, control: control,
+                                                     charts: charts));
+            Assert.AreEqual((uint)(indices.Length - mesh.Vertices.Count), control.PreflightStats.weldedVertices);
+            Assert.AreEqual(0u, control.PreflightStats.degenerateFaces);
+            AssertSameFaces(split, splitIndices, outIndices, remap);
+
+            //welded, the faces chart together instead of one chart per face
+            Assert.IsTrue(charts.NumCharts < indices.Length / 3);
+            Assert.IsTrue(u.Length < split.Length / 3);
+
+            //the Mesh overload keeps the faces too
+            var splitMesh = new Mesh();
+            splitMesh.Vertices = indices.Select(i => (Vertex)mesh.Vertices[i].Clone()).ToList();
+            splitMesh.Faces = Enumerable.Range(0, indices.Length / 3).Select(f => new Face(3 * f, 3 * f + 1, 3 * f + 2))
+                .ToList();
+            Assert.IsTrue(UVAtlas.Atlas(splitMesh, fallbackToNaive: false, weld: true));
+            AssertUVsInRange(splitMesh);
+            CollectionAssert.AreEqual(FaceKeys(mesh), FaceKeys(splitMesh));
+        }
+
+        /// <summary>
+        /// Chart, source vertex and uv of each corner of each atlas output face, sorted so that results with the same
+        /// faces in any order compare equal.
+        /// </summary>
+        private static List<string> ResultFaceKeys(float[] u, float[] v, int[] outIndices, int[] outVertexRemap,
+                                                   int[] facePartitioning)
+        {
+            return Enumerable.Range(0, outIndices.Length / 3)
+                .Select(f => facePartitioning[f] + " " +
+                        string.Join(" ", Enumerable.Range(3 * f, 3).Select(i => outIndices[i])
+                                    .Select(i => $"{outVertexRemap[i]}:{u[i]:R},{v[i]:R}")))
+                .OrderBy(k => k, StringComparer.Ordinal)
+                .ToList();
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void OptimizeTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                     out int[] outIndices, out int[] remap, charts: charts));
+
+            //optimizing only reorders the faces and vertices, along with their charts
+            var control = new UVAtlasNET.UVAtlas.AtlasControl() { Optimize = true };
+            var optimizedCharts = new UVAtlasNET.UVAtlas.ChartInfo();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] optimizedU,
+                                                     out float[] optimizedV, out int[] optimizedIndices,
+                                                     out int[] optimizedRemap, control: control,
+                                                     charts: optimizedCharts));
+            Assert.AreEqual(u.Length, optimizedU.Length);
+            Assert.AreEqual(outIndices.Length, optimizedIndices.Length);
+            Assert.AreEqual(charts.NumCharts, optimizedCharts.NumCharts);
+            Assert.IsFalse(outIndices.SequenceEqual(optimizedIndices) && remap.SequenceEqual(optimizedRemap));
+            CollectionAssert.AreEqual(ResultFaceKeys(u, v, outIndices, remap, charts.FacePartitioning),
+                                      ResultFaceKeys(optimizedU, optimizedV, optimizedIndices, optimizedRemap,
+                                                     optimizedCharts.FacePartitioning));
+
+            //and so keeps the faces of a mesh
+            var optimized = new Mesh(mesh);
+            Assert.IsTrue(UVAtlas.Atlas(optimized, fallbackToNaive: false, optimize: true));
+            AssertUVsInRange(optimized);
+            CollectionAssert.AreEqual(FaceKeys(mesh), FaceKeys(optimized));
+        }
+
+        /// <summary>
+        /// Triangles that don't touch each other, so that each one becomes its own chart with three output vertices.
+        /// </summary>
+        private static void CreateSeparateTriangles(int numFaces, out float[] positions, out int[] indices)
+        {
+            positions = new float[9 * numFaces];
+            indices = Enumerable.Range(0, 3 * numFaces).ToArray();
+            for (int f = 0; f < numFaces; f++)
+            {
+                float x = 2 * (f % 150), y = 2 * (f / 150);
+                new[] { x, y, 0, x + 1, y, 0, x, y + 1, 0 }.CopyTo(positions, 9 * f);
+            }
+        }
+
+        private static UVAtlasNET.UVAtlas.ReturnCode Atlas16(float[] positions, int[] indices, out float[] u,
+                                                             out float[] v, out ushort[] outIndices16,
+                                                             out int[] outIndices32, out int[] remap,
+                                                             int size = 512)
+        {
+            var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            try
+            {
+                return UVAtlasNET.UVAtlas.Atlas(positionsPin.AddrOfPinnedObject(), 0,
+                                                UVAtlasNET.UVAtlas.PositionFormat.FLOAT3, positions.Length / 3,
+                                                indicesPin.AddrOfPinnedObject(), indices.Length,
+                                                out u, out v, out outIndices16, out outIndices32, out remap,
+                                                width: size, height: size);
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void IndexFormatTest()
+        {
+            var success = UVAtlasNET.UVAtlas.ReturnCode.SUCCESS;
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            Assert.AreEqual(success, UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                              out int[] outIndices, out int[] remap));
+
+            //small results narrow to 16 bit indices with the same values
+            var positionsPin = GCHandle.Alloc(positions, GCHandleType.Pinned);
+            var indicesPin = GCHandle.Alloc(indices, GCHandleType.Pinned);
+            try
+            {
+                Assert.AreEqual(success, UVAtlasNET.UVAtlas.CreateResult(positionsPin.AddrOfPinnedObject(), 0,
+                                                                         UVAtlasNET.UVAtlas.PositionFormat.FLOAT3,
+                                                                         mesh.Vertices.Count,
+                                                                         indicesPin.AddrOfPinnedObject(),
+                                                                         indices.Length, out IntPtr result));
+                try
+                {
+                    Assert.AreEqual(UVAtlasNET.UVAtlas.IndexFormat.R16_UINT,
+                                    UVAtlasNET.UVAtlas.GetResultIndexFormat(result));
+                    var indices16 = new ushort[outIndices.Length];
+                    Assert.IsTrue(UVAtlasNET.UVAtlas.CopyResultIndices(result, indices16));
+                    CollectionAssert.AreEqual(outIndices, indices16.Select(i => (int)i).ToArray());
+                }
+                finally
+                {
+                    UVAtlasNET.UVAtlas.DestroyResult(result);
+                }
+            }
+            finally
+            {
+                positionsPin.Free();
+                indicesPin.Free();
+            }
+
+            Assert.AreEqual(success, Atlas16(positions, indices, out float[] u16, out float[] v16,
+                                             out ushort[] outIndices16, out int[] outIndices32, out int[] remap16));
+            Assert.IsNull(outIndices32);
+            CollectionAssert.AreEqual(outIndices, outIndices16.Select(i => (int)i).ToArray());
+            CollectionAssert.AreEqual(u, u16);
+            CollectionAssert.AreEqual(v, v16);
+            CollectionAssert.AreEqual(remap, remap16);
+
+            //65535 or more output vertices fall back to 32 bit, 0xFFFF being a strip cut, and a larger texture
+            //leaves room for the gutters of so many charts
+            CreateSeparateTriangles(21844, out float[] separate, out int[] separateIndices);
+            Assert.AreEqual(success, Atlas16(separate, separateIndices, out u16, out v16, out outIndices16,
+                                             out outIndices32, out remap16, 4096));
+            Assert.AreEqual(65532, u16.Length);
+            Assert.IsNull(outIndices32);
+            Assert.AreEqual(separateIndices.Length, outIndices16.Length);
+
+            CreateSeparateTriangles(21845, out separate, out separateIndices);
+            Assert.AreEqual(success, Atlas16(separate, separateIndices, out u16, out v16, out outIndices16,
+                                             out outIndices32, out remap16, 4096));
+            Assert.AreEqual(65535, u16.Length);
+            Assert.IsNull(outIndices16);
+            Assert.AreEqual(separateIndices.Length, outIndices32.Length);
+            Assert.AreEqual(65534, outIndices32.Max());
+            AssertSameFaces(separate, separateIndices, outIndices32, remap16);
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void LowMemoryTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            foreach (bool optimize in new[] { false, true })
+            {
+                var outputs = new List<Array>();
+                foreach (bool lowMemory in new[] { false, true })
+                {
+                    //low memory drops the output positions natively, but expanding them through the remap gives
+                    //back the same vertices
+                    var control = new UVAtlasNET.UVAtlas.AtlasControl() { Optimize = optimize, LowMemory = lowMemory };
+                    var expanded = new UVAtlasNET.UVAtlas.AttributeStream();
+                    expanded.Input = positions;
+                    expanded.ComponentsPerVertex = 3;
+                    Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                    UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                             out int[] outIndices, out int[] remap, control: control,
+                                                             attributes: new[] { expanded }));
+                    AssertSameFaces(positions, indices, outIndices, remap);
+                    outputs.AddRange(new[] { u, v, outIndices, remap, expanded.Output });
+                }
+                for (int i = 0; i < outputs.Count / 2; i++)
+                {
+                    CollectionAssert.AreEqual(outputs[i], outputs[i + outputs.Count / 2]);
+                }
+            }
+
+            var lowMemoryMesh = new Mesh(mesh);
+            Assert.IsTrue(UVAtlas.Atlas(lowMemoryMesh, fallbackToNaive: false, lowMemory: true));
+            var normalMesh = new Mesh(mesh);
+            Assert.IsTrue(UVAtlas.Atlas(normalMesh, fallbackToNaive: false));
+            CollectionAssert.AreEqual(FaceKeys(normalMesh), FaceKeys(lowMemoryMesh));
+            CollectionAssert.AreEqual(normalMesh.Vertices.Select(vertex => vertex.UV).ToArray(),
+                                      lowMemoryMesh.Vertices.Select(vertex => vertex.UV).ToArray());
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void FarFromOriginTest()
+        {
+            //site frame meshes can be millions of meters from the origin, where float positions would be centimeters
+            //apart, so double positions are recentered before being narrowed and atlas the same as at the origin
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            var positions = mesh.Vertices.SelectMany(p => new[] { p.Position.X, p.Position.Y, p.Position.Z })
+                .ToArray();
+            var offset = positions.Select(p => p + 1e7).ToArray();
+            int[] indices = GetIndices(mesh);
+            var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                     out int[] outIndices, out int[] remap, charts: charts));
+            var offsetCharts = new UVAtlasNET.UVAtlas.ChartInfo();
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.Atlas(offset, indices, out float[] offsetU, out float[] offsetV,
+                                                     out int[] offsetIndices, out int[] offsetRemap,
+                                                     charts: offsetCharts));
+
+            //the centroid itself rounds differently, so the recentered positions can differ in their last bits
+            Assert.AreEqual(charts.NumCharts, offsetCharts.NumCharts);
+            Assert.AreEqual(charts.Stretch, offsetCharts.Stretch, 1e-4);
+            CollectionAssert.AreEqual(outIndices, offsetIndices);
+            CollectionAssert.AreEqual(remap, offsetRemap);
+            Assert.AreEqual(u.Length, offsetU.Length);
+            for (int i = 0; i < u.Length; i++)
+            {
+                Assert.AreEqual(u[i], offsetU[i], 1e-4);
+                Assert.AreEqual(v[i], offsetV[i], 1e-4);
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void CaptureReplayTest()
+        {
+            var mesh = TestMeshCreator.CreateMesh(false, false, false);
+            float[] positions = GetFloatPositions(mesh);
+            int[] indices = GetIndices(mesh);
+            string captureDir = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N"));
+            try
+            {
+                //successful calls are only captured when sampled
+                var control = new UVAtlasNET.UVAtlas.AtlasControl() { CaptureDir = captureDir };
+                control.Capture = UVAtlasNET.UVAtlas.Capture.FAILED;
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                UVAtlasNET.UVAtlas.Atlas(positions, indices, out float[] u, out float[] v,
+                                                         out int[] outIndices, out int[] remap, control: control));
+                Assert.IsFalse(Directory.Exists(captureDir) && Directory.GetFiles(captureDir).Length > 0);
+
+                control.Capture = UVAtlasNET.UVAtlas.Capture.SAMPLED;
+                control.CaptureSampleRate = 1;
+                var charts = new UVAtlasNET.UVAtlas.ChartInfo();
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                UVAtlasNET.UVAtlas.Atlas(positions, indices, out u, out v, out outIndices, out remap,
+                                                         control: control, charts: charts));
+                var jobs = Directory.GetFiles(captureDir, "*.uvajob");
+                Assert.AreEqual(1, jobs.Length);
+
+                //replaying the job gives the outcome it recorded
+                Assert.IsTrue(UVAtlasNET.UVAtlas.ReplayJob(jobs[0], out var recorded, out var replayed,
+                                                           out int numFaces));
+                Assert.AreEqual(indices.Length / 3, numFaces);
+                Assert.AreEqual((int)UVAtlasNET.UVAtlas.ReturnCode.SUCCESS, recorded.returnCode);
+                Assert.AreEqual((uint)u.Length, recorded.numVertices);
+                Assert.AreEqual((uint)charts.NumCharts, recorded.numCharts);
+                Assert.AreEqual(charts.Stretch, recorded.stretch);
+                Assert.IsTrue(recorded.wallSec > 0 && replayed.wallSec > 0);
+                Assert.AreEqual(recorded.returnCode, replayed.returnCode);
+                Assert.AreEqual(recorded.numVertices, replayed.numVertices);
+                Assert.AreEqual(recorded.numCharts, replayed.numCharts);
+                Assert.AreEqual(recorded.stretch, replayed.stretch);
+
+                //failures are captured with their return code, and replay the same way
+                File.Delete(jobs[0]);
+                control.Capture = UVAtlasNET.UVAtlas.Capture.FAILED;
+                var disconnected = CreateDisconnectedMesh();
+                var quality = UVAtlasNET.UVAtlas.Quality.UVATLAS_GEODESIC_QUALITY;
+                var rc = UVAtlasNET.UVAtlas.Atlas(GetFloatPositions(disconnected), GetIndices(disconnected),
+                                                  out u, out v, out outIndices, out remap, maxCharts: 1,
+                                                  quality: quality, control: control);
+                Assert.AreNotEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS, rc);
+                jobs = Directory.GetFiles(captureDir, "*.uvajob");
+                Assert.AreEqual(1, jobs.Length);
+                Assert.IsTrue(UVAtlasNET.UVAtlas.ReplayJob(jobs[0], out recorded, out replayed, out numFaces));
+                Assert.AreEqual(2, numFaces);
+                Assert.AreEqual((int)rc, recorded.returnCode);
+                Assert.AreEqual(recorded.returnCode, replayed.returnCode);
+
+                //and a file that isn't a job can't be replayed
+                File.WriteAllBytes(jobs[0], new byte[] { 1, 2, 3 });
+                Assert.IsFalse(UVAtlasNET.UVAtlas.ReplayJob(jobs[0], out recorded, out replayed, out numFaces));
+            }
+            finally
+            {
+                if (Directory.Exists(captureDir))
+                {
+                    Directory.Delete(captureDir, true);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Unit square at x offset in the z = 0 plane as two triangles, with uvs spanning [minU, maxU] x [minV, maxV].
+        /// </summary>
+        private static UVAtlasNET.UVAtlas.BakeMesh CreateBakeSquare(double x, double minU, double maxU, double minV,
+                                                                    double maxV)
+        {
+            return new UVAtlasNET.UVAtlas.BakeMesh()
+            {
+                Positions = new[] { x, 0, 0, x + 1, 0, 0, x + 1, 1, 0, x, 1, 0 },
+                UVs = new[] { minU, minV, maxU, minV, maxU, maxV, minU, maxV },
+                Indices = new[] { 0, 1, 2, 0, 2, 3 }
+            };
+        }
+
+        private static UVAtlasNET.UVAtlas.BakeImage CreateBakeImage(int width, int height, float value)
+        {
+            var band = Enumerable.Repeat(value, width * height).ToArray();
+            return new UVAtlasNET.UVAtlas.BakeImage() { Bands = new[] { band }, Width = width, Height = height };
+        }
+
+        private static UVAtlasNET.UVAtlas.BakeMesh MergeBakeMeshes(params UVAtlasNET.UVAtlas.BakeMesh[] meshes)
+        {
+            var merged = new UVAtlasNET.UVAtlas.BakeMesh();
+            merged.Positions = meshes.SelectMany(m => m.Positions).ToArray();
+            merged.UVs = meshes.SelectMany(m => m.UVs).ToArray();
+            var indices = new List<int>();
+            int numVertices = 0;
+            foreach (var mesh in meshes)
+            {
+                indices.AddRange(mesh.Indices.Select(i => i + numVertices));
+                numVertices += mesh.Positions.Length / 3;
+            }
+            merged.Indices = indices.ToArray();
+            return merged;
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void BakerTest()
+        {
+            //two sources side by side with constant images, which bicubic sampling reproduces exactly
+            var sourceA = new UVAtlasNET.UVAtlas.BakeSource()
+            {
+                Mesh = CreateBakeSquare(0, 0, 1, 0, 1),
+                Image = CreateBakeImage(8, 8, 10),
+                Index = CreateBakeImage(8, 8, 1)
+            };
+            var sourceB = new UVAtlasNET.UVAtlas.BakeSource()
+            {
+                Mesh = CreateBakeSquare(2, 0, 1, 0, 1),
+                Image = CreateBakeImage(4, 4, 20),
+                Index = CreateBakeImage(4, 4, 2)
+            };
+
+            //the dest has the same squares packed into two strips of its texture with padding around them, texel
+            //(c, r) sampling uv (c / 16, 1 - r / 8), so columns 1-4 and 9-12 of rows 1-7 are inside the strips
+            const int width = 16, height = 8;
+            var dest = MergeBakeMeshes(CreateBakeSquare(0, 0.01, 0.3, 0.01, 0.99),
+                                       CreateBakeSquare(2, 0.51, 0.8, 0.01, 0.99));
+            Func<int, int, int> expectedSource = (r, c) =>
+                r < 1 ? -1 : c >= 1 && c <= 4 ? 0 : c >= 9 && c <= 12 ? 1 : -1;
+
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.CreateBaker(new[] { sourceA, sourceB }, out var baker));
+            using (baker)
+            {
+                foreach (int maxThreads in new[] { 1, 0 })
+                {
+                    var image = CreateBakeImage(width, height, -1);
+                    var index = CreateBakeImage(width, height, -1);
+                    var coverage = Enumerable.Repeat((byte)7, width * height).ToArray();
+                    Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                    baker.Bake(dest, image, index, coverage, maxThreads));
+                    for (int r = 0; r < height; r++)
+                    {
+                        for (int c = 0; c < width; c++)
+                        {
+                            int texel = r * width + c, source = expectedSource(r, c);
+                            Assert.AreEqual(source >= 0 ? 1 : 0, coverage[texel]);
+                            //padding is left as it was for dilation to fill
+                            Assert.AreEqual(source < 0 ? -1 : source == 0 ? 10 : 20, image.Bands[0][texel]);
+                            Assert.AreEqual(source < 0 ? -1 : source + 1, index.Bands[0][texel]);
+                        }
+                    }
+                }
+
+                //an index of another size can't be baked, but the image still is
+                var unbakedImage = CreateBakeImage(width, height, -1);
+                var smallIndex = CreateBakeImage(width / 2, height, -1);
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.NO_INDEX, baker.Bake(dest, unbakedImage, smallIndex));
+                Assert.AreEqual(10, unbakedImage.Bands[0][width + 1]);
+                Assert.IsTrue(smallIndex.Bands[0].All(i => i == -1));
+            }
+
+            //as is an index when a source has none
+            sourceB.Index = null;
+            Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                            UVAtlasNET.UVAtlas.CreateBaker(new[] { sourceA, sourceB }, out baker));
+            using (baker)
+            {
+                var image = CreateBakeImage(width, height, -1);
+                var index = CreateBakeImage(width, height, -1);
+                Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.NO_INDEX, baker.Bake(dest, image, index));
+                Assert.AreEqual(10, image.Bands[0][width + 1]);
+                Assert.AreEqual(20, image.Bands[0][width + 9]);
+                Assert.IsTrue(index.Bands[0].All(i => i == -1));
+            }
+        }
+
+        [TestMethod]
+        [DeploymentItem("UVAtlasLib_x32.dll")]
+        [DeploymentItem("UVAtlasLib_x64.dll")]
+        public void DilateTest()
+        {
+            //a width that isn't a multiple of the 4 lanes, so the scalar tails run, and wide enough for several strips
+            const int width = 133, height = 37;
+            var random = new Random(1);
+            var covered = Enumerable.Range(0, width * height).Select(t => random.Next(40) == 0).ToArray();
+            int numCovered = covered.Count(c => c);
+            Assert.IsTrue(numCovered > 0 && numCovered < width * height);
+
+            //covered texels hold their own index, plus one, in every band of both images
+            Func<List<UVAtlasNET.UVAtlas.BakeImage>> createImages = () =>
+            {
+                var ids = Enumerable.Range(0, width * height).Select(t => covered[t] ? t + 1f : -1).ToArray();
+                return new List<UVAtlasNET.UVAtlas.BakeImage>()
+                {
+                    new UVAtlasNET.UVAtlas.BakeImage() { Bands = new[] { ids }, Width = width, Height = height },
+                    new UVAtlasNET.UVAtlas.BakeImage()
+                    {
+                        Bands = new[] { ids.Select(id => 10 * id).ToArray(), ids.Select(id => 100 * id).ToArray() },
+                        Width = width, Height = height
+                    }
+                };
+            };
+            Func<int, int, double> dist2 = (a, b) =>
+                Math.Pow(a % width - b % width, 2) + Math.Pow(a / width - b / width, 2);
+            var coveredTexels = Enumerable.Range(0, width * height).Where(t => covered[t]).ToArray();
+            var nearest2 = Enumerable.Range(0, width * height).Select(t => coveredTexels.Min(s => dist2(t, s)))
+                .ToArray();
+
+            foreach (int radius in new[] { 3, 10, -1, 0 })
+            {
+                List<UVAtlasNET.UVAtlas.BakeImage> expected = null;
+                foreach (int maxThreads in new[] { 1, 8 })
+                {
+                    var images = createImages();
+                    var coverage = covered.Select(c => c ? (byte)1 : (byte)0).ToArray();
+                    Assert.AreEqual(UVAtlasNET.UVAtlas.ReturnCode.SUCCESS,
+                                    UVAtlasNET.UVAtlas.Dilate(images, coverage, radius, maxThreads));
+                    for (int t = 0; t < width * height; t++)
+                    {
+                        //exactly the texels within radius are filled, each from one of its nearest covered texels
+                        bool filled = !covered[t] && radius != 0 && (radius < 0 || nearest2[t] <= radius * radius);
+                        float id = images[0].Bands[0][t];
+                        Assert.AreEqual(covered[t] || filled ? 1 : 0, coverage[t]);
+                        if (filled)
+                        {
+                            int source = (int)id - 1;
+                            Assert.IsTrue(source >= 0 && covered[source]);
+                            Assert.AreEqual(nearest2[t], dist2(t, source));
+                        }
+                        else if (!covered[t])
+                        {
+                            Assert.AreEqual(-1, id);
+                        }
+                        //all bands of all images are copied from the same texel
+                        Assert.AreEqual(10 * id, images[1].Bands[0][t]);
+                        Assert.AreEqual(100 * id, images[1].Bands[1][t]);
+                    }
+
+                    //and the threads only split the work
+                    if (expected == null)
+                    {
+                        expected = images;
+                    }
+                    else
+                    {
+                        for (int i = 0; i < images.Count; i++)
+                        {
+                            for (int b = 0; b < images[i].Bands.Length; b++)
+                            {
+                                CollectionAssert.AreEqual(expected[i].Bands[b], images[i].Bands[b]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
     }
 }
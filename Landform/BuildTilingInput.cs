@@ -1379,7 +1379,10 @@ namespace JPLOPS.Landform
             //it used to be the case that it was a perf win to build the tiles serially at least when backprojecting
             //but probably not anymore
             //now that PipelineCore implements locking to prevent multiple threads from trying to load the same image
-            CoreLimitedParallel.ForEachNoPartition(tilesToTexture.OrderByDescending(t => t.Name), textureAndSaveTile);
+            using (bakeClipper) //null unless baking
+            {
+                CoreLimitedParallel.ForEachNoPartition(tilesToTexture.OrderByDescending(t => t.Name), textureAndSaveTile);
+            }
 
             if (withTextures && nf > 0)
             {
@@ -124,7 +124,7 @@ namespace JPLOPS.Landform
 
             if (!UVAtlas.Atlas(mesh, resolution, resolution, gcopts.MaxTextureCharts,
                                maxTextureStretch, logger: pipeline, fallbackToNaive: false,
-                               maxSec: gcopts.MaxUVAtlasSec))
+                               maxSec: gcopts.MaxUVAtlasSec, lowMemory: mesh.Faces.Count > UVATLAS_WARN_THRESHOLD))
             {
                 pipeline.LogWarn("failed to atlas {0}mesh with UVAtlas, falling back to heightmap atlas",
                                  !string.IsNullOrEmpty(name) ? (name + " ") : "", Fmt.KMG(mesh.Faces.Count));
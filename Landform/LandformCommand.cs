@@ -45,6 +45,18 @@ namespace JPLOPS.Landform
 
         [Option(HelpText = "Don't periodically force garbage collection", Default = false)]
         public bool NoForceCollect { get; set; }
+
+        [Option(HelpText = "Directory to cache UVAtlas results across runs, or omit to disable", Default = null)]
+        public string UVAtlasCacheDir { get; set; }
+
+        [Option(HelpText = "Directory to capture inputs of failed or slow UVAtlas calls for offline replay, or omit to disable", Default = null)]
+        public string UVAtlasCaptureDir { get; set; }
+
+        [Option(HelpText = "Capture UVAtlas calls slower than this many seconds, if UVAtlasCaptureDir is set", Default = 60)]
+        public double UVAtlasCaptureSlowSec { get; set; }
+
+        [Option(HelpText = "Also capture this random fraction of UVAtlas calls, if UVAtlasCaptureDir is set", Default = 0)]
+        public double UVAtlasCaptureSampleRate { get; set; }
     }
 
     public class LandformCommand
@@ -84,6 +96,20 @@ namespace JPLOPS.Landform
 
             PDSSerializer.DataPath = pipeline.PDSDataPath;
             MeshSerializer.Logger = pipeline;
+
+            if (!string.IsNullOrEmpty(lcopts.UVAtlasCacheDir))
+            {
+                Directory.CreateDirectory(lcopts.UVAtlasCacheDir);
+                UVAtlas.CacheDir = lcopts.UVAtlasCacheDir;
+            }
+
+            if (!string.IsNullOrEmpty(lcopts.UVAtlasCaptureDir))
+            {
+                Directory.CreateDirectory(lcopts.UVAtlasCaptureDir);
+                UVAtlas.CaptureDir = lcopts.UVAtlasCaptureDir;
+                UVAtlas.CaptureSlowSec = lcopts.UVAtlasCaptureSlowSec;
+                UVAtlas.CaptureSampleRate = lcopts.UVAtlasCaptureSampleRate;
+            }
         }
 
         protected void StartStopwatch()
@@ -1538,7 +1538,6 @@ namespace JPLOPS.Landform
                 obsToHull = obsToHull,
 
                 mesh = mesh,
-                meshOp = new MeshOperator(mesh, buildFaceTree: false, buildVertexTree: false, buildUVFaceTree: true),
                 meshFrame = meshFrame,
 
                 meshCaster = meshCaster,
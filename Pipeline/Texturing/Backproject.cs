@@ -439,7 +439,8 @@ namespace JPLOPS.Pipeline
             {
                 //inpaint the gutter more, possibly completely if inpaintGutter < 0
                 //this can be important for proper behavior of texture minification
-                outputImage.Inpaint(inpaintGutter, preserveMask: false);
+                //the only masked pixels left are gutter, which is padded natively from the nearest chart pixel
+                UVBaker.Dilate(outputImage, inpaintGutter);
             }
 
             return stats;
@@ -459,7 +460,6 @@ namespace JPLOPS.Pipeline
 
             public Mesh mesh; //mesh from which to collect sample points to backproject
             public ConvexHull meshHull; //in mesh frame
-            public MeshOperator meshOp; //only uv face tree required
             public string meshFrame;
 
             public SceneCaster meshCaster;     //for ray casting the active mesh, may be same as occlusionScene
@@ -537,7 +537,8 @@ namespace JPLOPS.Pipeline
 
             int resolution = opts.outputResolution;
             info($"collecting sample points from mesh to {resolution}x{resolution} destination texture");
-            List<PixelPoint> samplePoints = opts.meshOp.SampleUVSpace(resolution, resolution);
+            List<PixelPoint> samplePoints =
+                UVSampler.Sample(opts.mesh, resolution, resolution).ToPixelPoints();
             int np = samplePoints.Count;
             info($"collected {Fmt.KMG(np)} sample points");
 
@@ -43,19 +43,30 @@ namespace JPLOPS.Pipeline
                 NumTris = mesh.Faces.Count;
                 if (NumTris > 0)
                 {
-                    MinTriArea = double.PositiveInfinity;
-                    MaxTriArea = double.NegativeInfinity;
-                    foreach (var tri in mesh.Triangles())
+                    //the native pass fails on e.g. NaN areas, which the managed sums below report as before
+                    MeshUVStats stats = null;
+                    if (mesh.HasUVs)
                     {
-                        double a = tri.Area();
-                        MeshArea += a;
-                        MinTriArea = Math.Min(MinTriArea, a);
-                        MaxTriArea = Math.Max(MaxTriArea, a);
+                        try
+                        {
+                            stats = MeshUVStats.Compute(mesh);
+                        }
+                        catch (ArgumentException)
+                        {
+                            stats = null;
+                        }
+                    }
+                    if (stats != null)
+                    {
+                        MeshArea = stats.Area;
+                        UVArea = stats.UVArea;
+                        MinTriArea = stats.MinFaceArea;
+                        MaxTriArea = stats.MaxFaceArea;
+                    }
+                    else
+                    {
+                        UpdateAreas(mesh);
                     }
-                }
-                if (mesh.HasUVs)
-                {
-                    UVArea = mesh.ComputeUVArea();
                 }
             }
 
@@ -68,6 +79,24 @@ namespace JPLOPS.Pipeline
             HasIndex = index != null;
         }
 
+        private void UpdateAreas(Mesh mesh)
+        {
+            MeshArea = 0;
+            MinTriArea = double.PositiveInfinity;
+            MaxTriArea = double.NegativeInfinity;
+            foreach (var tri in mesh.Triangles())
+            {
+                double a = tri.Area();
+                MeshArea += a;
+                MinTriArea = Math.Min(MinTriArea, a);
+                MaxTriArea = Math.Max(MaxTriArea, a);
+            }
+            if (mesh.HasUVs)
+            {
+                UVArea = mesh.ComputeUVArea();
+            }
+        }
+
         public void Clear()
         {
             NumVerts = NumTris = 0;
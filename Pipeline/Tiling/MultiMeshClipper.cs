@@ -14,8 +14,9 @@ namespace JPLOPS.Pipeline
     /// a single mesh represeting the merged geometry of the clipped input meshes.  Depending on
     /// the method used, a single output texture can also be generated that combines input textures
     /// from all of the source image products.  Both texture baking and atlas clipping / repacking are supported.
+    /// Dispose to release the texture baker, if any.
     /// </summary>
-    public class MultiMeshClipper
+    public class MultiMeshClipper : IDisposable
     {
         public BoundingBox TotalBounds { get; private set; }
 
@@ -71,6 +72,15 @@ namespace JPLOPS.Pipeline
             }
         }
 
+        public void Dispose()
+        {
+            if (textureBaker != null)
+            {
+                textureBaker.Dispose();
+                textureBaker = null;
+            }
+        }
+
         public MeshOperator[] GetMeshOps()
         {
             return inputs.Select(mip => mip.MeshOp).ToArray();
@@ -344,8 +344,10 @@ namespace JPLOPS.Pipeline
                     {
                         info($"atlassing {tileType}parent tile with UVAtlas, resolution {textureSize}, " +
                              $"max stretch {project.MaxTextureStretch}");
+                        var atlasStats = new UVAtlas.AtlasStats();
                         if (!UVAtlas.Atlas(parentMesh, textureSize, textureSize, maxStretch: project.MaxTextureStretch,
-                                           logger: logger, fallbackToNaive: false, maxSec: project.MaxUVAtlasSec))
+                                           logger: logger, fallbackToNaive: false, maxSec: project.MaxUVAtlasSec,
+                                           stats: atlasStats, optimize: true))
                         {
                             warn($"failed to atlas {tileType}parent tile with UVAtlas, falling back to heightmap");
                             parentMesh.HeightmapAtlas(upAxis ?? Vector3.UnitZ, swapUV: true);
@@ -353,6 +355,8 @@ namespace JPLOPS.Pipeline
                         }
                         else
                         {
+                            info($"atlassed {tileType}parent tile with UVAtlas: {atlasStats.NumCharts} charts, " +
+                                 $"stretch {atlasStats.Stretch:F3}");
                             numUVatlas++;
                         }
                         break;
@@ -427,12 +431,14 @@ namespace JPLOPS.Pipeline
                 }
                 else
                 {
-                    parentMesh.RescaleUVsForTexture(textureSize, textureSize, project.MaxTextureStretch);
+                    MeshUVStats.RescaleUVsForTexture(parentMesh, textureSize, textureSize, project.MaxTextureStretch);
                     //we need to bake parent tile textures even when textureMode is Clip
                     //unless we also have a texture projector to assign appropriate UVs
                     info($"baking {textureSize}x{textureSize} parent tile texture");
-                    var tb = new TextureBaker(depMeshImagePairs);
-                    parentImg = tb.Bake(parentMesh, textureSize, textureSize, out parentIndex);
+                    using (var tb = new TextureBaker(depMeshImagePairs))
+                    {
+                        parentImg = tb.Bake(parentMesh, textureSize, textureSize, out parentIndex);
+                    }
                     //note that if textureMode is clip then leaf tile textures may have actually been clipped
                     //even though we are baking here
                     //because leave tiles can take their UVs from the input meshes
@@ -654,11 +660,14 @@ namespace JPLOPS.Pipeline
             if (useTextureError && mip.Image != null)
             {
                 double mult = TilingDefaults.TEXTURE_ERROR_MULTIPLIER;
-                double pixelArea = mip.Mesh.ComputePixelArea(mip.Image);
+                //surface and pixel area in one pass
+                var uvStats = mip.Mesh.HasUVs && mip.Mesh.HasFaces ?
+                    MeshUVStats.Compute(mip.Mesh, mip.Image.Width, mip.Image.Height) : null;
+                double pixelArea = uvStats != null ? uvStats.PixelArea : 0;
                 double surfaceArea = -1;
                 if (pixelArea > 0)
                 {
-                    surfaceArea = mip.Mesh.SurfaceArea();
+                    surfaceArea = uvStats.Area;
                     textureError = mult * Math.Sqrt(surfaceArea / pixelArea);
                 }
                 info($"{node.Name} texture error {textureError:F3}" +
@@ -1,56 +1,27 @@
 ﻿using JPLOPS.Geometry;
 using JPLOPS.Imaging;
 using System;
-using System.Collections.Generic;
 using System.Linq;
-using Microsoft.Xna.Framework;
 
 namespace JPLOPS.Pipeline
 {
     /// <summary>
-    /// Container for Triangle that also stores its corresponding texture
+    /// Bakes the textures of a set of source meshes onto the UVs of destination meshes
+    /// Each destination pixel takes the texture at the closest point on any source mesh
+    /// The sources are indexed once in a native BVH and each bake is rasterized natively in parallel rows
+    /// Dispose to release the native index and the pinned source images
     /// </summary>
-    public class TexturedTriangle : OctreeNodeContents
+    public class TextureBaker : IDisposable
     {
-        public readonly Triangle tri;
-        public readonly Image texture;
-        public readonly Image index;
+        private UVBaker baker;
 
-        public TexturedTriangle(Triangle tri, Image texture, Image index)
-        {
-            this.tri = tri;
-            this.texture = texture;
-            this.index = index;
-        }
-
-        public BoundingBox Bounds()
-        {
-            return tri.Bounds();
-        }
-
-        public bool Intersects(BoundingBox other)
-        {
-            return this.Bounds().Intersects(other);
-        }
-
-        public double SquaredDistance(Vector3 xyz)
-        {
-            return this.tri.SquaredDistance(xyz);
-        }
-    }
-
-    public class TextureBaker
-    {
-        private Octree triOctTree;
-        private int destBands;
-
-        public TextureBaker(MeshImagePair[] source, int maxNodeSize = 10, int maxDepth = 14)
+        public TextureBaker(MeshImagePair[] source)
         {
             if (source.Count() == 0)
             {
                 throw new ArgumentException("source list cannot be empty");
             }
-            destBands = source[0].Image.Bands;
+            int destBands = source[0].Image.Bands;
             if (source.Any(s => s.Image.Bands != destBands))
             {
                 throw new ArgumentException("all source images must have identical number of bands");
@@ -59,24 +30,13 @@ namespace JPLOPS.Pipeline
             {
                 throw new ArgumentException("all source images must have UVs");
             }
-            // Get union bounding box of source meshes
-            List<BoundingBox> boxes = new List<BoundingBox>();
-            foreach (MeshImagePair pair in source)
-            {
-                boxes.Add(pair.Mesh.Bounds());
-            }
-            BoundingBox finalBox = BoundingBoxExtensions.Union(boxes.ToArray());
-            // construct oct tree on source meshes
-            this.triOctTree = new Octree(finalBox, maxOctreeNodeSize: maxNodeSize, maxDepth: maxDepth);
-            for (int i = 0; i < source.Count(); i++)
-            {                
-                List<OctreeNodeContents> insertList = new List<OctreeNodeContents>();
-                foreach (Triangle tri in source[i].Mesh.Triangles())
-                {
-                    insertList.Add(new TexturedTriangle(tri, source[i].Image, source[i].Index));
-                }
-                triOctTree.InsertList(insertList);
-            }
+            baker = new UVBaker(source.Select(s => s.Mesh).ToList(), source.Select(s => s.Image).ToList(),
+                                source.Select(s => s.Index).ToList());
+        }
+
+        public void Dispose()
+        {
+            baker.Dispose();
         }
 
         public Image Bake(Mesh dest, int destWidth, int destHeight, out Image destIndex, int padWidth = -1)
@@ -97,89 +57,9 @@ namespace JPLOPS.Pipeline
                 throw new ArgumentException("target mesh must have UVs");
             }
 
-            // r tree for efficient uv to xyz conversion
-            var destOperator = new MeshOperator(dest, buildFaceTree: false, buildVertexTree: false);
-
-            // the new texture
-            var destImage = new Image(destBands, destWidth, destHeight);
-
-            destIndex = null; //Lazily allocate
-            bool indexFailed = false; //Only write out index if all sources have indexes
-
-            OctreeNode start = this.triOctTree.Root;
-            OctreeNode end;
-            destImage.CreateMask(true);
-            // compute nearest neighbor for each dest pixel
-            for (int r = 0; r < destImage.Height; r++)
-            {
-                for (int c = 0; c < destImage.Width; c++)
-                {
-                    // get the xyz coordinate in the new mesh
-                    Vector2 uvDest = destImage.PixelToUV(new Vector2(c, r));
-                    BarycentricPoint bp = destOperator.UVToBarycentric(uvDest);
-                    Vector3? xyzDest = (bp != null) ? (Vector3?)bp.Position : null;
-                    BarycentricPoint closest = null;
-                    TexturedTriangle txtTri = null;
-                    // find its nearest neighbor in the old mesh
-                    // and save its location in the tree as start node for next search
-                    if (xyzDest.HasValue)
-                    {
-                        txtTri = (TexturedTriangle)triOctTree.Closest(xyzDest.Value, start, out end);
-                        start = end;
-                        closest = txtTri.tri.ClosestPoint(xyzDest.Value);
-                    }
-                    // Sample the old texture at this point
-                    if (closest != null)
-                    {
-                        Image image = txtTri.texture;
-                        Image index = txtTri.index;
-                        Vector2 pixel = image.UVToPixel(closest.UV);
-
-                        float row = (float)pixel.Y;
-                        float col = (float)pixel.X;
-                        var bands = new float[image.Bands];
-                        float[] idxBands = null;
-                        for (int b = 0; b < bands.Count(); b++)
-                        {
-                            bands[b] = image.BicubicSample(b, row, col);
-                        }
-                        indexFailed = indexFailed || index == null;
-                        if (withIndex && !indexFailed)
-                        {
-                            idxBands = new float[index.Bands];
-                            if (destIndex == null)
-                            {
-                                destIndex = new Image(3, destWidth, destHeight);
-                                destIndex.CreateMask(true);
-                            }
-                            for (int b = 0; b < idxBands.Count(); ++b)
-                            {
-                                idxBands[b] = index.NearestSample(b, row, col);
-                            }
-                        }
-                        destImage.SetBandValues(r, c, bands);
-                        destImage.SetMaskValue(r, c, false);
-                        if (withIndex && !indexFailed)
-                        {
-                            destIndex.SetBandValues(r, c, idxBands);
-                            destIndex.SetMaskValue(r, c, false);
-                        }
-                    }
-                }
-            }
-
-            destImage.Inpaint(padWidth);
-
-            if (withIndex && !indexFailed)
-            {
-                destIndex.Inpaint(padWidth, useAnyNeighbor: true);
-            }
-            else
-            {
-                destIndex = null;
-            }
-
-            return destImage;
+            //index is only baked if all sources have indexes
+            //charts are padded into the gutter natively from the nearest baked texel, which also suits the index
+            return baker.Bake(dest, destWidth, destHeight, out destIndex, withIndex, padWidth);
         }
     }
 }
@@ -188,7 +188,7 @@ namespace JPLOPS.Pipeline
                     }
                     if (options.TextureMode != TextureMode.Clip)
                     {
-                        clippedMesh.RescaleUVsForTexture(texRes, texRes, options.MaxTextureStretch);
+                        MeshUVStats.RescaleUVsForTexture(clippedMesh, texRes, texRes, options.MaxTextureStretch);
                     }
                 }
                 else
@@ -212,9 +212,9 @@ namespace JPLOPS.Pipeline
             }
 
             //choose a sub-set of points (for perf) from the output atlas texture to test
-            MeshOperator clippedOp =
-                new MeshOperator(clippedMesh, buildFaceTree: false, buildVertexTree: false, buildUVFaceTree: true);
-            List<PixelPoint> ptsToTest = clippedOp.SubsampleUVSpace(options.PercentPixelsToTest, texRes, texRes);
+            UVSamples samples = UVSampler.Sample(clippedMesh, texRes, texRes, options.PercentPixelsToTest);
+            UVSamples corners = UVSampler.SampleCorners(clippedMesh, texRes, texRes);
+            BoundingBox clippedBounds = clippedMesh.Bounds();
 
             var clippedCaster = new SceneCaster();
             clippedCaster.AddMesh(clippedMesh, null, Matrix.Identity);
@@ -222,32 +222,33 @@ namespace JPLOPS.Pipeline
 
             //record the pixel area of the image that would be used to texture the mesh for each output atlas pixel
             var srcAreaByCamera = new Dictionary<CameraInstance, List<double>>();
-            foreach (var destPixelPt in ptsToTest)
+            for (int i = 0; i < samples.Count; i++)
             { 
+                Vector3 destPoint = samples.Point(i);
+
                 //if the points are spilling onto other tiles, they aren't great candidates for testing.
                 //In addition to handling cases where you are peeking through a valley or keyhole in the terrain
                 //and all points are landing on other mesh tiles, this is a performance optimization.
-                if (!clippedHull.Contains(destPixelPt.Point, TilingDefaults.MESH_HULL_TEST_EPSILON))
+                if (!clippedHull.Contains(destPoint, TilingDefaults.MESH_HULL_TEST_EPSILON))
                 {
                     continue;
                 }
 
                 //find the camera that provides the best pixel density for this sample
                 //(would be the texture we would use at this location)
-                if (!GetBestCameraByPixelDensity(intersectingCameras, clippedCaster, clippedHull, clippedOp.Bounds,
-                                                 destPixelPt, out CameraInstance bestCamera))
+                if (!GetBestCameraByPixelDensity(intersectingCameras, clippedCaster, clippedHull, clippedBounds,
+                                                 destPoint, out CameraInstance bestCamera))
                 {
                     continue;
                 }
 
                 // calculate src pixels area contributing to the pixel  
-                Vector2[] dstPixelCorners = Image.GetPixelCorners(destPixelPt.Pixel);
-                var dstUVCorners = dstPixelCorners.Select(c => Image.PixelToUV(c, texRes, texRes));
+                Vector2[] dstPixelCorners = Image.GetPixelCorners(samples.Pixel(i));
                 var destPixelMeshPositions =
-                    dstUVCorners
-                    .Select(uv => clippedOp.UVToBarycentric(uv))
-                    .Where(bary => bary != null)
-                    .Select(bary => bary.Position);
+                    dstPixelCorners
+                    .Select(c => corners.IndexOf((int)c.Y * corners.Width + (int)c.X))
+                    .Where(corner => corner >= 0)
+                    .Select(corner => corners.Point(corner));
                 var srcPixels =
                     destPixelMeshPositions
                     .Select(meshPos => ProjectedPixelDistances.
@@ -316,7 +317,7 @@ namespace JPLOPS.Pipeline
         }
 
         private bool GetBestCameraByPixelDensity(List<CameraInstance> candidateCameras, SceneCaster meshCaster,
-                                                 ConvexHull meshHull, BoundingBox meshBounds, PixelPoint pxlPt,
+                                                 ConvexHull meshHull, BoundingBox meshBounds, Vector3 meshPoint,
                                                  out CameraInstance bestCamera)
         {
             bestCamera = null;
@@ -328,7 +329,7 @@ namespace JPLOPS.Pipeline
                 var srcPixel = ProjectedPixelDistances.
                     GetCameraPixelForMeshPosition(options.SceneCaster, camInst.CameraModel, camInst.CameraToMesh,
                                                   camInst.MeshToCamera, camInst.HullInMesh,
-                                                  pxlPt.Point, camInst.WidthPixels, camInst.HeightPixels,
+                                                  meshPoint, camInst.WidthPixels, camInst.HeightPixels,
                                                   options.RaycastTolerance);
 
                 if (!srcPixel.HasValue)
@@ -340,7 +341,7 @@ namespace JPLOPS.Pipeline
                 //want a term that looks for consistancy in spacing? implies dead on?
                 double curSpread = ProjectedPixelDistances.
                     GetPixelSpreadInMeters(meshBounds, meshCaster, options.SceneCaster, camInst.CameraModel,
-                                           camInst.CameraToMesh, srcPixel.Value, pxlPt.Point,
+                                           camInst.CameraToMesh, srcPixel.Value, meshPoint,
                                            camInst.WidthPixels, camInst.HeightPixels, options.RaycastTolerance);
                 if (curSpread < minSpread)
                 {
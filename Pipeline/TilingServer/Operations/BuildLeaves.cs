@@ -110,128 +110,130 @@ namespace JPLOPS.Pipeline.TilingServer
             LogLess("building acceleration datastructures");
             bool inputHasImages = false;
             bool inputHasUVs = true;
-            var clipper = new MultiMeshClipper(powerOfTwoTextures: project.PowerOfTwoTextures, logger: pipeline);
-            foreach (var group in inputGroups)
+            using (var clipper = new MultiMeshClipper(powerOfTwoTextures: project.PowerOfTwoTextures, logger: pipeline))
             {
-                var meshes = group.Chunks.Select(c => Mesh.Load(pipeline.GetFileCached(c.MeshUrl, "meshes"))).ToArray();
-                var mergedMesh = MeshMerge.Merge(meshes);
-                mergedMesh.Clean();
-                SparsePipelineImage image = null;
-                string chunkBaseUrl = group.Chunks[0].ImageUrl;
-                if (chunkBaseUrl != null)
+                foreach (var group in inputGroups)
                 {
-                    inputHasImages = true;
-                    TilingInput ti = group.Input;
-                    image = new SparsePipelineImage(pipeline, ti.ImageBands, ti.ImageWidth, ti.ImageHeight,
-                                                    chunkBaseUrl, ChunkInput.SPARSE_IMAGE_CHUNK_EXT,
-                                                    ChunkInput.SPARSE_IMAGE_CHUNK_RES);
-                }
-                if (!mergedMesh.HasUVs && inputNeedsUVs && textureProjector != null)
-                {
-                    LogInfo("atlasing input mesh with texture projection");
-                    mergedMesh.ProjectTexture(textureProjector.ImageWidth, textureProjector.ImageHeight,
-                                              textureProjector.CameraModel, meshToImage: textureProjector.MeshToImage);
-                }
-                inputHasUVs &= mergedMesh.HasUVs;
-                clipper.AddInput(new MeshImagePair(mergedMesh, image));
-            }
-
-            int maxTexRes = project.MaxTextureResolution;
-
-            if (inputNeedsUVs && !inputHasUVs)
-            {
-                LogWarn("cannot {0} leaf textures: input mesh(es) missing UVs", project.TextureMode);
-                maxTexRes = 0;
-            }
-
-            if (inputHasImages && inputHasUVs && maxTexRes != 0)
-            {
-                switch (project.TextureMode)
-                {
-                    case TextureMode.None: maxTexRes = 0; break;
-                    case TextureMode.Bake: 
+                    var meshes = group.Chunks.Select(c => Mesh.Load(pipeline.GetFileCached(c.MeshUrl, "meshes"))).ToArray();
+                    var mergedMesh = MeshMerge.Merge(meshes);
+                    mergedMesh.Clean();
+                    SparsePipelineImage image = null;
+                    string chunkBaseUrl = group.Chunks[0].ImageUrl;
+                    if (chunkBaseUrl != null)
                     {
-                        clipper.InitTextureBaker();
-                        break;
+                        inputHasImages = true;
+                        TilingInput ti = group.Input;
+                        image = new SparsePipelineImage(pipeline, ti.ImageBands, ti.ImageWidth, ti.ImageHeight,
+                                                        chunkBaseUrl, ChunkInput.SPARSE_IMAGE_CHUNK_EXT,
+                                                        ChunkInput.SPARSE_IMAGE_CHUNK_RES);
                     }
-                    case TextureMode.Clip: break;
-                    case TextureMode.Backproject:
+                    if (!mergedMesh.HasUVs && inputNeedsUVs && textureProjector != null)
                     {
-                        LogWarn("unsupported texture mode, not generating leaf textures: {0}", project.TextureMode);
-                        maxTexRes = 0;
-                        break;
+                        LogInfo("atlasing input mesh with texture projection");
+                        mergedMesh.ProjectTexture(textureProjector.ImageWidth, textureProjector.ImageHeight,
+                                                  textureProjector.CameraModel, meshToImage: textureProjector.MeshToImage);
                     }
+                    inputHasUVs &= mergedMesh.HasUVs;
+                    clipper.AddInput(new MeshImagePair(mergedMesh, image));
                 }
-            }
 
-            BoundingBox? surfaceBounds = project.GetSurfaceBoundingBox();
+                int maxTexRes = project.MaxTextureResolution;
 
-            LogLess("building {0} leaves", leaves.Count);
-            int nc = inputGroups.SelectMany(g => g.Chunks).Count();
-            int nl = 0;
-            CoreLimitedParallel.ForEach(leaves, leaf =>
-            {              
-                Interlocked.Increment(ref nl);
-                LogLess("building leaf {0} from {1} chunks ({2}/{3})", leaf.Id, nc, nl, leaves.Count);
+                if (inputNeedsUVs && !inputHasUVs)
+                {
+                    LogWarn("cannot {0} leaf textures: input mesh(es) missing UVs", project.TextureMode);
+                    maxTexRes = 0;
+                }
 
-                BoundingBox bounds = leaf.GetBoundsChecked(); //these bounds may just partition space
-                MeshImagePair pair = null;
                 if (inputHasImages && inputHasUVs && maxTexRes != 0)
                 {
-                    int tileResolution = maxTexRes;
-                    Mesh mesh = null;
-                    if (project.TextureMode == TextureMode.Bake || project.TextureMode == TextureMode.Clip)
+                    switch (project.TextureMode)
                     {
-                        mesh = clipper.Clip(bounds);
-                        double texelsPerMeter = project.GetMaxTexelsPerMeter(bounds, surfaceBounds);
-                        tileResolution = SceneNodeTilingExtensions
-                            .GetTileResolution(mesh, maxTexRes, texelsPerMeter, project.PowerOfTwoTextures);
+                        case TextureMode.None: maxTexRes = 0; break;
+                        case TextureMode.Bake: 
+                        {
+                            clipper.InitTextureBaker();
+                            break;
+                        }
+                        case TextureMode.Clip: break;
+                        case TextureMode.Backproject:
+                        {
+                            LogWarn("unsupported texture mode, not generating leaf textures: {0}", project.TextureMode);
+                            maxTexRes = 0;
+                            break;
+                        }
                     }
+                }
+
+                BoundingBox? surfaceBounds = project.GetSurfaceBoundingBox();
 
-                    if (project.TextureMode == TextureMode.Bake)
+                LogLess("building {0} leaves", leaves.Count);
+                int nc = inputGroups.SelectMany(g => g.Chunks).Count();
+                int nl = 0;
+                CoreLimitedParallel.ForEach(leaves, leaf =>
+                {              
+                    Interlocked.Increment(ref nl);
+                    LogLess("building leaf {0} from {1} chunks ({2}/{3})", leaf.Id, nc, nl, leaves.Count);
+
+                    BoundingBox bounds = leaf.GetBoundsChecked(); //these bounds may just partition space
+                    MeshImagePair pair = null;
+                    if (inputHasImages && inputHasUVs && maxTexRes != 0)
                     {
-                        LogLess("baking {0}x{0} leaf texture, {1}", tileResolution, tileResolution,
-                                mesh.HasUVs ? "using exising UVs" : "assigning new UVs with UVAtlas");
-                        if (mesh.HasUVs)
+                        int tileResolution = maxTexRes;
+                        Mesh mesh = null;
+                        if (project.TextureMode == TextureMode.Bake || project.TextureMode == TextureMode.Clip)
+                        {
+                            mesh = clipper.Clip(bounds);
+                            double texelsPerMeter = project.GetMaxTexelsPerMeter(bounds, surfaceBounds);
+                            tileResolution = SceneNodeTilingExtensions
+                                .GetTileResolution(mesh, maxTexRes, texelsPerMeter, project.PowerOfTwoTextures);
+                        }
+
+                        if (project.TextureMode == TextureMode.Bake)
+                        {
+                            LogLess("baking {0}x{0} leaf texture, {1}", tileResolution, tileResolution,
+                                    mesh.HasUVs ? "using exising UVs" : "assigning new UVs with UVAtlas");
+                            if (mesh.HasUVs)
+                            {
+                                mesh.RescaleUVsForTexture(tileResolution, tileResolution, project.MaxTextureStretch);
+                            }
+                            //BakeTexture() will call UVAtlas if necessary
+                            pair =
+                                clipper.BakeTexture(mesh, tileResolution, project.MaxTextureStretch, msg => LogLess(msg));
+                        }
+                        else if (project.TextureMode == TextureMode.Clip)
+                        {
+                            LogLess("clipping leaf texture");
+                            pair = clipper.ClipWithTexture(bounds, tileResolution, project.MaxTexelsPerMeter);
+                        }
+                        if (pair.Mesh != null && pair.Image != null &&
+                            project.MaxTextureStretch < 1 && !project.PowerOfTwoTextures)
                         {
-                            mesh.RescaleUVsForTexture(tileResolution, tileResolution, project.MaxTextureStretch);
+                            pair.Image = pair.Mesh.ClipImageAndRemapUVs(pair.Image, ref pair.Index);
                         }
-                        //BakeTexture() will call UVAtlas if necessary
-                        pair =
-                            clipper.BakeTexture(mesh, tileResolution, project.MaxTextureStretch, msg => LogLess(msg));
                     }
-                    else if (project.TextureMode == TextureMode.Clip)
+                    else
                     {
-                        LogLess("clipping leaf texture");
-                        pair = clipper.ClipWithTexture(bounds, tileResolution, project.MaxTexelsPerMeter);
+                        pair = new MeshImagePair(clipper.Clip(bounds), null);
                     }
-                    if (pair.Mesh != null && pair.Image != null &&
-                        project.MaxTextureStretch < 1 && !project.PowerOfTwoTextures)
+
+                    if (pair != null && pair.Mesh != null)
                     {
-                        pair.Image = pair.Mesh.ClipImageAndRemapUVs(pair.Image, ref pair.Index);
+                        var img = pair.Image;
+                        LogLess("saving leaf tile mesh with {0} triangles{1}", Fmt.KMG(pair.Mesh.Faces.Count),
+                                img != null ? string.Format(" and {0}x{1} image", img.Width, img.Height) : " (no image)");
+                        leaf.SetBounds(pair.Mesh.Bounds()); //reset bounds tight to actual leaf geometry
+                        leaf.SaveMesh(pair, pipeline, project);
+                        leaf.Save(pipeline);
+                    }
+                    else
+                    {
+                        throw new Exception("failed to build leaf " + leaf.Id);
                     }
-                }
-                else
-                {
-                    pair = new MeshImagePair(clipper.Clip(bounds), null);
-                }
-
-                if (pair != null && pair.Mesh != null)
-                {
-                    var img = pair.Image;
-                    LogLess("saving leaf tile mesh with {0} triangles{1}", Fmt.KMG(pair.Mesh.Faces.Count),
-                            img != null ? string.Format(" and {0}x{1} image", img.Width, img.Height) : " (no image)");
-                    leaf.SetBounds(pair.Mesh.Bounds()); //reset bounds tight to actual leaf geometry
-                    leaf.SaveMesh(pair, pipeline, project);
-                    leaf.Save(pipeline);
-                }
-                else
-                {
-                    throw new Exception("failed to build leaf " + leaf.Id);
-                }
 
-                pipeline.EnqueueToMaster(new TileCompletedMessage(projectName) { TileId = leaf.Id });
-            });
+                    pipeline.EnqueueToMaster(new TileCompletedMessage(projectName) { TileId = leaf.Id });
+                });
+            }
 
             LogLess("batch completed, generated {0} leaf tiles", nl);
         }
@@ -0,0 +1,469 @@
+#include "UVAtlasClass.h"
+
+#include <windows.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Times UVAtlasLib on reproducible synthetic meshes, one row per mesh family, size, quality mode and repetition.
+//
+// usage: UVAtlasBench [options]
+//   --faces N[,N...]      approximate face counts (default 1000,10000,100000,1000000)
+//   --families F[,F...]   heightfield, rock, noisy, defects (default all)
+//   --modes M[,M...]      fast, quality (default both)
+//   --repeat N            runs of each case (default 1)
+//   --seed N              generator seed (default 1)
+//   --maxSec S            wall clock limit per run, 0 for none (default 600)
+//   --preflight           drop degenerate faces and clean bowties before atlasing
+//   --csv PATH            write CSV to PATH instead of stdout
+//   --json PATH           also write JSON to PATH
+//
+// The same seed always generates the same meshes, so runs of different builds are comparable.
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+
+	struct Float3 {
+		float x, y, z;
+	};
+
+	struct BenchMesh {
+		std::vector<Float3> positions;
+		std::vector<uint32_t> indices;
+
+		uint32_t NumFaces() const { return uint32_t(indices.size() / 3); }
+	};
+
+	struct BenchRow {
+		std::string family;
+		std::string mode;
+		uint32_t faces = 0;
+		uint32_t vertices = 0;
+		int repeat = 0;
+		int returnCode = 0;
+		uint32_t outVertices = 0;
+		uint32_t numCharts = 0;
+		float stretch = 0;
+		double totalSec = 0;
+		UVAtlasPhaseStats phases[UVATLAS_NUM_PHASES];
+	};
+
+	const char* PHASE_NAMES[UVATLAS_NUM_PHASES] = { "input", "adjacency", "partition", "pack", "output" };
+
+	// Lattice value noise, smoothly interpolated, so heights are a pure function of position and seed.
+	class Noise {
+	public:
+		explicit Noise(uint32_t seed) : mSeed(seed) {}
+
+		float Value(int x, int y, int z) const
+		{
+			uint32_t h = mSeed ^ (uint32_t(x) * 0x8da6b343u) ^ (uint32_t(y) * 0xd8163841u) ^ (uint32_t(z) * 0xcb1ab31fu);
+			h ^= h >> 13;
+			h *= 0x5bd1e995u;
+			h ^= h >> 15;
+			return float(h & 0xffffff) / float(0xffffff) * 2 - 1;
+		}
+
+		float Smooth(float x, float y, float z) const
+		{
+			int ix = int(floorf(x)), iy = int(floorf(y)), iz = int(floorf(z));
+			float fx = Fade(x - ix), fy = Fade(y - iy), fz = Fade(z - iz);
+			float v[2][2];
+			for (int j = 0; j < 2; j++) {
+				for (int k = 0; k < 2; k++) {
+					v[j][k] = Lerp(Value(ix, iy + j, iz + k), Value(ix + 1, iy + j, iz + k), fx);
+				}
+			}
+			return Lerp(Lerp(v[0][0], v[1][0], fy), Lerp(v[0][1], v[1][1], fy), fz);
+		}
+
+		// Fractal sum of octaves, roughly in [-1, 1].
+		float Fbm(float x, float y, float z, int octaves = 5) const
+		{
+			float sum = 0, amplitude = 0.5f, frequency = 1;
+			for (int i = 0; i < octaves; i++) {
+				sum += amplitude * Smooth(x * frequency, y * frequency, z * frequency);
+				amplitude *= 0.5f;
+				frequency *= 2;
+			}
+			return sum;
+		}
+
+	private:
+		static float Fade(float t) { return t * t * (3 - 2 * t); }
+		static float Lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+		uint32_t mSeed;
+	};
+
+	// Regular grid of side x side quads over the unit square, two faces per quad.
+	void Grid(uint32_t faces, const Noise& noise, float relief, BenchMesh& mesh)
+	{
+		uint32_t side = (std::max)(uint32_t(sqrt(faces / 2.0)), 1u);
+		uint32_t stride = side + 1;
+		mesh.positions.resize(size_t(stride) * stride);
+		for (uint32_t y = 0; y <= side; y++) {
+			for (uint32_t x = 0; x <= side; x++) {
+				float u = float(x) / side, v = float(y) / side;
+				mesh.positions[y * stride + x] = { u, v, relief * noise.Fbm(u * 8, v * 8, 0) };
+			}
+		}
+		mesh.indices.reserve(size_t(side) * side * 6);
+		for (uint32_t y = 0; y < side; y++) {
+			for (uint32_t x = 0; x < side; x++) {
+				uint32_t i = y * stride + x;
+				uint32_t quad[6] = { i, i + 1, i + stride, i + 1, i + stride + 1, i + stride };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Terrain like heightfield, the common case of orbital and rover tiles.
+	void Heightfield(uint32_t faces, uint32_t seed, BenchMesh& mesh)
+	{
+		Grid(faces, Noise(seed), 0.15f, mesh);
+	}
+
+	// Closed rock with a leaning lobe that overhangs its base, which no single projection can chart.
+	void Rock(uint32_t faces, uint32_t seed, BenchMesh& mesh)
+	{
+		Noise noise(seed);
+		uint32_t rings = (std::max)(uint32_t(sqrt(faces / 4.0)), 2u);
+		uint32_t segments = 2 * rings;
+		auto surface = [&](double theta, double phi) {
+			float dx = float(sin(theta) * cos(phi)), dy = float(sin(theta) * sin(phi)), dz = float(cos(theta));
+			float lobe = (std::max)(0.0f, 0.8f * dx + 0.6f * dz);
+			float r = 1 + 0.3f * noise.Fbm(dx * 2 + 10, dy * 2 + 10, dz * 2 + 10) + 0.6f * lobe * lobe * lobe * lobe;
+			return Float3{ r * dx, r * dy, r * dz + 0.4f * lobe };
+		};
+		mesh.positions.push_back(surface(0, 0));
+		for (uint32_t ring = 1; ring < rings; ring++) {
+			for (uint32_t s = 0; s < segments; s++) {
+				mesh.positions.push_back(surface(PI * ring / rings, 2 * PI * s / segments));
+			}
+		}
+		mesh.positions.push_back(surface(PI, 0));
+		uint32_t south = uint32_t(mesh.positions.size() - 1);
+		auto at = [&](uint32_t ring, uint32_t s) { return 1 + (ring - 1) * segments + s % segments; };
+		for (uint32_t s = 0; s < segments; s++) {
+			uint32_t cap[6] = { 0, at(1, s), at(1, s + 1), south, at(rings - 1, s + 1), at(rings - 1, s) };
+			mesh.indices.insert(mesh.indices.end(), cap, cap + 6);
+		}
+		for (uint32_t ring = 1; ring + 1 < rings; ring++) {
+			for (uint32_t s = 0; s < segments; s++) {
+				uint32_t quad[6] = { at(ring, s), at(ring + 1, s), at(ring, s + 1),
+					at(ring, s + 1), at(ring + 1, s), at(ring + 1, s + 1) };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Stereo reconstruction: jittered positions, unwelded seams between sub-meshes and small holes.
+	void Noisy(uint32_t faces, uint32_t seed, BenchMesh& mesh)
+	{
+		Grid(faces, Noise(seed), 0.1f, mesh);
+		std::mt19937 rng(seed);
+		std::normal_distribution<float> jitter(0, 0.002f);
+		for (auto& p : mesh.positions) {
+			p.x += jitter(rng);
+			p.y += jitter(rng);
+			p.z += 4 * jitter(rng);
+		}
+		// Faces right of x = 0.5 get their own copies of the seam vertices.
+		size_t numVerts = mesh.positions.size();
+		std::vector<uint32_t> copies(numVerts, UINT32_MAX);
+		for (size_t f = 0; f < mesh.indices.size(); f += 3) {
+			float cx = 0;
+			for (int k = 0; k < 3; k++) {
+				cx += mesh.positions[mesh.indices[f + k]].x;
+			}
+			if (cx / 3 < 0.5f) {
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				uint32_t& index = mesh.indices[f + k];
+				if (index < numVerts && mesh.positions[index].x < 0.5f) {
+					if (copies[index] == UINT32_MAX) {
+						copies[index] = uint32_t(mesh.positions.size());
+						mesh.positions.push_back(mesh.positions[index]);
+					}
+					index = copies[index];
+				}
+			}
+		}
+		// Drop about 0.5% of faces.
+		std::uniform_real_distribution<float> uniform(0, 1);
+		std::vector<uint32_t> kept;
+		kept.reserve(mesh.indices.size());
+		for (size_t f = 0; f < mesh.indices.size(); f += 3) {
+			if (uniform(rng) >= 0.005f) {
+				kept.insert(kept.end(), mesh.indices.begin() + f, mesh.indices.begin() + f + 3);
+			}
+		}
+		mesh.indices.swap(kept);
+	}
+
+	// Heightfield with bowtie vertices, where two faces meet only at a vertex, and near collinear slivers.
+	void Defects(uint32_t faces, uint32_t seed, BenchMesh& mesh)
+	{
+		Grid(faces, Noise(seed), 0.15f, mesh);
+		uint32_t side = (std::max)(uint32_t(sqrt(faces / 2.0)), 1u);
+		uint32_t stride = side + 1;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> uniform(0, 1);
+
+		// Slivers: pull a vertex onto the line through two neighbors.
+		for (uint32_t y = 1; y < side; y++) {
+			for (uint32_t x = 1; x < side; x++) {
+				if (uniform(rng) < 0.01f) {
+					Float3& p = mesh.positions[y * stride + x];
+					const Float3& a = mesh.positions[y * stride + x - 1];
+					const Float3& b = mesh.positions[y * stride + x + 1];
+					p = { (a.x + b.x) / 2, (a.y + b.y) / 2 + 1e-6f, (a.z + b.z) / 2 };
+				}
+			}
+		}
+
+		// Bowties: on a sparse lattice of interior vertices keep only two opposite faces of the six around each.
+		std::vector<bool> drop(mesh.NumFaces(), false);
+		auto face = [&](uint32_t x, uint32_t y, uint32_t k) { return 2 * (y * side + x) + k; };
+		for (uint32_t y = 2; y + 2 < side; y += 8) {
+			for (uint32_t x = 2; x + 2 < side; x += 8) {
+				if (uniform(rng) < 0.25f) {
+					// Of the faces around vertex (x, y) keep those in the quads below left and above right of it.
+					drop[face(x, y - 1, 0)] = true;
+					drop[face(x, y - 1, 1)] = true;
+					drop[face(x - 1, y, 0)] = true;
+					drop[face(x - 1, y, 1)] = true;
+				}
+			}
+		}
+		std::vector<uint32_t> kept;
+		kept.reserve(mesh.indices.size());
+		for (uint32_t f = 0; f < mesh.NumFaces(); f++) {
+			if (!drop[f]) {
+				kept.insert(kept.end(), mesh.indices.begin() + 3 * f, mesh.indices.begin() + 3 * f + 3);
+			}
+		}
+		mesh.indices.swap(kept);
+	}
+
+	struct Family {
+		const char* name;
+		void (*generate)(uint32_t faces, uint32_t seed, BenchMesh& mesh);
+	};
+
+	const Family FAMILIES[] = {
+		{ "heightfield", Heightfield },
+		{ "rock", Rock },
+		{ "noisy", Noisy },
+		{ "defects", Defects },
+	};
+
+	struct Mode {
+		const char* name;
+		unsigned long uvOptions;
+	};
+
+	const Mode MODES[] = {
+		{ "fast", 0x01 },    // UVATLAS_GEODESIC_FAST
+		{ "quality", 0x02 }, // UVATLAS_GEODESIC_QUALITY
+	};
+
+	std::vector<std::string> Split(const char* list)
+	{
+		std::vector<std::string> items;
+		std::string item;
+		for (const char* c = list; ; c++) {
+			if (*c == ',' || !*c) {
+				if (!item.empty()) {
+					items.push_back(item);
+				}
+				item.clear();
+				if (!*c) {
+					return items;
+				}
+			}
+			else {
+				item += *c;
+			}
+		}
+	}
+
+	bool Contains(const std::vector<std::string>& items, const char* name)
+	{
+		return items.empty() || std::find(items.begin(), items.end(), name) != items.end();
+	}
+
+	BenchRow Run(const Family& family, const Mode& mode, const BenchMesh& mesh, int repeat, double maxSec, uint32_t preflight)
+	{
+		BenchRow row;
+		row.family = family.name;
+		row.mode = mode.name;
+		row.faces = mesh.NumFaces();
+		row.vertices = uint32_t(mesh.positions.size());
+		row.repeat = repeat;
+
+		UVAtlasInput input;
+		input.positions = mesh.positions.data();
+		input.positionFormat = UVATLAS_POSITION_FLOAT3;
+		input.numVertices = row.vertices;
+		input.indices = mesh.indices.data();
+		input.numFaces = row.faces;
+		input.adjacency = nullptr;
+
+		UVAtlasControl control = UVAtlasControl();
+		control.maxSec = maxSec;
+		control.phaseStats = row.phases;
+		control.preflight = preflight;
+
+		LARGE_INTEGER frequency, start, end;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&start);
+		UVAtlasResult* result = UVAtlasResult_Create(&input, 0, 0.5f, 2, 512, 512, mode.uvOptions, 0, &control, row.returnCode);
+		QueryPerformanceCounter(&end);
+		row.totalSec = double(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+		if (result) {
+			uint32_t outFaces;
+			UVAtlasResult_GetSize(result, row.outVertices, outFaces);
+			UVAtlasResult_GetCharts(result, row.stretch, row.numCharts, nullptr);
+			UVAtlasResult_Destroy(result);
+		}
+		return row;
+	}
+
+	void WriteCsv(FILE* file, const std::vector<BenchRow>& rows)
+	{
+		fprintf(file, "family,mode,faces,vertices,repeat,returnCode,outVertices,numCharts,stretch,totalSec");
+		for (int p = 0; p < UVATLAS_PHASE_OUTPUT; p++) {
+			fprintf(file, ",%sSec", PHASE_NAMES[p]);
+		}
+		fprintf(file, ",peakPrivateBytes\n");
+		for (const BenchRow& row : rows) {
+			uint64_t peak = 0;
+			fprintf(file, "%s,%s,%u,%u,%d,%d,%u,%u,%g,%.6f", row.family.c_str(), row.mode.c_str(), row.faces,
+				row.vertices, row.repeat, row.returnCode, row.outVertices, row.numCharts, row.stretch, row.totalSec);
+			for (int p = 0; p < UVATLAS_PHASE_OUTPUT; p++) {
+				fprintf(file, ",%.6f", row.phases[p].wallSec);
+				peak = (std::max)(peak, row.phases[p].peakPrivateBytes);
+			}
+			fprintf(file, ",%llu\n", (unsigned long long)peak);
+		}
+	}
+
+	void WriteJson(FILE* file, const std::vector<BenchRow>& rows, uint32_t seed)
+	{
+		fprintf(file, "{\n  \"seed\": %u,\n  \"runs\": [", seed);
+		for (size_t i = 0; i < rows.size(); i++) {
+			const BenchRow& row = rows[i];
+			fprintf(file, "%s\n    {\"family\": \"%s\", \"mode\": \"%s\", \"faces\": %u, \"vertices\": %u, \"repeat\": %d, "
+				"\"returnCode\": %d, \"outVertices\": %u, \"numCharts\": %u, \"stretch\": %g, \"totalSec\": %.6f, \"phases\": {",
+				i ? "," : "", row.family.c_str(), row.mode.c_str(), row.faces, row.vertices, row.repeat,
+				row.returnCode, row.outVertices, row.numCharts, row.stretch, row.totalSec);
+			for (int p = 0; p < UVATLAS_PHASE_OUTPUT; p++) {
+				fprintf(file, "%s\"%s\": {\"wallSec\": %.6f, \"peakPrivateBytes\": %llu}", p ? ", " : "", PHASE_NAMES[p],
+					row.phases[p].wallSec, (unsigned long long)row.phases[p].peakPrivateBytes);
+			}
+			fprintf(file, "}}");
+		}
+		fprintf(file, "\n  ]\n}\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<uint32_t> sizes = { 1000, 10000, 100000, 1000000 };
+	std::vector<std::string> families, modes;
+	int repeats = 1;
+	uint32_t seed = 1;
+	double maxSec = 600;
+	uint32_t preflight = 0;
+	const char* csvPath = nullptr;
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--faces" && hasValue) {
+			sizes.clear();
+			for (const std::string& size : Split(argv[++i])) {
+				sizes.push_back(uint32_t(strtoul(size.c_str(), nullptr, 10)));
+			}
+		}
+		else if (arg == "--families" && hasValue) {
+			families = Split(argv[++i]);
+		}
+		else if (arg == "--modes" && hasValue) {
+			modes = Split(argv[++i]);
+		}
+		else if (arg == "--repeat" && hasValue) {
+			repeats = (std::max)(atoi(argv[++i]), 1);
+		}
+		else if (arg == "--seed" && hasValue) {
+			seed = uint32_t(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--maxSec" && hasValue) {
+			maxSec = atof(argv[++i]);
+		}
+		else if (arg == "--preflight") {
+			preflight = UVATLAS_PREFLIGHT | UVATLAS_PREFLIGHT_BREAK_BOWTIES;
+		}
+		else if (arg == "--csv" && hasValue) {
+			csvPath = argv[++i];
+		}
+		else if (arg == "--json" && hasValue) {
+			jsonPath = argv[++i];
+		}
+		else {
+			fprintf(stderr, "usage: UVAtlasBench [--faces N,...] [--families heightfield,rock,noisy,defects] "
+				"[--modes fast,quality] [--repeat N] [--seed N] [--maxSec S] [--preflight] [--csv PATH] [--json PATH]\n");
+			return 1;
+		}
+	}
+
+	std::vector<BenchRow> rows;
+	for (const Family& family : FAMILIES) {
+		if (!Contains(families, family.name)) {
+			continue;
+		}
+		for (uint32_t size : sizes) {
+			BenchMesh mesh;
+			family.generate(size, seed, mesh);
+			for (const Mode& mode : MODES) {
+				if (!Contains(modes, mode.name)) {
+					continue;
+				}
+				for (int repeat = 0; repeat < repeats; repeat++) {
+					rows.push_back(Run(family, mode, mesh, repeat, maxSec, preflight));
+					const BenchRow& row = rows.back();
+					fprintf(stderr, "%s %s %u faces: %.3fs, return code %d\n", row.family.c_str(), row.mode.c_str(),
+						row.faces, row.totalSec, row.returnCode);
+				}
+			}
+		}
+	}
+
+	FILE* csv = stdout;
+	if (csvPath && (fopen_s(&csv, csvPath, "w") || !csv)) {
+		fprintf(stderr, "failed to open %s\n", csvPath);
+		return 1;
+	}
+	WriteCsv(csv, rows);
+	if (csv != stdout) {
+		fclose(csv);
+	}
+	if (jsonPath) {
+		FILE* json = nullptr;
+		if (fopen_s(&json, jsonPath, "w") || !json) {
+			fprintf(stderr, "failed to open %s\n", jsonPath);
+			return 1;
+		}
+		WriteJson(json, rows, seed);
+		fclose(json);
+	}
+	return 0;
+}
@@ -0,0 +1,436 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Rows per unit of work, small enough to balance threads and large enough that a band's triangles are reused.
+	const uint32_t BAKE_BAND_ROWS = 16;
+
+	const uint32_t BVH_LEAF_SIZE = 4;
+
+	struct BakeTriangle {
+		double p[3][3];
+		double uv[3][2];
+		uint32_t source;
+	};
+
+	// Leaves hold count triangles starting at first, interior nodes have their children at first and first + 1.
+	struct BvhNode {
+		double min[3];
+		double max[3];
+		uint32_t first;
+		uint32_t count;
+	};
+
+	double BoxDistanceSquared(const BvhNode& node, const double* p)
+	{
+		double d2 = 0;
+		for (int k = 0; k < 3; k++) {
+			double d = (std::max)((std::max)(node.min[k] - p[k], p[k] - node.max[k]), 0.0);
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	// Closest point on triangle abc to p as barycentric weights, per Ericson, Real-Time Collision Detection 5.1.5.
+	double ClosestPointOnTriangle(const BakeTriangle& tri, const double* p, double* w)
+	{
+		const double* a = tri.p[0];
+		const double* b = tri.p[1];
+		const double* c = tri.p[2];
+		double ab[3], ac[3], ap[3], bp[3], cp[3];
+		for (int k = 0; k < 3; k++) {
+			ab[k] = b[k] - a[k];
+			ac[k] = c[k] - a[k];
+			ap[k] = p[k] - a[k];
+			bp[k] = p[k] - b[k];
+			cp[k] = p[k] - c[k];
+		}
+		auto dot = [](const double* x, const double* y) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+		double d1 = dot(ab, ap), d2 = dot(ac, ap);
+		double d3 = dot(ab, bp), d4 = dot(ac, bp);
+		double d5 = dot(ab, cp), d6 = dot(ac, cp);
+		double vc = d1 * d4 - d3 * d2;
+		double vb = d5 * d2 - d1 * d6;
+		double va = d3 * d6 - d5 * d4;
+		double v, t;
+		if (d1 <= 0 && d2 <= 0) {
+			v = 0; t = 0;
+		}
+		else if (d3 >= 0 && d4 <= d3) {
+			v = 1; t = 0;
+		}
+		else if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			v = d1 / (d1 - d3); t = 0;
+		}
+		else if (d6 >= 0 && d5 <= d6) {
+			v = 0; t = 1;
+		}
+		else if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			v = 0; t = d2 / (d2 - d6);
+		}
+		else if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+			t = (d4 - d3) / ((d4 - d3) + (d5 - d6)); v = 1 - t;
+		}
+		else {
+			double denom = va + vb + vc;
+			v = vb / denom; t = vc / denom;
+		}
+		w[0] = 1 - v - t;
+		w[1] = v;
+		w[2] = t;
+		double d2sum = 0;
+		for (int k = 0; k < 3; k++) {
+			double d = a[k] + ab[k] * v + ac[k] * t - p[k];
+			d2sum += d * d;
+		}
+		return d2sum;
+	}
+
+	// Same taps and weights as the managed Image.BicubicSample, including its clamp-then-truncate edge handling.
+	float ReadClamped(const float* band, const UVAtlasImage& image, float x, float y)
+	{
+		// Written so that NaN clamps to 0 too.
+		int row = y > 0 ? (int)(std::min)(y, (float)(image.height - 1)) : 0;
+		int col = x > 0 ? (int)(std::min)(x, (float)(image.width - 1)) : 0;
+		return band[(size_t)row * image.width + col];
+	}
+
+	float Cubic(float xf, float xf2, float xf3, float p0, float p1, float p2, float p3)
+	{
+		float a = p3 - p2 - p0 + p1;
+		float b = p0 - p1 - a;
+		float c = p2 - p0;
+		return a * xf3 + b * xf2 + c * xf + p1;
+	}
+
+	float BicubicSample(const float* band, const UVAtlasImage& image, float row, float col)
+	{
+		// Beyond these every tap reads the edge anyway, and the truncations below stay in range of int.
+		row = row > -2 ? (std::min)(row, image.height + 1.0f) : -2;
+		col = col > -2 ? (std::min)(col, image.width + 1.0f) : -2;
+		int x1 = (int)col;
+		int y1 = (int)row;
+		float xf = col - x1, yf = row - y1;
+		float xf2 = xf * xf, xf3 = xf * xf2;
+		float yf2 = yf * yf, yf3 = yf * yf2;
+		float x[4];
+		for (int j = 0; j < 4; j++) {
+			float y = (float)(y1 - 1 + j);
+			x[j] = Cubic(xf, xf2, xf3,
+				ReadClamped(band, image, (float)(x1 - 1), y), ReadClamped(band, image, (float)x1, y),
+				ReadClamped(band, image, (float)(x1 + 1), y), ReadClamped(band, image, (float)(x1 + 2), y));
+		}
+		return Cubic(yf, yf2, yf3, x[0], x[1], x[2], x[3]);
+	}
+
+	float NearestSample(const float* band, const UVAtlasImage& image, float row, float col)
+	{
+		// nearbyint rounds half to even like Math.Round.
+		return ReadClamped(band, image, std::nearbyint(col), std::nearbyint(row));
+	}
+}
+
+struct UVAtlasBaker {
+	std::vector<BakeTriangle> triangles;
+	std::vector<BvhNode> nodes;
+	std::vector<UVAtlasBakeSource> sources;
+	uint32_t numBands = 0;
+	// Fewest bands of any source index, 0 if a source has none.
+	uint32_t numIndexBands = UINT32_MAX;
+
+	void Build()
+	{
+		std::vector<uint32_t> order(triangles.size());
+		std::vector<double> centroids(triangles.size() * 3);
+		for (uint32_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+			for (int k = 0; k < 3; k++) {
+				centroids[3 * i + k] = (triangles[i].p[0][k] + triangles[i].p[1][k] + triangles[i].p[2][k]) / 3;
+			}
+		}
+		nodes.reserve(2 * (triangles.size() / BVH_LEAF_SIZE + 1));
+		nodes.push_back(BvhNode());
+		Split(0, order, centroids, 0, (uint32_t)order.size());
+
+		std::vector<BakeTriangle> sorted(triangles.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			sorted[i] = triangles[order[i]];
+		}
+		triangles.swap(sorted);
+	}
+
+	void Split(size_t node, std::vector<uint32_t>& order, const std::vector<double>& centroids, uint32_t first, uint32_t count)
+	{
+		BvhNode& n = nodes[node];
+		for (int k = 0; k < 3; k++) {
+			n.min[k] = HUGE_VAL;
+			n.max[k] = -HUGE_VAL;
+		}
+		double cmin[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL }, cmax[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+		for (uint32_t i = first; i < first + count; i++) {
+			const BakeTriangle& tri = triangles[order[i]];
+			for (int k = 0; k < 3; k++) {
+				for (int v = 0; v < 3; v++) {
+					n.min[k] = (std::min)(n.min[k], tri.p[v][k]);
+					n.max[k] = (std::max)(n.max[k], tri.p[v][k]);
+				}
+				cmin[k] = (std::min)(cmin[k], centroids[3 * order[i] + k]);
+				cmax[k] = (std::max)(cmax[k], centroids[3 * order[i] + k]);
+			}
+		}
+		int axis = 0;
+		for (int k = 1; k < 3; k++) {
+			if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) {
+				axis = k;
+			}
+		}
+		if (count <= BVH_LEAF_SIZE || cmax[axis] <= cmin[axis]) {
+			n.first = first;
+			n.count = count;
+			return;
+		}
+
+		// Median split, so that the depth is logarithmic however unevenly the triangles are spread.
+		uint32_t half = count / 2;
+		auto begin = order.begin() + first;
+		std::nth_element(begin, begin + half, begin + count, [&centroids, axis](uint32_t a, uint32_t b) {
+			return centroids[3 * a + axis] < centroids[3 * b + axis];
+		});
+		size_t children = nodes.size();
+		nodes[node].first = (uint32_t)children;
+		nodes[node].count = 0;
+		nodes.push_back(BvhNode());
+		nodes.push_back(BvhNode());
+		Split(children, order, centroids, first, half);
+		Split(children + 1, order, centroids, first + half, count - half);
+	}
+
+	// Index of the triangle closest to p, searching from hint (e.g. the previous answer) to prune early.
+	uint32_t Closest(const double* p, uint32_t hint, double* w) const
+	{
+		double bestW[3];
+		double best = ClosestPointOnTriangle(triangles[hint], p, bestW);
+		uint32_t bestTri = hint;
+		uint32_t stack[64];
+		int depth = 0;
+		stack[depth++] = 0;
+		while (depth) {
+			const BvhNode& node = nodes[stack[--depth]];
+			if (BoxDistanceSquared(node, p) >= best) {
+				continue;
+			}
+			if (node.count) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					double tw[3];
+					double d2 = ClosestPointOnTriangle(triangles[i], p, tw);
+					if (d2 < best) {
+						best = d2;
+						bestTri = i;
+						std::copy(tw, tw + 3, bestW);
+					}
+				}
+				continue;
+			}
+			// Visit the nearer child first by pushing it last.
+			uint32_t a = node.first, b = node.first + 1;
+			if (BoxDistanceSquared(nodes[a], p) < BoxDistanceSquared(nodes[b], p)) {
+				std::swap(a, b);
+			}
+			stack[depth++] = a;
+			stack[depth++] = b;
+		}
+		std::copy(bestW, bestW + 3, w);
+		return bestTri;
+	}
+};
+
+namespace
+{
+	struct BakeJob {
+		const UVAtlasBaker* baker;
+		const UVAtlasBakeMesh* dest;
+		UVAtlasImage* image;
+		UVAtlasImage* index;
+		uint8_t* coverage;
+		std::vector<std::vector<uint32_t>> bandFaces;
+		std::atomic<uint32_t> nextBand;
+		std::atomic<bool> failed;
+	};
+
+	void BakeBand(BakeJob& job, uint32_t band, std::vector<uint32_t>& faces, std::vector<double>& weights, uint32_t& hint)
+	{
+		const UVAtlasBakeMesh& dest = *job.dest;
+		const UVAtlasImage& image = *job.image;
+		uint32_t width = image.width;
+		uint32_t row0 = band * BAKE_BAND_ROWS;
+		uint32_t row1 = (std::min)(row0 + BAKE_BAND_ROWS, image.height);
+		size_t numTexels = (size_t)(row1 - row0) * width;
+
+		// Texel (c, r) samples uv (c / width, 1 - r / height) as Image.PixelToUV does.
+		RasterizeUVRows(dest, job.bandFaces[band], width, image.height, row0, row1, 0, faces.data(), weights.data());
+
+		const UVAtlasBaker& baker = *job.baker;
+		for (size_t t = 0; t < numTexels; t++) {
+			size_t texel = (size_t)row0 * width + t;
+			if (faces[t] == UINT32_MAX) {
+				if (job.coverage) {
+					job.coverage[texel] = 0;
+				}
+				continue;
+			}
+			const uint32_t* face = dest.indices + 3 * size_t(faces[t]);
+			double w[3] = { 1 - weights[2 * t] - weights[2 * t + 1], weights[2 * t], weights[2 * t + 1] };
+			double p[3] = { 0, 0, 0 };
+			for (int v = 0; v < 3; v++) {
+				for (int k = 0; k < 3; k++) {
+					p[k] += w[v] * dest.positions[3 * size_t(face[v]) + k];
+				}
+			}
+
+			double sw[3];
+			hint = baker.Closest(p, hint, sw);
+			const BakeTriangle& tri = baker.triangles[hint];
+			const UVAtlasBakeSource& source = baker.sources[tri.source];
+			double u = sw[0] * tri.uv[0][0] + sw[1] * tri.uv[1][0] + sw[2] * tri.uv[2][0];
+			double v = sw[0] * tri.uv[0][1] + sw[1] * tri.uv[1][1] + sw[2] * tri.uv[2][1];
+			float col = (float)(u * source.image.width);
+			float row = (float)((1 - v) * source.image.height);
+			for (uint32_t b = 0; b < image.numBands; b++) {
+				image.bands[b][texel] = BicubicSample(source.image.bands[b], source.image, row, col);
+			}
+			if (job.index) {
+				// Like the managed baker, the index is sampled at image texel coordinates even if its size differs.
+				for (uint32_t b = 0; b < job.index->numBands; b++) {
+					job.index->bands[b][texel] = NearestSample(source.index.bands[b], source.index, row, col);
+				}
+			}
+			if (job.coverage) {
+				job.coverage[texel] = 1;
+			}
+		}
+	}
+
+	void RunBakeWorker(BakeJob& job)
+	{
+		try {
+			size_t bandTexels = (size_t)BAKE_BAND_ROWS * job.image->width;
+			std::vector<uint32_t> faces(bandTexels);
+			std::vector<double> weights(2 * bandTexels);
+			uint32_t hint = 0;
+			uint32_t band;
+			while (!job.failed && (band = job.nextBand++) < job.bandFaces.size()) {
+				BakeBand(job, band, faces, weights, hint);
+			}
+		}
+		catch (...) {
+			job.failed = true;
+		}
+	}
+}
+
+extern "C" __declspec(dllexport) UVAtlasBaker* __cdecl UVAtlasBaker_Create(const UVAtlasBakeSource* sources, uint32_t numSources, int& returnCode)
+{
+	returnCode = 1;
+	if (!sources || !numSources) {
+		wprintf(L"\nERROR: Bake needs at least one source\n");
+		return nullptr;
+	}
+	size_t numFaces = 0;
+	for (uint32_t s = 0; s < numSources; s++) {
+		const UVAtlasImage& image = sources[s].image;
+		if (!image.bands || !image.width || !image.height || image.numBands != sources[0].image.numBands) {
+			wprintf(L"\nERROR: Bake source %u image is empty or has a different number of bands\n", s);
+			return nullptr;
+		}
+		if (!ValidUVMesh(sources[s].mesh, L"Bake source")) {
+			return nullptr;
+		}
+		numFaces += sources[s].mesh.numFaces;
+	}
+	if (!numFaces) {
+		wprintf(L"\nERROR: Bake sources have no faces\n");
+		return nullptr;
+	}
+
+	try {
+		std::unique_ptr<UVAtlasBaker> baker(new UVAtlasBaker());
+		baker->sources.assign(sources, sources + numSources);
+		baker->numBands = sources[0].image.numBands;
+		baker->triangles.reserve(numFaces);
+		for (uint32_t s = 0; s < numSources; s++) {
+			const UVAtlasBakeMesh& mesh = sources[s].mesh;
+			baker->numIndexBands = (std::min)(baker->numIndexBands, sources[s].index.bands ? sources[s].index.numBands : 0);
+			for (size_t f = 0; f < mesh.numFaces; f++) {
+				BakeTriangle tri;
+				for (int v = 0; v < 3; v++) {
+					size_t vertex = mesh.indices[3 * f + v];
+					std::copy(mesh.positions + 3 * vertex, mesh.positions + 3 * vertex + 3, tri.p[v]);
+					std::copy(mesh.uvs + 2 * vertex, mesh.uvs + 2 * vertex + 2, tri.uv[v]);
+				}
+				tri.source = s;
+				baker->triangles.push_back(tri);
+			}
+		}
+		baker->Build();
+		returnCode = 0;
+		return baker.release();
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Failed building bake BVH for %zu faces\n", numFaces);
+		return nullptr;
+	}
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasBaker_Bake(const UVAtlasBaker* baker, const UVAtlasBakeMesh* dest, UVAtlasImage* image, UVAtlasImage* index, uint8_t* coverage, int maxThreads)
+{
+	if (!baker || !dest || !image || !image->bands || image->numBands != baker->numBands) {
+		wprintf(L"\nERROR: Bake image is missing or has a different number of bands than the sources\n");
+		return 1;
+	}
+	if (!ValidUVMesh(*dest, L"Bake dest")) {
+		return 1;
+	}
+	// Not an error for callers that bake an index whenever every source has one, so the image is still baked.
+	bool skipIndex = index && (!index->bands || index->numBands > baker->numIndexBands || index->width != image->width || index->height != image->height);
+	if (skipIndex) {
+		index = nullptr;
+	}
+
+	BakeJob job;
+	job.baker = baker;
+	job.dest = dest;
+	job.image = image;
+	job.index = index;
+	job.coverage = coverage;
+	job.nextBand = 0;
+	job.failed = false;
+	try {
+		BinUVRows(*dest, image->width, image->height, BAKE_BAND_ROWS, 0, job.bandFaces);
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Out of memory binning %u bake faces\n", dest->numFaces);
+		return 1;
+	}
+
+	size_t numThreads = maxThreads > 0 ? (size_t)maxThreads : (size_t)(std::max)(1u, std::thread::hardware_concurrency());
+	RunWorkers((std::min)(numThreads, job.bandFaces.size()), [&job](size_t) { RunBakeWorker(job); });
+	if (job.failed) {
+		wprintf(L"\nERROR: Failed baking %ux%u texels\n", image->width, image->height);
+		return 1;
+	}
+	return skipIndex ? ATLAS_NO_INDEX : 0;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasBaker_Destroy(UVAtlasBaker* baker)
+{
+	delete baker;
+}
@@ -0,0 +1,115 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Per-worker queue, the owner takes from the front and thieves take from the back.
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<uint32_t> items;
+	};
+
+	bool TakeWork(std::vector<WorkQueue>& queues, size_t self, uint32_t& item)
+	{
+		{
+			std::lock_guard<std::mutex> guard(queues[self].lock);
+			if (!queues[self].items.empty()) {
+				item = queues[self].items.front();
+				queues[self].items.pop_front();
+				return true;
+			}
+		}
+		for (size_t i = 1; i < queues.size(); i++) {
+			WorkQueue& victim = queues[(self + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.items.empty()) {
+				item = victim.items.back();
+				victim.items.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void RunWorker(std::vector<WorkQueue>& queues, size_t self, const UVAtlasBatchItem* items,
+		UVAtlasBatchCallback callback, void* userData, const UVAtlasControl* control, std::atomic<int>& numSucceeded)
+	{
+		// Progress and phase stats are per call, so they aren't shared across the batch.
+		UVAtlasControl itemControl = control ? *control : UVAtlasControl();
+		itemControl.progress = nullptr;
+		itemControl.phaseStats = nullptr;
+		itemControl.preflightStats = nullptr;
+
+		// Nothing is ever pushed after the batch starts, so once every queue is empty the worker is done.
+		UVAtlasContext ctx;
+		uint32_t index;
+		while (TakeWork(queues, self, index)) {
+			const UVAtlasBatchItem& item = items[index];
+			AtlasParams params = { item.maxCharts, item.maxStretch, item.gutter, item.width, item.height, item.uvOptions, item.adjacencyEpsilon, &itemControl };
+			int returnCode = 1;
+			try {
+				// Once the batch is cancelled the remaining items are drained without being atlased.
+				returnCode = itemControl.cancel && *itemControl.cancel ? ATLAS_CANCELLED : AtlasInput(ctx, &item.input, params);
+			}
+			catch (...) {
+				wprintf(L"\nERROR: Failed atlasing batch item %u\n", index);
+				returnCode = 1;
+			}
+			if (returnCode == 0) {
+				numSucceeded++;
+			}
+			if (callback) {
+				callback(index, returnCode, returnCode == 0 ? &ctx.result : nullptr, userData);
+			}
+		}
+	}
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasBatch(const UVAtlasBatchItem* items, uint32_t numItems, int maxThreads, UVAtlasBatchCallback callback, void* userData, const UVAtlasControl* control)
+{
+	if (!items || !numItems) {
+		return 0;
+	}
+
+	size_t numThreads = maxThreads > 0 ? (size_t)maxThreads : (size_t)(std::max)(1u, std::thread::hardware_concurrency());
+	numThreads = (std::min)(numThreads, (size_t)numItems);
+
+	// Deal the largest meshes out first so that a big one never starts last and sets the tail latency.
+	std::vector<WorkQueue> queues;
+	try {
+		std::vector<uint32_t> order(numItems);
+		for (uint32_t i = 0; i < numItems; i++) {
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [items](uint32_t a, uint32_t b) {
+			return items[a].input.numFaces > items[b].input.numFaces;
+		});
+		std::vector<WorkQueue>(numThreads).swap(queues);
+		for (uint32_t i = 0; i < numItems; i++) {
+			queues[i % numThreads].items.push_back(order[i]);
+		}
+	}
+	catch (...) {
+		// Nothing was atlased, but every item still gets its callback.
+		wprintf(L"\nERROR: Failed queueing a batch of %u items\n", numItems);
+		for (uint32_t i = 0; i < numItems && callback; i++) {
+			callback(i, 1, nullptr, userData);
+		}
+		return 0;
+	}
+
+	// Items are stolen from any queue, so those of a worker that couldn't be started still get atlased.
+	std::atomic<int> numSucceeded(0);
+	RunWorkers(numThreads, [&](size_t self) {
+		RunWorker(queues, self, items, callback, userData, control, numSucceeded);
+	});
+	return numSucceeded;
+}
@@ -0,0 +1,219 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+
+#include <bcrypt.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t CACHE_MAGIC = 0x43415655; // "UVAC"
+
+	// Bump whenever the file layout or the atlas itself (e.g. a UVAtlas update) changes, which orphans old entries.
+	const uint32_t CACHE_VERSION = 4;
+
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numVertices;
+		uint32_t numFaces;
+		float stretch;
+		uint32_t numCharts;
+	};
+
+	class Sha256 {
+	public:
+		Sha256()
+		{
+			if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&mAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0))) {
+				mAlg = nullptr;
+				return;
+			}
+			if (!BCRYPT_SUCCESS(BCryptCreateHash(mAlg, &mHash, nullptr, 0, nullptr, 0, 0))) {
+				mHash = nullptr;
+			}
+		}
+
+		~Sha256()
+		{
+			if (mHash) {
+				BCryptDestroyHash(mHash);
+			}
+			if (mAlg) {
+				BCryptCloseAlgorithmProvider(mAlg, 0);
+			}
+		}
+
+		bool Add(const void* data, size_t size)
+		{
+			// BCryptHashData takes a ULONG length, so very large buffers are fed in chunks.
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+			while (mHash && size) {
+				ULONG chunk = (ULONG)(std::min)(size, size_t(1) << 30);
+				if (!BCRYPT_SUCCESS(BCryptHashData(mHash, const_cast<PUCHAR>(bytes), chunk, 0))) {
+					return false;
+				}
+				bytes += chunk;
+				size -= chunk;
+			}
+			return mHash != nullptr;
+		}
+
+		template <typename T>
+		bool Add(const T& value) { return Add(&value, sizeof(T)); }
+
+		bool Finish(std::wstring& hex)
+		{
+			uint8_t digest[32];
+			if (!mHash || !BCRYPT_SUCCESS(BCryptFinishHash(mHash, digest, sizeof(digest), 0))) {
+				return false;
+			}
+			static const wchar_t* digits = L"0123456789abcdef";
+			hex.resize(2 * sizeof(digest));
+			for (size_t i = 0; i < sizeof(digest); i++) {
+				hex[2 * i] = digits[digest[i] >> 4];
+				hex[2 * i + 1] = digits[digest[i] & 15];
+			}
+			return true;
+		}
+
+	private:
+		BCRYPT_ALG_HANDLE mAlg = nullptr;
+		BCRYPT_HASH_HANDLE mHash = nullptr;
+	};
+
+	std::wstring CachePath(const wchar_t* dir, const std::wstring& key)
+	{
+		std::wstring path(dir);
+		if (!path.empty() && path.back() != L'\\' && path.back() != L'/') {
+			path += L'\\';
+		}
+		return path + key + L".uvatlas";
+	}
+
+	// A result file may be truncated, corrupt or from a different input, so every index must be in range of the
+	// output vertices, every remap entry in range of the input vertices and every chart id in range of the charts
+	// before anything uses them.
+	bool ValidResult(const UVAtlasResult& result, size_t nVerts, uint32_t numCharts)
+	{
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(result.indices.data());
+		size_t numOutVertices = result.vertexRemap.size();
+		for (size_t i = 0; i < result.indices.size() / sizeof(uint32_t); i++) {
+			if (indices[i] >= numOutVertices) {
+				return false;
+			}
+		}
+		for (uint32_t src : result.vertexRemap) {
+			if (src >= nVerts) {
+				return false;
+			}
+		}
+		for (uint32_t chart : result.facePartitioning) {
+			if (chart >= numCharts) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool AtlasCacheKey(const XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params, std::wstring& key)
+{
+	Sha256 sha;
+	uint64_t counts[] = { nVerts, nFaces };
+	uint32_t preflight = params.control ? params.control->preflight : 0;
+	int32_t optimize = params.control ? params.control->optimize : 0;
+	return sha.Add(CACHE_VERSION) && sha.Add(counts) &&
+		sha.Add(positions, nVerts * sizeof(XMFLOAT3)) && sha.Add(indices, nFaces * 3 * sizeof(uint32_t)) &&
+		sha.Add(params.maxCharts) && sha.Add(params.maxStretch) && sha.Add(params.gutter) &&
+		sha.Add(params.width) && sha.Add(params.height) && sha.Add(params.uvOptions) && sha.Add(params.adjacencyEpsilon) &&
+		sha.Add(params.welded) && sha.Add(preflight) && sha.Add(optimize) && (!params.adjacency || sha.Add(params.adjacency, nFaces * 3 * sizeof(uint32_t))) &&
+		sha.Finish(key);
+}
+
+bool AtlasResultRead(const std::wstring& path, const XMFLOAT3* positions, size_t nVerts, UVAtlasResult& result)
+{
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, path.c_str(), L"rb") || !file) {
+		return false;
+	}
+	CacheHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == CACHE_MAGIC && header.version == CACHE_VERSION && header.numVertices && header.numFaces &&
+		uint64_t(header.numFaces) * 3 * sizeof(uint32_t) <= SIZE_MAX;
+	if (ok) {
+		std::vector<XMFLOAT2> uvs(header.numVertices);
+		result.vertexRemap.resize(header.numVertices);
+		result.indices.resize(size_t(header.numFaces) * 3 * sizeof(uint32_t));
+		result.facePartitioning.resize(header.numFaces);
+		ok = fread(uvs.data(), sizeof(XMFLOAT2), uvs.size(), file) == uvs.size() &&
+			fread(result.vertexRemap.data(), sizeof(uint32_t), header.numVertices, file) == header.numVertices &&
+			fread(result.indices.data(), 1, result.indices.size(), file) == result.indices.size() &&
+			fread(result.facePartitioning.data(), sizeof(uint32_t), header.numFaces, file) == header.numFaces &&
+			ValidResult(result, nVerts, header.numCharts);
+		if (ok && !positions) {
+			result.vertices.clear();
+			result.uvs.swap(uvs);
+		}
+		else if (ok) {
+			// Output vertex positions aren't stored since they are always input positions picked by vertexRemap.
+			result.vertices.resize(header.numVertices);
+			result.uvs.clear();
+			for (size_t i = 0; i < header.numVertices; i++) {
+				result.vertices[i].pos = positions[result.vertexRemap[i]];
+				result.vertices[i].uv = uvs[i];
+			}
+		}
+		result.stretch = header.stretch;
+		result.numCharts = header.numCharts;
+	}
+	fclose(file);
+	if (!ok) {
+		// A bad entry is just a miss, so don't leave a partial result behind.
+		result = UVAtlasResult();
+	}
+	return ok;
+}
+
+bool AtlasResultWrite(const std::wstring& path, const UVAtlasResult& result)
+{
+	// Written under a name unique to this thread and then renamed into place, so that concurrent writers of the
+	// same path and readers never see a partial file.
+	std::wstring tmp = path + L"." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, tmp.c_str(), L"wb") || !file) {
+		return false;
+	}
+	CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, result.GetVertexCount(), result.GetFaceCount(), result.stretch, result.numCharts };
+	std::vector<XMFLOAT2> uvs(result.GetVertexCount());
+	for (size_t i = 0; i < uvs.size(); i++) {
+		uvs[i] = result.GetUV(i);
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(uvs.data(), sizeof(XMFLOAT2), uvs.size(), file) == uvs.size() &&
+		fwrite(result.vertexRemap.data(), sizeof(uint32_t), result.vertexRemap.size(), file) == result.vertexRemap.size() &&
+		fwrite(result.indices.data(), 1, result.indices.size(), file) == result.indices.size() &&
+		fwrite(result.facePartitioning.data(), sizeof(uint32_t), result.facePartitioning.size(), file) == result.facePartitioning.size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok || !MoveFileExW(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileW(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool AtlasCacheRead(const wchar_t* dir, const std::wstring& key, const XMFLOAT3* positions, size_t nVerts, UVAtlasResult& result)
+{
+	return AtlasResultRead(CachePath(dir, key), positions, nVerts, result);
+}
+
+void AtlasCacheWrite(const wchar_t* dir, const std::wstring& key, const UVAtlasResult& result)
+{
+	CreateDirectoryW(dir, nullptr);
+	AtlasResultWrite(CachePath(dir, key), result);
+}
@@ -7,16 +7,22 @@
 #include <assert.h>
 #include <conio.h>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <numeric>
 #include <list>
 
 #include <dxgiformat.h>
+#include <emmintrin.h>
+#include <psapi.h>
 
 #include "UVAtlas.h"
 #include "directxtex.h"
 
 #include "Mesh.h"
 #include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -32,6 +38,726 @@
 
 using namespace DirectX;
 
+// UVAtlasPartition and UVAtlasPack abort as soon as the status callback fails, so polling it at a fine
+// granularity is what lets a runaway mesh stop promptly instead of running to completion in the background.
+static std::function<HRESULT __cdecl(float)> StatusCallback(const AtlasDeadline& deadline, const UVAtlasControl* control, UVAtlasPhase phase, int& stop)
+{
+	if (!deadline.IsActive() && !(control && (control->progress || control->phaseStats))) {
+		return nullptr;
+	}
+	return [&deadline, &stop, phase, control](float percentComplete) -> HRESULT {
+		AtlasPhaseTimer::SampleMemory(control, phase);
+		if (control && control->progress) {
+			control->progress(phase, percentComplete, control->progressUserData);
+		}
+		stop = deadline.Check();
+		return stop ? E_ABORT : S_OK;
+	};
+}
+
+static int AtlasFailed(HRESULT hr, int stop)
+{
+	if (stop) {
+		wprintf(L"\nERROR: Atlas %s\n", stop == ATLAS_CANCELLED ? L"cancelled" : L"timed out");
+		return stop;
+	}
+	wprintf(L"\nERROR: Failed generating Atlas (%08X)\n", hr);
+	return 5;
+}
+
+int AtlasAdjacency(UVAtlasContext& ctx, const XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params)
+{
+	if ((uint64_t(nFaces) * 3) >= UINT32_MAX) {
+		wprintf(L"\nERROR: Too many faces (%zu)\n", nFaces);
+		return 2;
+	}
+
+	AtlasPhaseTimer adjacencyTimer(params.control, UVATLAS_PHASE_ADJACENCY);
+	ctx.adjacency.resize(nFaces * 3);
+	ctx.pointReps.resize(nVerts);
+	HRESULT hr = S_OK;
+	if (params.adjacency) {
+		// Supplied adjacency is only range checked, and every vertex is its own point rep.
+		for (size_t i = 0; i < nFaces * 3; i++) {
+			if (params.adjacency[i] != UINT32_MAX && params.adjacency[i] >= nFaces) {
+				hr = E_INVALIDARG;
+				break;
+			}
+		}
+		if (SUCCEEDED(hr)) {
+			memcpy(ctx.adjacency.data(), params.adjacency, sizeof(uint32_t) * nFaces * 3);
+			std::iota(ctx.pointReps.begin(), ctx.pointReps.end(), 0u);
+		}
+	}
+	else if (params.welded) {
+		// With identity point reps edges match by exact index equality, skipping the spatial sort of the epsilon search.
+		std::iota(ctx.pointReps.begin(), ctx.pointReps.end(), 0u);
+		hr = ConvertPointRepsToAdjacency(indices, nFaces, positions, nVerts, ctx.pointReps.data(), ctx.adjacency.data());
+	}
+	else {
+		hr = GenerateAdjacencyAndPointReps(indices, nFaces, positions, nVerts, params.adjacencyEpsilon, ctx.pointReps.data(), ctx.adjacency.data());
+	}
+	adjacencyTimer.Stop();
+	if (FAILED(hr))
+	{
+		wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", hr);
+		return 4;
+	}
+	return 0;
+}
+
+int PartitionBuffers(UVAtlasContext& ctx, const XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params,
+	const AtlasDeadline& deadline, UVAtlasResult& partitioned, std::vector<uint32_t>& partitionAdjacency)
+{
+	int stop = deadline.Check();
+	if (stop) {
+		return stop;
+	}
+
+	auto statusCallback = StatusCallback(deadline, params.control, UVATLAS_PHASE_PARTITION, stop);
+	float callbackFrequency = statusCallback ? 0.001f : 0.1f;
+
+	partitioned.vertices.clear();
+	partitioned.uvs.clear();
+	partitioned.indices.clear();
+	partitioned.vertexRemap.clear();
+	partitioned.facePartitioning.clear();
+	float outStretch = 0.f;
+	size_t outCharts = 0;
+
+	AtlasPhaseTimer partitionTimer(params.control, UVATLAS_PHASE_PARTITION);
+	HRESULT hr = UVAtlasPartition(positions, nVerts,
+		indices, DXGI_FORMAT_R32_UINT, nFaces,
+		params.maxCharts, params.maxStretch,
+		ctx.adjacency.data(), nullptr,
+		nullptr,
+		statusCallback, callbackFrequency,
+		params.uvOptions, partitioned.vertices, partitioned.indices,
+		&partitioned.facePartitioning,
+		&partitioned.vertexRemap,
+		partitionAdjacency,
+		&outStretch, &outCharts);
+	partitioned.stretch = outStretch;
+	partitioned.numCharts = (uint32_t)outCharts;
+	return FAILED(hr) ? AtlasFailed(hr, stop) : 0;
+}
+
+// Completes a permutation from DirectXMesh, which marks entries it didn't place with UINT32_MAX, with the missing
+// elements in their original order.
+static void CompletePermutation(std::vector<uint32_t>& order, std::vector<uint32_t>& scratch)
+{
+	scratch.assign(order.size(), 0);
+	size_t n = 0;
+	for (uint32_t i : order) {
+		if (i != UINT32_MAX) {
+			scratch[i] = 1;
+			order[n++] = i;
+		}
+	}
+	for (uint32_t i = 0; n < order.size(); i++) {
+		if (!scratch[i]) {
+			order[n++] = i;
+		}
+	}
+}
+
+// Reorders faces for vertex cache locality and then vertices for fetch locality, keeping facePartitioning and
+// vertexRemap in step. Only faces and vertices move, so a failure just leaves the result as it was.
+static void OptimizeResult(UVAtlasResult& result, const std::vector<uint32_t>& partitionAdjacency)
+{
+	size_t nFaces = result.GetFaceCount(), nVerts = result.GetVertexCount();
+	uint32_t* ib = reinterpret_cast<uint32_t*>(result.indices.data());
+	if (partitionAdjacency.size() != nFaces * 3) {
+		return;
+	}
+
+	std::vector<uint32_t> faceOrder(nFaces), scratch;
+	if (SUCCEEDED(OptimizeFaces(ib, nFaces, partitionAdjacency.data(), faceOrder.data()))) {
+		CompletePermutation(faceOrder, scratch);
+		std::vector<uint32_t> oldIndices(ib, ib + nFaces * 3), oldPartitioning(result.facePartitioning);
+		for (size_t f = 0; f < nFaces; f++) {
+			memcpy(ib + 3 * f, &oldIndices[3 * size_t(faceOrder[f])], 3 * sizeof(uint32_t));
+			if (!oldPartitioning.empty()) {
+				result.facePartitioning[f] = oldPartitioning[faceOrder[f]];
+			}
+		}
+	}
+
+	std::vector<uint32_t> vertexOrder(nVerts);
+	if (SUCCEEDED(OptimizeVertices(ib, nFaces, nVerts, vertexOrder.data()))) {
+		CompletePermutation(vertexOrder, scratch);
+		std::vector<UVAtlasVertex> oldVertices(result.vertices);
+		std::vector<uint32_t> oldRemap(result.vertexRemap);
+		for (size_t v = 0; v < nVerts; v++) {
+			result.vertices[v] = oldVertices[vertexOrder[v]];
+			result.vertexRemap[v] = oldRemap[vertexOrder[v]];
+			scratch[vertexOrder[v]] = (uint32_t)v;
+		}
+		for (size_t i = 0; i < nFaces * 3; i++) {
+			ib[i] = scratch[ib[i]];
+		}
+	}
+}
+
+int PackResult(UVAtlasResult& result, const std::vector<uint32_t>& partitionAdjacency, const AtlasParams& params, const AtlasDeadline& deadline)
+{
+	int stop = 0;
+	auto statusCallback = StatusCallback(deadline, params.control, UVATLAS_PHASE_PACK, stop);
+	float callbackFrequency = statusCallback ? 0.001f : 0.1f;
+
+	AtlasPhaseTimer packTimer(params.control, UVATLAS_PHASE_PACK);
+	HRESULT hr = UVAtlasPack(result.vertices, result.indices, DXGI_FORMAT_R32_UINT,
+		params.width, params.height, params.gutter,
+		partitionAdjacency,
+		statusCallback, callbackFrequency);
+	if (FAILED(hr)) {
+		return AtlasFailed(hr, stop);
+	}
+	if (params.control && params.control->optimize) {
+		// Packing doesn't move faces, so the partition adjacency still matches the result.
+		OptimizeResult(result, partitionAdjacency);
+	}
+	return 0;
+}
+
+// Runs UVAtlasPartition and UVAtlasPack separately rather than through UVAtlasCreate, which does exactly the same,
+// so that each can be timed and the partition can also be kept and repacked by UVAtlasCharts.
+int AtlasBuffers(UVAtlasContext& ctx, const XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params,
+	const AtlasDeadline& deadline)
+{
+	int rc = AtlasAdjacency(ctx, positions, nVerts, indices, nFaces, params);
+	if (rc == 0) {
+		rc = deadline.Check();
+	}
+	if (rc) {
+		return rc;
+	}
+	rc = PartitionBuffers(ctx, positions, nVerts, indices, nFaces, params, deadline, ctx.result, ctx.partitionAdjacency);
+	if (rc) {
+		return rc;
+	}
+	if (params.control && params.control->lowMemory) {
+		// The partition holds everything packing needs, including a copy of each vertex position.
+		ReleaseBuffer(ctx.positions);
+		ReleaseBuffer(ctx.adjacency);
+		ReleaseBuffer(ctx.pointReps);
+		ReleaseBuffer(ctx.indices);
+		ReleaseBuffer(ctx.preflightAdjacency);
+		ReleaseBuffer(ctx.dupVerts);
+	}
+	rc = PackResult(ctx.result, ctx.partitionAdjacency, params, deadline);
+	if (rc == 0 && params.control && params.control->lowMemory) {
+		ReleaseBuffer(ctx.partitionAdjacency);
+		ctx.result.DropPositions();
+	}
+	return rc;
+}
+
+void UVAtlasResult::DropPositions()
+{
+	if (vertices.empty()) {
+		return;
+	}
+	uvs.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		uvs[i] = vertices[i].uv;
+	}
+	ReleaseBuffer(vertices);
+}
+
+int NaiveBuffers(UVAtlasResult& result, std::vector<uint32_t>& partitionAdjacency, const XMFLOAT3* positions, const uint32_t* indices, size_t nFaces,
+	const AtlasParams& params, const AtlasDeadline& deadline)
+{
+	AtlasPhaseTimer partitionTimer(params.control, UVATLAS_PHASE_PARTITION);
+	result.vertices.resize(nFaces * 3);
+	result.uvs.clear();
+	result.indices.resize(nFaces * 3 * sizeof(uint32_t));
+	result.vertexRemap.resize(nFaces * 3);
+	result.facePartitioning.resize(nFaces);
+	result.stretch = 0;
+	result.numCharts = (uint32_t)nFaces;
+	partitionAdjacency.assign(nFaces * 3, UINT32_MAX);
+	uint32_t* ib = reinterpret_cast<uint32_t*>(result.indices.data());
+	for (size_t f = 0; f < nFaces; f++) {
+		const uint32_t* face = indices + 3 * f;
+		XMVECTOR p[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = XMLoadFloat3(&positions[face[k]]);
+		}
+
+		// Rotate the corners, keeping the winding, so that the first edge is the longest and lies along u.
+		float len2[3];
+		for (int k = 0; k < 3; k++) {
+			len2[k] = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p[(k + 1) % 3], p[k])));
+		}
+		int first = (len2[0] >= len2[1] && len2[0] >= len2[2]) ? 0 : (len2[1] >= len2[2] ? 1 : 2);
+		XMVECTOR e1 = XMVectorSubtract(p[(first + 1) % 3], p[first]);
+		XMVECTOR e2 = XMVectorSubtract(p[(first + 2) % 3], p[first]);
+		float base = sqrtf(len2[first]);
+		float height = base > 0 ? XMVectorGetX(XMVector3Length(XMVector3Cross(e1, e2))) / base : 0;
+		if (!(height > 0)) {
+			wprintf(L"\nERROR: Failed generating naive atlas, face %zu has no area\n", f);
+			return 5;
+		}
+		XMFLOAT2 uvs[3] = { XMFLOAT2(0, 0), XMFLOAT2(base, 0), XMFLOAT2(XMVectorGetX(XMVector3Dot(e1, e2)) / base, height) };
+
+		for (int k = 0; k < 3; k++) {
+			size_t v = 3 * f + k;
+			uint32_t src = face[(first + k) % 3];
+			result.vertices[v].pos = positions[src];
+			result.vertices[v].uv = uvs[k];
+			result.vertexRemap[v] = src;
+			ib[v] = (uint32_t)v;
+		}
+		result.facePartitioning[f] = (uint32_t)f;
+	}
+	partitionTimer.Stop();
+
+	return PackResult(result, partitionAdjacency, params, deadline);
+}
+
+void AtlasPhaseTimer::Stop()
+{
+	if (!mStats) {
+		return;
+	}
+	mStats->wallSec += std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	counters.cb = sizeof(counters);
+	if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+		mStats->privateBytes = counters.PrivateUsage;
+		mStats->peakWorkingSetBytes = counters.PeakWorkingSetSize;
+	}
+	mStats->peakPrivateBytes = (std::max)(mStats->peakPrivateBytes, mStats->privateBytes);
+	mStats = nullptr;
+}
+
+void AtlasPhaseTimer::SampleMemory(const UVAtlasControl* control, UVAtlasPhase phase)
+{
+	if (!control || !control->phaseStats) {
+		return;
+	}
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	counters.cb = sizeof(counters);
+	if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters))) {
+		UVAtlasPhaseStats& stats = control->phaseStats[phase];
+		stats.peakPrivateBytes = (std::max)(stats.peakPrivateBytes, uint64_t(counters.PrivateUsage));
+	}
+}
+
+void AtlasPhaseTimer::Reset(const UVAtlasControl* control)
+{
+	if (control && control->phaseStats) {
+		for (int i = 0; i < UVATLAS_NUM_PHASES; i++) {
+			control->phaseStats[i] = UVAtlasPhaseStats();
+		}
+	}
+}
+
+// Narrows double positions about their centroid, since the atlas only depends on their relative placement and
+// site frame coordinates far from the origin would otherwise lose most of their float precision. x and y go through
+// SSE2 together, z on its own.
+static void NarrowDouble3(const uint8_t* src, size_t stride, size_t nVerts, XMFLOAT3* dst)
+{
+	__m128d sumXY = _mm_setzero_pd();
+	double sumZ = 0;
+	const uint8_t* p = src;
+	for (size_t i = 0; i < nVerts; i++, p += stride) {
+		const double* d = reinterpret_cast<const double*>(p);
+		sumXY = _mm_add_pd(sumXY, _mm_loadu_pd(d));
+		sumZ += d[2];
+	}
+	__m128d centerXY = _mm_div_pd(sumXY, _mm_set1_pd(double(nVerts)));
+	double centerZ = sumZ / double(nVerts);
+
+	p = src;
+	for (size_t i = 0; i < nVerts; i++, p += stride) {
+		const double* d = reinterpret_cast<const double*>(p);
+		__m128 xy = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(d), centerXY));
+		_mm_storel_pi(reinterpret_cast<__m64*>(&dst[i].x), xy);
+		dst[i].z = float(d[2] - centerZ);
+	}
+}
+
+int ReadInput(UVAtlasContext& ctx, const UVAtlasInput* input, const AtlasParams& params, const XMFLOAT3*& positions, AtlasParams& inputParams)
+{
+	AtlasPhaseTimer::Reset(params.control);
+	if (params.control && params.control->preflightStats) {
+		*params.control->preflightStats = UVAtlasPreflightStats();
+	}
+	AtlasPhaseTimer inputTimer(params.control, UVATLAS_PHASE_INPUT);
+
+	if (!input->numFaces || !input->indices) {
+		wprintf(L"\nERROR: Failed setting index data (%08X)\n", E_INVALIDARG);
+		return 2;
+	}
+
+	size_t elementSize = input->positionFormat == UVATLAS_POSITION_DOUBLE3 ? 3 * sizeof(double) : sizeof(XMFLOAT3);
+	size_t stride = input->positionStride ? input->positionStride : elementSize;
+	if (!input->numVertices || !input->positions || stride < elementSize ||
+		(input->positionFormat != UVATLAS_POSITION_FLOAT3 && input->positionFormat != UVATLAS_POSITION_DOUBLE3)) {
+		wprintf(L"\nERROR: Failed setting vertex data (%08X)\n", E_INVALIDARG);
+		return 3;
+	}
+
+	// Out of range indices or adjacency would be read past the end of their arrays by everything downstream.
+	const uint32_t* indexEnd = input->indices + size_t(input->numFaces) * 3;
+	if (std::any_of(input->indices, indexEnd, [&](uint32_t v) { return v >= input->numVertices; })) {
+		wprintf(L"\nERROR: Failed setting index data (%08X)\n", E_INVALIDARG);
+		return 2;
+	}
+	if (input->adjacency) {
+		const uint32_t* adjacencyEnd = input->adjacency + size_t(input->numFaces) * 3;
+		if (std::any_of(input->adjacency, adjacencyEnd, [&](uint32_t f) { return f >= input->numFaces && f != UINT32_MAX; })) {
+			wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", E_INVALIDARG);
+			return 4;
+		}
+	}
+
+	// Tightly packed float3 is exactly what UVAtlasCreate wants, so it is used in place.
+	// Anything else is packed once into the context's working buffer.
+	positions = reinterpret_cast<const XMFLOAT3*>(input->positions);
+	if (input->positionFormat != UVATLAS_POSITION_FLOAT3 || stride != sizeof(XMFLOAT3)) {
+		ctx.positions.resize(input->numVertices);
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(input->positions);
+		if (input->positionFormat == UVATLAS_POSITION_DOUBLE3) {
+			NarrowDouble3(src, stride, input->numVertices, ctx.positions.data());
+		}
+		else {
+			for (size_t i = 0; i < input->numVertices; i++, src += stride) {
+				const float* p = reinterpret_cast<const float*>(src);
+				ctx.positions[i] = XMFLOAT3(p[0], p[1], p[2]);
+			}
+		}
+		positions = ctx.positions.data();
+	}
+
+	inputParams = params;
+	inputParams.adjacency = input->adjacency;
+	inputParams.welded = input->welded != 0;
+	return 0;
+}
+
+// Removes faces marked unused, returning how many there were.
+static uint32_t CompactFaces(std::vector<uint32_t>& indices)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		if (indices[i] != UINT32_MAX) {
+			memmove(&indices[n], &indices[i], 3 * sizeof(uint32_t));
+			n += 3;
+		}
+	}
+	uint32_t removed = (uint32_t)((indices.size() - n) / 3);
+	indices.resize(n);
+	return removed;
+}
+
+// Drops faces with repeated corners or no area, which can't be charted.
+static uint32_t DropDegenerateFaces(std::vector<uint32_t>& indices, const XMFLOAT3* positions)
+{
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		uint32_t* face = &indices[i];
+		bool degenerate = face[0] == face[1] || face[1] == face[2] || face[2] == face[0];
+		if (!degenerate) {
+			XMVECTOR p0 = XMLoadFloat3(&positions[face[0]]);
+			XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&positions[face[1]]), p0);
+			XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&positions[face[2]]), p0);
+			degenerate = !(XMVectorGetX(XMVector3LengthSq(XMVector3Cross(e1, e2))) > 0);
+		}
+		if (degenerate) {
+			face[0] = face[1] = face[2] = UINT32_MAX;
+		}
+	}
+	return CompactFaces(indices);
+}
+
+// Merges every vertex into its point rep and drops vertices no face uses, leaving a welded mesh in ctx.
+static void WeldVertices(UVAtlasContext& ctx, const XMFLOAT3*& positions, size_t& nVerts, UVAtlasPreflightStats& stats)
+{
+	std::vector<uint32_t>& remap = ctx.dupVerts; // reused as scratch, old vertex -> welded vertex
+	remap.assign(nVerts, UINT32_MAX);
+	for (uint32_t& v : ctx.indices) {
+		v = ctx.pointReps[v];
+		remap[v] = 0;
+	}
+	std::vector<uint32_t> welded;
+	for (size_t v = 0; v < nVerts; v++) {
+		if (remap[v] != UINT32_MAX) {
+			remap[v] = (uint32_t)welded.size();
+			welded.push_back(ctx.preflightRemap.empty() ? (uint32_t)v : ctx.preflightRemap[v]);
+		}
+	}
+	for (uint32_t& v : ctx.indices) {
+		v = remap[v];
+	}
+
+	std::vector<XMFLOAT3> weldedPositions(welded.size());
+	for (size_t v = 0, w = 0; v < nVerts; v++) {
+		if (remap[v] != UINT32_MAX) {
+			weldedPositions[w++] = positions[v];
+		}
+	}
+	stats.weldedVertices = (uint32_t)(nVerts - welded.size());
+	ctx.positions.swap(weldedPositions);
+	ctx.preflightRemap.swap(welded);
+	positions = ctx.positions.data();
+	nVerts = ctx.positions.size();
+	ctx.pointReps.resize(nVerts);
+	std::iota(ctx.pointReps.begin(), ctx.pointReps.end(), 0u);
+}
+
+int Preflight(UVAtlasContext& ctx, const XMFLOAT3*& positions, size_t& nVerts, const uint32_t*& indices, size_t& nFaces, AtlasParams& params)
+{
+	ctx.preflightRemap.clear();
+	const UVAtlasControl* control = params.control;
+	if (!control || !(control->preflight & (UVATLAS_PREFLIGHT | UVATLAS_PREFLIGHT_WELD))) {
+		return 0;
+	}
+	UVAtlasPreflightStats stats;
+
+	AtlasPhaseTimer inputTimer(control, UVATLAS_PHASE_INPUT);
+	ctx.indices.assign(indices, indices + nFaces * 3);
+	if (control->preflight & UVATLAS_PREFLIGHT) {
+		stats.degenerateFaces = DropDegenerateFaces(ctx.indices, positions);
+		if (ctx.indices.empty()) {
+			wprintf(L"\nERROR: No faces left after dropping %u degenerate faces\n", stats.degenerateFaces);
+			return 2;
+		}
+		if (stats.degenerateFaces) {
+			// Supplied adjacency refers to the input faces.
+			params.adjacency = nullptr;
+		}
+	}
+	inputTimer.Stop();
+
+	size_t nOutFaces = ctx.indices.size() / 3;
+	int rc = AtlasAdjacency(ctx, positions, nVerts, ctx.indices.data(), nOutFaces, params);
+	if (rc) {
+		return rc;
+	}
+
+	AtlasPhaseTimer cleanTimer(control, UVATLAS_PHASE_INPUT);
+	if (control->preflight & UVATLAS_PREFLIGHT_WELD) {
+		// The point reps already say which vertices coincide, so welding is just relabeling. Faces whose corners
+		// collapse together are dropped, and since the result is welded its adjacency follows from the indices.
+		WeldVertices(ctx, positions, nVerts, stats);
+		stats.degenerateFaces += DropDegenerateFaces(ctx.indices, positions);
+		if (ctx.indices.empty()) {
+			wprintf(L"\nERROR: No faces left after welding\n");
+			return 2;
+		}
+		nOutFaces = ctx.indices.size() / 3;
+		ctx.adjacency.resize(nOutFaces * 3);
+		HRESULT hr = ConvertPointRepsToAdjacency(ctx.indices.data(), nOutFaces, positions, nVerts, ctx.pointReps.data(), ctx.adjacency.data());
+		if (FAILED(hr)) {
+			wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", hr);
+			return 4;
+		}
+	}
+
+	if (control->preflight & UVATLAS_PREFLIGHT) {
+		bool breakBowties = (control->preflight & UVATLAS_PREFLIGHT_BREAK_BOWTIES) != 0;
+		DWORD validateFlags = VALIDATE_BACKFACING | (breakBowties ? VALIDATE_BOWTIES : 0);
+		HRESULT hr = Validate(ctx.indices.data(), nOutFaces, nVerts, ctx.adjacency.data(), static_cast<VALIDATE_FLAGS>(validateFlags), nullptr);
+		stats.validateResult = hr;
+		if (FAILED(hr)) {
+			ctx.dupVerts.clear();
+			hr = Clean(ctx.indices.data(), nOutFaces, nVerts, ctx.adjacency.data(), nullptr, ctx.dupVerts, breakBowties);
+			if (FAILED(hr)) {
+				wprintf(L"\nERROR: Failed cleaning mesh (%08X)\n", hr);
+				return 4;
+			}
+			stats.removedFaces = CompactFaces(ctx.indices);
+			if (ctx.indices.empty()) {
+				wprintf(L"\nERROR: No faces left after cleaning\n");
+				return 4;
+			}
+			nOutFaces = ctx.indices.size() / 3;
+
+			// Duplicated vertices are their own point reps, so adjacency can't rejoin what Clean split.
+			size_t nDups = ctx.dupVerts.size();
+			if (nDups) {
+				stats.duplicatedVertices = (uint32_t)nDups;
+				if (positions != ctx.positions.data()) {
+					ctx.positions.assign(positions, positions + nVerts);
+				}
+				if (ctx.preflightRemap.empty()) {
+					ctx.preflightRemap.resize(nVerts);
+					std::iota(ctx.preflightRemap.begin(), ctx.preflightRemap.end(), 0u);
+				}
+				ctx.positions.resize(nVerts + nDups);
+				ctx.preflightRemap.resize(nVerts + nDups);
+				ctx.pointReps.resize(nVerts + nDups);
+				for (size_t i = 0; i < nDups; i++) {
+					ctx.positions[nVerts + i] = ctx.positions[ctx.dupVerts[i]];
+					ctx.preflightRemap[nVerts + i] = ctx.preflightRemap[ctx.dupVerts[i]];
+					ctx.pointReps[nVerts + i] = (uint32_t)(nVerts + i);
+				}
+				positions = ctx.positions.data();
+				nVerts += nDups;
+			}
+			ctx.adjacency.resize(nOutFaces * 3);
+			hr = ConvertPointRepsToAdjacency(ctx.indices.data(), nOutFaces, positions, nVerts, ctx.pointReps.data(), ctx.adjacency.data());
+			if (FAILED(hr)) {
+				wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", hr);
+				return 4;
+			}
+		}
+	}
+
+	ctx.preflightAdjacency = ctx.adjacency;
+	params.adjacency = ctx.preflightAdjacency.data();
+	indices = ctx.indices.data();
+	nFaces = nOutFaces;
+	if (control->preflightStats) {
+		*control->preflightStats = stats;
+	}
+	return 0;
+}
+
+void PreflightRemap(const UVAtlasContext& ctx, UVAtlasResult& result)
+{
+	if (ctx.preflightRemap.empty()) {
+		return;
+	}
+	for (uint32_t& v : result.vertexRemap) {
+		v = ctx.preflightRemap[v];
+	}
+}
+
+static int AtlasInputCached(UVAtlasContext& ctx, const UVAtlasInput* input, const AtlasParams& params, const AtlasDeadline& deadline)
+{
+	const XMFLOAT3* positions = nullptr;
+	AtlasParams inputParams;
+	int rc = ReadInput(ctx, input, params, positions, inputParams);
+	if (rc) {
+		return rc;
+	}
+
+	const wchar_t* cacheDir = params.control ? params.control->cacheDir : nullptr;
+	std::wstring cacheKey;
+	if (cacheDir && AtlasCacheKey(positions, input->numVertices, input->indices, input->numFaces, inputParams, cacheKey) &&
+		AtlasCacheRead(cacheDir, cacheKey, positions, input->numVertices, ctx.result)) {
+		if (params.control && params.control->lowMemory) {
+			ctx.result.DropPositions();
+		}
+		return 0;
+	}
+
+	size_t nVerts = input->numVertices, nFaces = input->numFaces;
+	const uint32_t* indices = input->indices;
+	rc = Preflight(ctx, positions, nVerts, indices, nFaces, inputParams);
+	if (rc == 0) {
+		rc = deadline.Check();
+	}
+	if (rc) {
+		return rc;
+	}
+
+	rc = AtlasBuffers(ctx, positions, nVerts, indices, nFaces, inputParams, deadline);
+	if (rc) {
+		return rc;
+	}
+	PreflightRemap(ctx, ctx.result);
+	if (params.control && params.control->lowMemory) {
+		ReleaseBuffer(ctx.preflightRemap);
+	}
+	if (!cacheKey.empty()) {
+		AtlasCacheWrite(cacheDir, cacheKey, ctx.result);
+	}
+	return 0;
+}
+
+int AtlasInput(UVAtlasContext& ctx, const UVAtlasInput* input, const AtlasParams& params)
+{
+	auto start = std::chrono::steady_clock::now();
+	AtlasDeadline deadline(params.control);
+	int rc = AtlasInputCached(ctx, input, params, deadline);
+	AtlasCapture(input, params, rc, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), ctx.result);
+	return rc;
+}
+
+int AtlasLadder(UVAtlasContext& ctx, const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, const AtlasParams& params, int& strategyIndex)
+{
+	strategyIndex = -1;
+	if (!strategies || !numStrategies) {
+		wprintf(L"\nERROR: No atlas strategies\n");
+		return 1;
+	}
+
+	AtlasDeadline deadline(params.control);
+	const XMFLOAT3* positions = nullptr;
+	AtlasParams inputParams;
+	int rc = ReadInput(ctx, input, params, positions, inputParams);
+	if (rc) {
+		return rc;
+	}
+
+	size_t nVerts = input->numVertices, nFaces = input->numFaces;
+	const uint32_t* indices = input->indices;
+	rc = Preflight(ctx, positions, nVerts, indices, nFaces, inputParams);
+	if (rc == 0) {
+		rc = deadline.Check();
+	}
+	if (rc) {
+		return rc;
+	}
+
+	rc = AtlasAdjacency(ctx, positions, nVerts, indices, nFaces, inputParams);
+	if (rc == 0) {
+		rc = deadline.Check();
+	}
+	if (rc) {
+		return rc;
+	}
+
+	for (uint32_t i = 0; i < numStrategies; i++) {
+		const UVAtlasStrategy& strategy = strategies[i];
+		AtlasParams attempt = inputParams;
+		attempt.maxCharts = strategy.maxCharts;
+		attempt.maxStretch = strategy.maxStretch;
+		attempt.uvOptions = strategy.uvOptions;
+		if (strategy.naive) {
+			rc = NaiveBuffers(ctx.result, ctx.partitionAdjacency, positions, indices, nFaces, attempt, deadline);
+		}
+		else {
+			rc = PartitionBuffers(ctx, positions, nVerts, indices, nFaces, attempt, deadline, ctx.result, ctx.partitionAdjacency);
+			if (rc == 0) {
+				rc = PackResult(ctx.result, ctx.partitionAdjacency, attempt, deadline);
+			}
+		}
+		if (rc == 0) {
+			PreflightRemap(ctx, ctx.result);
+			strategyIndex = (int)i;
+			return 0;
+		}
+		if (rc == ATLAS_CANCELLED || rc == ATLAS_TIMED_OUT) {
+			return rc;
+		}
+	}
+	return rc;
+}
+
+// Converts a result into the legacy UVAtlasData layout.
+static UVAtlasData* ToUVAtlasData(const UVAtlasResult& atlas)
+{
+	UVAtlasData* result = new UVAtlasData;
+	result->numVertices = atlas.GetVertexCount();
+	result->numFaces = atlas.GetFaceCount();
+	result->us = new float[result->numVertices];
+	result->vs = new float[result->numVertices];
+	result->xs = nullptr;
+	result->ys = nullptr;
+	result->zs = nullptr;
+	result->indices = new uint32_t[result->numFaces * 3];
+	result->vertexRemap = new uint32_t[result->numVertices];
+	result->facePartitioning = new uint32_t[result->numFaces];
+	UVAtlasResult_Copy(&atlas, result->us, result->vs, result->indices, result->vertexRemap);
+	UVAtlasResult_GetCharts(&atlas, result->stretch, result->numCharts, result->facePartitioning);
+	return result;
+}
+
 extern "C" __declspec(dllexport) UVAtlasData* __cdecl UVAtlas(UVAtlasData* data, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, int& returnCode)
 {
 	returnCode = 1;
@@ -54,69 +780,219 @@ extern "C" __declspec(dllexport) UVAtlasData* __cdecl UVAtlas(UVAtlasData* data,
 		return nullptr;
 	}
 
-	// Prepare mesh for processing
-	hr = inMesh->GenerateAdjacency(adjacencyEpsilon);
-	if (FAILED(hr))
-	{
-		wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", hr);
-		returnCode = 4;
-		return nullptr;
+	UVAtlasContext ctx;
+	AtlasParams params = { maxCharts, maxStretch, gutter, width, height, uvOptions, adjacencyEpsilon };
+	AtlasDeadline deadline(params.control);
+	returnCode = AtlasBuffers(ctx, inMesh->GetPositionBuffer(), inMesh->GetVertexCount(), inMesh->GetIndexBuffer(), inMesh->GetFaceCount(), params, deadline);
+	return returnCode == 0 ? ToUVAtlasData(ctx.result) : nullptr;
+}
+
+extern "C" __declspec(dllexport) UVAtlasData* __cdecl UVAtlasInterleaved(const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, int& returnCode)
+{
+	UVAtlasContext ctx;
+	AtlasParams params = { maxCharts, maxStretch, gutter, width, height, uvOptions, adjacencyEpsilon };
+	returnCode = AtlasInput(ctx, input, params);
+	return returnCode == 0 ? ToUVAtlasData(ctx.result) : nullptr;
+}
+
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_Create(const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode)
+{
+	UVAtlasContext ctx;
+	AtlasParams params = { maxCharts, maxStretch, gutter, width, height, uvOptions, adjacencyEpsilon, control };
+	returnCode = AtlasInput(ctx, input, params);
+	return returnCode == 0 ? new UVAtlasResult(std::move(ctx.result)) : nullptr;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_GetSize(const UVAtlasResult* result, uint32_t& numVertices, uint32_t& numFaces)
+{
+	numVertices = result->GetVertexCount();
+	numFaces = result->GetFaceCount();
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_Copy(const UVAtlasResult* result, float* us, float* vs, uint32_t* indices, uint32_t* vertexRemap)
+{
+	size_t nVerts = result->GetVertexCount();
+	for (size_t i = 0; i < nVerts; i++) {
+		const XMFLOAT2& uv = result->GetUV(i);
+		if (us) {
+			us[i] = uv.x;
+		}
+		if (vs) {
+			vs[i] = uv.y;
+		}
 	}
+	if (vertexRemap && nVerts) {
+		memcpy(vertexRemap, result->vertexRemap.data(), sizeof(uint32_t) * nVerts);
+	}
+	if (indices && !result->indices.empty()) {
+		memcpy(indices, result->indices.data(), result->indices.size());
+	}
+}
 
-	std::vector<UVAtlasVertex> vb;
-	std::vector<uint8_t> ib;
-	float outStretch = 0.f;
-	size_t outCharts = 0;
-	std::vector<uint32_t> facePartitioning;
-	std::vector<uint32_t> vertexRemapArray;
+// Results are always built with 32 bit indices, since every stage and the cache work in them, and narrowed on the
+// way out. 0xFFFF is left out of 16 bit range as it reads as a strip cut.
+extern "C" __declspec(dllexport) uint32_t __cdecl UVAtlasResult_GetIndexFormat(const UVAtlasResult* result)
+{
+	return result->GetVertexCount() < UINT16_MAX ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
 
-	hr = UVAtlasCreate(inMesh->GetPositionBuffer(), inMesh->GetVertexCount(),
-		inMesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, data->numFaces,
-		maxCharts, maxStretch, width, height, gutter,
-		inMesh->GetAdjacencyBuffer(), nullptr,
-		nullptr,
-		0, 0.1f,
-		uvOptions, vb, ib,
-		nullptr,
-		&vertexRemapArray,
-		&outStretch, &outCharts);
+// Copies the indices in the given DXGI format, returning 1 without copying if they don't fit it.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasResult_CopyIndices(const UVAtlasResult* result, uint32_t format, void* indices)
+{
+	const uint32_t* ib = reinterpret_cast<const uint32_t*>(result->indices.data());
+	size_t nIndices = size_t(result->GetFaceCount()) * 3;
+	switch (format) {
+	case DXGI_FORMAT_R32_UINT:
+		UVAtlasResult_Copy(result, nullptr, nullptr, reinterpret_cast<uint32_t*>(indices), nullptr);
+		return 0;
+	case DXGI_FORMAT_R16_UINT:
+		if (UVAtlasResult_GetIndexFormat(result) != DXGI_FORMAT_R16_UINT) {
+			return 1;
+		}
+		for (size_t i = 0; i < nIndices; i++) {
+			reinterpret_cast<uint16_t*>(indices)[i] = (uint16_t)ib[i];
+		}
+		return 0;
+	default:
+		return 1;
+	}
+}
 
-	if (FAILED(hr))
-	{
-		wprintf(L"\nERROR: Failed generating Atlas (%08X)\n", hr);
-		returnCode = 5;
-		return nullptr;
+// Gathers every stream in one pass over the output vertices, so each remap entry is read once. Returns 3 without
+// writing anything if a stream has fewer elements than the result refers to.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasResult_Expand(const UVAtlasResult* result, const UVAtlasStream* streams, uint32_t numStreams)
+{
+	size_t nVerts = result->vertexRemap.size();
+	const uint32_t* remap = result->vertexRemap.data();
+	uint32_t maxRemap = nVerts ? *std::max_element(remap, remap + nVerts) : 0;
+	for (uint32_t s = 0; s < numStreams; s++) {
+		if (streams[s].input && streams[s].output && nVerts && maxRemap >= streams[s].numElements) {
+			wprintf(L"\nERROR: Attribute stream %u has %u elements, result needs %u\n", s, streams[s].numElements, maxRemap + 1);
+			return 3;
+		}
 	}
-	UVAtlasData* result = new UVAtlasData;
-	result->numVertices = (uint32_t)vb.size();
-	result->us = new float[vb.size()];
-	result->vs = new float[vb.size()];
+	for (size_t i = 0; i < nVerts; i++) {
+		for (uint32_t s = 0; s < numStreams; s++) {
+			const UVAtlasStream& stream = streams[s];
+			if (stream.input && stream.output) {
+				memcpy(reinterpret_cast<uint8_t*>(stream.output) + i * stream.elementSize,
+					reinterpret_cast<const uint8_t*>(stream.input) + size_t(remap[i]) * stream.elementSize, stream.elementSize);
+			}
+		}
+	}
+	return 0;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_GetCharts(const UVAtlasResult* result, float& stretch, uint32_t& numCharts, uint32_t* facePartitioning)
+{
+	stretch = result->stretch;
+	numCharts = result->numCharts;
+	if (facePartitioning && !result->facePartitioning.empty()) {
+		memcpy(facePartitioning, result->facePartitioning.data(), sizeof(uint32_t) * result->facePartitioning.size());
+	}
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_Destroy(UVAtlasResult* result)
+{
+	delete result;
+}
 
-	uint32_t* realIndices = reinterpret_cast<uint32_t*>(&ib[0]);
-	size_t indexCount = ib.size() / sizeof(uint32_t);
-	result->numFaces = (uint32_t)(indexCount / 3);
-	result->indices = new uint32_t[indexCount];
+extern "C" __declspec(dllexport) UVAtlasContext* __cdecl UVAtlasContext_Create()
+{
+	return new (std::nothrow) UVAtlasContext;
+}
+
+extern "C" __declspec(dllexport) const UVAtlasResult* __cdecl UVAtlasContext_Atlas(UVAtlasContext* context, const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode)
+{
+	AtlasParams params = { maxCharts, maxStretch, gutter, width, height, uvOptions, adjacencyEpsilon, control };
+	returnCode = AtlasInput(*context, input, params);
+	return returnCode == 0 ? &context->result : nullptr;
+}
+
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_CreateLadder(const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, float gutter, int width, int height, float adjacencyEpsilon, const UVAtlasControl* control, int& strategyIndex, int& returnCode)
+{
+	UVAtlasContext ctx;
+	AtlasParams params = { 0, 0, gutter, width, height, 0, adjacencyEpsilon, control };
+	returnCode = AtlasLadder(ctx, input, strategies, numStrategies, params, strategyIndex);
+	return returnCode == 0 ? new UVAtlasResult(std::move(ctx.result)) : nullptr;
+}
 
-	for (size_t i = 0; i < vb.size(); i++) {
-		result->us[i] = vb[i].uv.x;
-		result->vs[i] = vb[i].uv.y;
+extern "C" __declspec(dllexport) const UVAtlasResult* __cdecl UVAtlasContext_AtlasLadder(UVAtlasContext* context, const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, float gutter, int width, int height, float adjacencyEpsilon, const UVAtlasControl* control, int& strategyIndex, int& returnCode)
+{
+	AtlasParams params = { 0, 0, gutter, width, height, 0, adjacencyEpsilon, control };
+	returnCode = AtlasLadder(*context, input, strategies, numStrategies, params, strategyIndex);
+	return returnCode == 0 ? &context->result : nullptr;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasContext_Destroy(UVAtlasContext* context)
+{
+	delete context;
+}
+
+extern "C" __declspec(dllexport) UVAtlasCharts* __cdecl UVAtlasCharts_Create(const UVAtlasInput* input, int maxCharts, float maxStretch, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode)
+{
+	UVAtlasContext ctx;
+	AtlasParams params = { maxCharts, maxStretch, 0, 0, 0, uvOptions, adjacencyEpsilon, control };
+	AtlasDeadline deadline(control);
+	const XMFLOAT3* positions = nullptr;
+	AtlasParams inputParams;
+	returnCode = ReadInput(ctx, input, params, positions, inputParams);
+	if (returnCode) {
+		return nullptr;
 	}
-	for (size_t i = 0; i < indexCount; i++) {
-		result->indices[i] = realIndices[i];
+	std::unique_ptr<UVAtlasCharts> charts(new (std::nothrow) UVAtlasCharts);
+	if (!charts) {
+		returnCode = 1;
+		return nullptr;
 	}
-	result->vertexRemap = new uint32_t[vertexRemapArray.size()];
-	for (size_t i = 0; i < vertexRemapArray.size(); i++) {
-		result->vertexRemap[i] = vertexRemapArray[i];
+	size_t nVerts = input->numVertices, nFaces = input->numFaces;
+	const uint32_t* indices = input->indices;
+	returnCode = Preflight(ctx, positions, nVerts, indices, nFaces, inputParams);
+	if (returnCode == 0) {
+		returnCode = deadline.Check();
 	}
-	returnCode = 0;
-	return result;
+	if (returnCode) {
+		return nullptr;
+	}
+	returnCode = AtlasAdjacency(ctx, positions, nVerts, indices, nFaces, inputParams);
+	if (returnCode == 0) {
+		returnCode = deadline.Check();
+	}
+	if (returnCode == 0) {
+		returnCode = PartitionBuffers(ctx, positions, nVerts, indices, nFaces, inputParams, deadline,
+			charts->partitioned, charts->partitionAdjacency);
+	}
+	if (returnCode == 0) {
+		PreflightRemap(ctx, charts->partitioned);
+	}
+	return returnCode == 0 ? charts.release() : nullptr;
+}
+
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasCharts_Pack(const UVAtlasCharts* charts, float gutter, int width, int height, const UVAtlasControl* control, int& returnCode)
+{
+	AtlasPhaseTimer::Reset(control);
+	AtlasParams params = { 0, 0, gutter, width, height, 0, 0, control };
+	AtlasDeadline deadline(control);
+	std::unique_ptr<UVAtlasResult> result(new (std::nothrow) UVAtlasResult(charts->partitioned));
+	if (!result) {
+		returnCode = 1;
+		return nullptr;
+	}
+	returnCode = PackResult(*result, charts->partitionAdjacency, params, deadline);
+	return returnCode == 0 ? result.release() : nullptr;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasCharts_Destroy(UVAtlasCharts* charts)
+{
+	delete charts;
 }
 
 extern "C" __declspec(dllexport) void __cdecl UVAtlasData_Destroy(UVAtlasData* data)
 {
-	delete data->indices;
-	delete data->us;
-	delete data->vs;
-	delete data->vertexRemap;
+	delete[] data->indices;
+	delete[] data->us;
+	delete[] data->vs;
+	delete[] data->vertexRemap;
+	delete[] data->facePartitioning;
 	delete data;
 }
@@ -20,8 +20,309 @@ struct UVAtlasData {
 	uint32_t* indices;
 	
 	uint32_t* vertexRemap;
+
+	// Outputs only: the stretch and number of charts reported by the partition, and the chart of each face.
+	float stretch = 0;
+	uint32_t numCharts = 0;
+	uint32_t* facePartitioning;
+};
+
+// Caller-owned interleaved mesh input, read in place without an intermediate copy when possible.
+// positions points at numVertices elements of positionFormat spaced positionStride bytes apart
+// (0 means tightly packed); indices points at numFaces * 3 vertex indices.
+// Double positions are recentered about their centroid as they are narrowed, which doesn't change the atlas.
+struct UVAtlasInput {
+	const void* positions;
+	uint32_t positionStride = 0;
+	uint32_t positionFormat = 0;
+	uint32_t numVertices = 0;
+
+	const uint32_t* indices;
+	uint32_t numFaces = 0;
+
+	// Optional known topology, so that adjacency isn't found by an epsilon search over the positions.
+	// adjacency, if not null, holds numFaces * 3 neighboring faces (UINT32_MAX for none) and is used as is.
+	// Otherwise, if welded is non-zero, faces are adjacent exactly when their edges share vertex indices.
+	const uint32_t* adjacency;
+	uint32_t welded = 0;
+};
+
+// Wall time of one phase of an atlas call, with process-wide memory sampled when it ended.
+// peakPrivateBytes is the most private memory sampled during the phase, at each status poll and at its end.
+struct UVAtlasPhaseStats {
+	double wallSec = 0;
+	uint64_t privateBytes = 0;
+	uint64_t peakWorkingSetBytes = 0;
+	uint64_t peakPrivateBytes = 0;
+};
+
+// What the optional preflight stage found and repaired before atlasing.
+// validateResult is the HRESULT of DirectXMesh Validate, the mesh is only cleaned if it failed.
+struct UVAtlasPreflightStats {
+	uint32_t degenerateFaces = 0;
+	uint32_t removedFaces = 0;
+	uint32_t duplicatedVertices = 0;
+	int32_t validateResult = 0;
+	uint32_t weldedVertices = 0;
+};
+
+// Per-vertex attribute stream of the input, e.g. normals or colors, expanded through a result's vertexRemap into
+// output, which must hold one element for each output vertex. elementSize is in bytes, e.g. 3 * sizeof(double),
+// and numElements is the number of input elements.
+struct UVAtlasStream {
+	const void* input;
+	void* output;
+	uint32_t elementSize = 0;
+	uint32_t numElements = 0;
+};
+
+// Called with the progress of the current UVAtlasPhase, on the thread running the call.
+typedef void (__cdecl *UVAtlasProgressCallback)(int phase, float percentComplete, void* userData);
+
+// Optional controls for a long running atlas call.
+// cancel, if not null, is polled while charting and may be set non-zero from any thread to stop the call.
+// maxSec is a wall clock limit measured from the start of the call (per item in a batch), 0 for none.
+// progress and phaseStats (UVATLAS_NUM_PHASES entries, filled even if the call fails) are ignored by UVAtlasBatch.
+// cacheDir, if not null, is a directory of results keyed by a hash of the input and parameters; a hit skips the
+// adjacency, partition and pack phases entirely. It is not used by UVAtlasCharts, which never packs on its own,
+// nor by ladders, whose result depends on which strategy succeeded.
+// preflight (UVAtlasPreflight flags) drops degenerate faces, optionally welds coincident vertices (per the adjacency
+// point reps), then validates and if needed cleans the mesh, filling preflightStats if not null (ignored by
+// UVAtlasBatch). Welds and repairs are folded into the output vertexRemap.
+// optimize, if non-zero, reorders the packed faces for vertex cache locality and the vertices for fetch locality,
+// folding the permutation into vertexRemap and facePartitioning. It is timed as part of UVATLAS_PHASE_PACK.
+// lowMemory, if non-zero, frees each stage's buffers as soon as the next stage has consumed them, even from a
+// reused UVAtlasContext, and keeps only uvs of the output vertices. It is ignored by UVAtlasCharts and ladders, which
+// need their buffers again.
+// captureDir, if not null, is a directory where the input and parameters of a call are written as a job file (see
+// UVAtlasJob_Write) along with its outcome, if any of the capture (UVAtlasCapture) conditions hold: the call failed,
+// took longer than captureSlowSec, or was picked with probability captureSampleRate. Not used by UVAtlasCharts nor
+// ladders.
+struct UVAtlasControl {
+	volatile int32_t* cancel;
+	double maxSec = 0;
+
+	UVAtlasProgressCallback progress;
+	void* progressUserData;
+	UVAtlasPhaseStats* phaseStats;
+
+	const wchar_t* cacheDir;
+
+	uint32_t preflight = 0;
+	UVAtlasPreflightStats* preflightStats;
+
+	int32_t optimize = 0;
+	int32_t lowMemory = 0;
+
+	const wchar_t* captureDir;
+	uint32_t capture = 0;
+	double captureSlowSec = 0;
+	float captureSampleRate = 0;
+};
+
+// How an atlas call ended, as recorded in a captured job and when it is replayed.
+// returnCode is -1 if the job was not captured from a call. numVertices is the output vertex count.
+struct UVAtlasJobOutcome {
+	int32_t returnCode = -1;
+	double wallSec = 0;
+	uint32_t numVertices = 0;
+	uint32_t numCharts = 0;
+	float stretch = 0;
+};
+
+// One mesh of a UVAtlasBatch call with its own atlas parameters.
+struct UVAtlasBatchItem {
+	UVAtlasInput input;
+	int32_t maxCharts = 0;
+	float maxStretch = 0;
+	float gutter = 0;
+	int32_t width = 0;
+	int32_t height = 0;
+	uint32_t uvOptions = 0;
+	float adjacencyEpsilon = 0;
+};
+// One attempt of an atlas ladder, overriding the partition parameters of the call.
+// naive, if non-zero, skips partitioning and gives every face its own chart, which only fails on zero area faces.
+struct UVAtlasStrategy {
+	int32_t naive = 0;
+	int32_t maxCharts = 0;
+	float maxStretch = 0;
+	uint32_t uvOptions = 0;
+};
+
+// Caller-owned float image with numBands planar bands of width * height row-major texels each.
+struct UVAtlasImage {
+	float* const* bands;
+	uint32_t numBands = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Caller-owned textured mesh for baking, with numVertices xyz positions and uv pairs and numFaces * 3 indices.
+struct UVAtlasBakeMesh {
+	const double* positions;
+	const double* uvs;
+	uint32_t numVertices = 0;
+	const uint32_t* indices;
+	uint32_t numFaces = 0;
+};
+
+// One source of a UVAtlasBaker: a mesh, its texture and optionally an index image (null bands for none).
+struct UVAtlasBakeSource {
+	UVAtlasBakeMesh mesh;
+	UVAtlasImage image;
+	UVAtlasImage index;
+};
+
+// Affine remap of mesh uvs into [targetMin, targetMax] for UVAtlasUVStats_Compute, as MeshUVs.RescaleUVs.
+// maxStretch <= 0 forces the same scale on both axes, maxStretch < 1 limits the ratio of the scales to
+// 1 / (1 - maxStretch). If growThreshold > 0 and the uvs already fit within growThreshold of the target in both axes
+// they are left as they are.
+struct UVAtlasUVRescale {
+	double targetMin[2];
+	double targetMax[2];
+	double maxStretch;
+	double growThreshold;
+};
+
+// Texel density histogram for UVAtlasUVStats_Compute: numBins bins evenly spaced in log2 of texels per unit length
+// from minDensity to maxDensity, each summing the 3D area of the faces in it. Densities out of range go in the end bins.
+struct UVAtlasUVHistogram {
+	double* bins;
+	uint32_t numBins;
+	double minDensity;
+	double maxDensity;
+};
+
+// Output of UVAtlasUVStats_Compute. Areas are unsigned. Stretch is the largest and smallest singular value of the map
+// from a face to texel space, texels per unit length, over faces with nonzero 3D area (0 if there are none).
+struct UVAtlasUVStats {
+	double uvMin[2];
+	double uvMax[2];
+	double area;
+	double uvArea;
+	double pixelArea;
+	double minFaceArea;
+	double maxFaceArea;
+	double minStretch;
+	double maxStretch;
+	int32_t rescaled;
 };
 #pragma pack(pop)
 
+// Opaque handle to a completed atlas, see UVAtlasResult_GetSize and UVAtlasResult_Copy.
+struct UVAtlasResult;
+
+// Opaque handle to a partitioned mesh that can be packed repeatedly, see UVAtlasCharts_Pack.
+struct UVAtlasCharts;
+
+// Opaque per-thread handle owning scratch memory that is reused across atlas calls.
+// The result returned by UVAtlasContext_Atlas is owned by the context and valid until its next call.
+struct UVAtlasContext;
+
+// Opaque handle to the source triangles of a bake, see UVAtlasBaker_Create.
+struct UVAtlasBaker;
+
+// Opaque handle to the texels covered by the uvs of a mesh, see UVAtlasSamples_Create.
+struct UVAtlasSamples;
+
+// Called from a batch worker thread as soon as each item finishes, possibly concurrently with other items.
+// result is null on failure and is only valid for the duration of the callback.
+typedef void (__cdecl *UVAtlasBatchCallback)(uint32_t index, int returnCode, const UVAtlasResult* result, void* userData);
+
+// UVATLAS_PHASE_OUTPUT is left to the caller to fill, since results are copied out after the call returns.
+enum UVAtlasPhase {
+	UVATLAS_PHASE_INPUT = 0,
+	UVATLAS_PHASE_ADJACENCY = 1,
+	UVATLAS_PHASE_PARTITION = 2,
+	UVATLAS_PHASE_PACK = 3,
+	UVATLAS_PHASE_OUTPUT = 4,
+	UVATLAS_NUM_PHASES = 5,
+};
+
+enum UVAtlasPreflight {
+	UVATLAS_PREFLIGHT = 0x1,
+	UVATLAS_PREFLIGHT_BREAK_BOWTIES = 0x2,
+	UVATLAS_PREFLIGHT_WELD = 0x4,
+};
+
+enum UVAtlasCapture {
+	UVATLAS_CAPTURE_FAILED = 0x1,
+	UVATLAS_CAPTURE_SLOW = 0x2,
+	UVATLAS_CAPTURE_SAMPLED = 0x4,
+};
+
+enum UVAtlasPositionFormat {
+	UVATLAS_POSITION_FLOAT3 = 0,
+	UVATLAS_POSITION_DOUBLE3 = 1,
+};
+
 extern "C" __declspec(dllexport) UVAtlasData* __cdecl UVAtlas(UVAtlasData* data, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, int& returnCode);
+extern "C" __declspec(dllexport) UVAtlasData* __cdecl UVAtlasInterleaved(const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, int& returnCode);
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_Create(const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_GetSize(const UVAtlasResult* result, uint32_t& numVertices, uint32_t& numFaces);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_Copy(const UVAtlasResult* result, float* us, float* vs, uint32_t* indices, uint32_t* vertexRemap);
+extern "C" __declspec(dllexport) uint32_t __cdecl UVAtlasResult_GetIndexFormat(const UVAtlasResult* result);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasResult_CopyIndices(const UVAtlasResult* result, uint32_t format, void* indices);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasResult_Expand(const UVAtlasResult* result, const UVAtlasStream* streams, uint32_t numStreams);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_GetCharts(const UVAtlasResult* result, float& stretch, uint32_t& numCharts, uint32_t* facePartitioning);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasResult_Destroy(UVAtlasResult* result);
+extern "C" __declspec(dllexport) UVAtlasContext* __cdecl UVAtlasContext_Create();
+extern "C" __declspec(dllexport) const UVAtlasResult* __cdecl UVAtlasContext_Atlas(UVAtlasContext* context, const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode);
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_CreateLadder(const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, float gutter, int width, int height, float adjacencyEpsilon, const UVAtlasControl* control, int& strategyIndex, int& returnCode);
+extern "C" __declspec(dllexport) const UVAtlasResult* __cdecl UVAtlasContext_AtlasLadder(UVAtlasContext* context, const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, float gutter, int width, int height, float adjacencyEpsilon, const UVAtlasControl* control, int& strategyIndex, int& returnCode);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasContext_Destroy(UVAtlasContext* context);
+extern "C" __declspec(dllexport) UVAtlasCharts* __cdecl UVAtlasCharts_Create(const UVAtlasInput* input, int maxCharts, float maxStretch, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control, int& returnCode);
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasCharts_Pack(const UVAtlasCharts* charts, float gutter, int width, int height, const UVAtlasControl* control, int& returnCode);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasCharts_Destroy(UVAtlasCharts* charts);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasBatch(const UVAtlasBatchItem* items, uint32_t numItems, int maxThreads, UVAtlasBatchCallback callback, void* userData, const UVAtlasControl* control);
 extern "C" __declspec(dllexport) void __cdecl UVAtlasData_Destroy(UVAtlasData* data);
+
+// UVAtlasJob_Write packs an input, its parameters and the maxSec, preflight and optimize controls into a job file that
+// UVAtlasJob_Run maps and atlases in place, as done by UVAtlasWorker so that a runaway call can be killed.
+// The job's result file holds uvs only and is read back with UVAtlasResult_Read, given the number of input vertices,
+// which returns 1 if the file is missing or bad, e.g. indices or remap entries out of range.
+// UVAtlasJob_Replay atlases a job, e.g. one captured per UVAtlasControl.captureDir, in this process with the given
+// maxSec (0 for none), returning 0 if the job could be read. recorded is the outcome stored in the job.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Write(const wchar_t* path, const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Run(const wchar_t* jobPath, const wchar_t* resultPath);
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_Read(const wchar_t* path, uint32_t numVertices, int& returnCode);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Replay(const wchar_t* jobPath, double maxSec, uint32_t& numFaces, UVAtlasJobOutcome* recorded, UVAtlasJobOutcome* replayed);
+
+// UVAtlasBaker_Create builds a BVH over the triangles of all sources, which must have the same number of bands.
+// The source meshes are copied but the images are not, so they must stay valid until UVAtlasBaker_Destroy.
+// UVAtlasBaker_Bake fills each texel of image (and index, if not null) whose uv, sampled at the texel corner, lies in
+// a dest triangle with the source texture nearest the corresponding dest point: bicubic for the image and nearest for
+// the index. coverage, if not null, gets width * height bytes set to 1 for baked texels and 0 otherwise; other texels
+// are left as they were. Rows are baked in bands by up to maxThreads threads (0 for one per core). Returns 0 on
+// success and 1 on failure. If index was requested but a source has none with enough bands, or its size differs from
+// image, image is still baked, index is left untouched and 8 (UVAtlasNET.UVAtlas.ReturnCode.NO_INDEX) is returned.
+extern "C" __declspec(dllexport) UVAtlasBaker* __cdecl UVAtlasBaker_Create(const UVAtlasBakeSource* sources, uint32_t numSources, int& returnCode);
+extern "C" __declspec(dllexport) int __cdecl UVAtlasBaker_Bake(const UVAtlasBaker* baker, const UVAtlasBakeMesh* dest, UVAtlasImage* image, UVAtlasImage* index, uint8_t* coverage, int maxThreads);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasBaker_Destroy(UVAtlasBaker* baker);
+
+// UVAtlasDilate pads charts into the gutter: each texel not set in coverage (width * height bytes) whose nearest
+// covered texel, by exact Euclidean distance, is within radius texels (negative for any distance) gets all bands of
+// that texel in each of the numImages images, which must all have the same size, and is then set in coverage.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasDilate(UVAtlasImage* images, uint32_t numImages, uint8_t* coverage, int radius, int maxThreads);
+
+// UVAtlasSamples_Create rasterizes the uvs of mesh at the centers of width * height texels, at most INT32_MAX, in one
+// pass by up to maxThreads threads (0 for one per core). Each covered texel gives a sample of its row major index, the
+// first face covering it, the barycentric weights of that face and the interpolated position. Samples are in row major
+// order.
+// If fraction is in (0, 1) only every (n / max(1, n * fraction))th of the n samples is kept, an evenly spread and
+// deterministic subsample. UVAtlasSamples_Copy fills any of its non-null arrays, which must hold
+// UVAtlasSamples_GetCount elements (three each for barycentrics and points).
+extern "C" __declspec(dllexport) UVAtlasSamples* __cdecl UVAtlasSamples_Create(const UVAtlasBakeMesh* mesh, uint32_t width, uint32_t height, double fraction, int maxThreads, int& returnCode);
+extern "C" __declspec(dllexport) uint32_t __cdecl UVAtlasSamples_GetCount(const UVAtlasSamples* samples);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasSamples_Copy(const UVAtlasSamples* samples, uint32_t* pixels, uint32_t* faces, double* barycentrics, double* points);
+extern "C" __declspec(dllexport) void __cdecl UVAtlasSamples_Destroy(UVAtlasSamples* samples);
+
+// UVAtlasUVStats_Compute gathers the uv bounds of all vertices and the 3D, uv and texel areas, face area range, stretch
+// and, if histogram is not null, texel density histogram of all faces in one pass over each, using up to maxThreads
+// threads (0 for one per core). Texel space is uv scaled by width and height, flipped in v as by Image.UVToPixel, or uv
+// itself if either is 0. If rescale is not null the uvs are first remapped into uvs, which may be mesh->uvs to rescale
+// in place, and the stats are of the remapped uvs; stats->rescaled is 0 if they were left as they were. faceStretch,
+// if not null, gets the largest and smallest stretch of each face, 0 for faces with no 3D area.
+// Returns 1 if an area is not a number.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasUVStats_Compute(const UVAtlasBakeMesh* mesh, uint32_t width, uint32_t height, const UVAtlasUVRescale* rescale, double* uvs, const UVAtlasUVHistogram* histogram, double* faceStretch, UVAtlasUVStats* stats, int maxThreads);
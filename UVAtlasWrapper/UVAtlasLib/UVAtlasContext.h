@@ -0,0 +1,233 @@
+#pragma once
+
+#include <windows.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <directxmath.h>
+#include <utility>
+
+#include "UVAtlas.h"
+#include "UVAtlasClass.h"
+
+// Output of UVAtlasCreate, retained so callers can size their own buffers before copying out.
+// In low memory mode the output vertices are replaced by just their uvs once packed.
+struct UVAtlasResult {
+	std::vector<DirectX::UVAtlasVertex> vertices;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<uint8_t> indices;
+	std::vector<uint32_t> vertexRemap;
+	std::vector<uint32_t> facePartitioning;
+	float stretch = 0;
+	uint32_t numCharts = 0;
+
+	uint32_t GetVertexCount() const { return (uint32_t)vertexRemap.size(); }
+	const DirectX::XMFLOAT2& GetUV(size_t i) const { return uvs.empty() ? vertices[i].uv : uvs[i]; }
+
+	void DropPositions();
+	uint32_t GetFaceCount() const { return (uint32_t)(indices.size() / (3 * sizeof(uint32_t))); }
+};
+
+// Partitioned but not yet packed mesh, which can be packed any number of times at different resolutions and gutters.
+// Packing only reads it, so it may be packed from several threads at once.
+struct UVAtlasCharts {
+	UVAtlasResult partitioned;
+	std::vector<uint32_t> partitionAdjacency;
+};
+
+// Scratch buffers that keep their capacity between calls, so that a worker thread atlasing many
+// similarly sized meshes stops reallocating after the first few.
+struct UVAtlasContext {
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> pointReps;
+	std::vector<uint32_t> partitionAdjacency;
+	UVAtlasResult result;
+
+	// Preflight output: repaired indices and adjacency, vertices duplicated by Clean, and the input vertex of every
+	// vertex (empty when none were welded or duplicated).
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> preflightAdjacency;
+	std::vector<uint32_t> dupVerts;
+	std::vector<uint32_t> preflightRemap;
+};
+
+struct AtlasParams {
+	int maxCharts;
+	float maxStretch;
+	float gutter;
+	int width;
+	int height;
+	unsigned long uvOptions;
+	float adjacencyEpsilon;
+	const UVAtlasControl* control;
+
+	// Known topology of the input, see UVAtlasInput.
+	const uint32_t* adjacency;
+	bool welded;
+};
+
+// Return codes shared with UVAtlasNET.UVAtlas.ReturnCode.
+enum AtlasReturnCode {
+	ATLAS_CANCELLED = 6,
+	ATLAS_TIMED_OUT = 7,
+	ATLAS_NO_INDEX = 8,
+};
+
+// Cancellation and wall clock limit of one atlas call, started when constructed, which is before reading the input
+// so that preflight and adjacency count against it too.
+class AtlasDeadline {
+public:
+	explicit AtlasDeadline(const UVAtlasControl* control)
+		: mCancel(control ? control->cancel : nullptr), mMaxSec(control ? control->maxSec : 0),
+		  mStart(std::chrono::steady_clock::now()) {}
+
+	bool IsActive() const { return mCancel || mMaxSec > 0; }
+
+	// Returns 0 to keep going, otherwise the return code to stop with.
+	int Check() const
+	{
+		if (mCancel && *mCancel) {
+			return ATLAS_CANCELLED;
+		}
+		if (mMaxSec > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count() > mMaxSec) {
+			return ATLAS_TIMED_OUT;
+		}
+		return 0;
+	}
+
+private:
+	volatile int32_t* mCancel;
+	double mMaxSec;
+	std::chrono::steady_clock::time_point mStart;
+};
+
+// Frees a buffer outright, which clear() would not.
+template <typename T>
+void ReleaseBuffer(std::vector<T>& buffer)
+{
+	std::vector<T>().swap(buffer);
+}
+
+// Calls work(t) for each t in [0, numThreads) on its own thread, the calling thread being worker 0, and joins them.
+// Workers must take their items from shared state and catch their own exceptions, which can't leave a thread. If a
+// thread can't be started the workers that were share its items.
+template <typename F>
+void RunWorkers(size_t numThreads, F work)
+{
+	std::vector<std::thread> threads;
+	try {
+		threads.reserve(numThreads > 1 ? numThreads - 1 : 0);
+		for (size_t t = 1; t < numThreads; t++) {
+			threads.emplace_back(work, t);
+		}
+	}
+	catch (...) {
+		wprintf(L"\nWARNING: Started %zu of %zu worker threads\n", threads.size() + 1, numThreads);
+	}
+	work((size_t)0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+// Times one phase of a call into UVAtlasControl::phaseStats, if requested, when stopped or destroyed.
+// Time accumulates when a phase runs more than once, e.g. over the attempts of a ladder.
+class AtlasPhaseTimer {
+public:
+	AtlasPhaseTimer(const UVAtlasControl* control, UVAtlasPhase phase)
+		: mStats(control && control->phaseStats ? control->phaseStats + phase : nullptr),
+		  mStart(std::chrono::steady_clock::now()) {}
+
+	~AtlasPhaseTimer() { Stop(); }
+
+	void Stop();
+
+	// Raises the phase's peakPrivateBytes to the current private usage, if requested.
+	static void SampleMemory(const UVAtlasControl* control, UVAtlasPhase phase);
+
+	// Clears all phases at the start of a call so that ones that never ran read as zero.
+	static void Reset(const UVAtlasControl* control);
+
+private:
+	UVAtlasPhaseStats* mStats;
+	std::chrono::steady_clock::time_point mStart;
+};
+
+// Generates adjacency and point reps into ctx, from the known topology in params if any. Returns a UVAtlasNET return code.
+int AtlasAdjacency(UVAtlasContext& ctx, const DirectX::XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params);
+
+// Partitions directly on the given buffers, which are not copied, using the adjacency already in ctx.
+// Returns a UVAtlasNET return code, on success the charts are left in partitioned and partitionAdjacency.
+int PartitionBuffers(UVAtlasContext& ctx, const DirectX::XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params,
+	const AtlasDeadline& deadline, UVAtlasResult& partitioned, std::vector<uint32_t>& partitionAdjacency);
+
+// Packs partitioned charts in place at the resolution and gutter in params. Returns a UVAtlasNET return code.
+int PackResult(UVAtlasResult& result, const std::vector<uint32_t>& partitionAdjacency, const AtlasParams& params, const AtlasDeadline& deadline);
+
+// Generates adjacency, partitions and packs directly on the given buffers, which are not copied, stopping at the
+// deadline of the whole call. Returns a UVAtlasNET return code, on success the output is left in ctx.result.
+int AtlasBuffers(UVAtlasContext& ctx, const DirectX::XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params,
+	const AtlasDeadline& deadline);
+
+// Content addressed key of an atlas call, the hex SHA-256 of its positions, indices and parameters.
+bool AtlasCacheKey(const DirectX::XMFLOAT3* positions, size_t nVerts, const uint32_t* indices, size_t nFaces, const AtlasParams& params, std::wstring& key);
+
+// Loads a cached result, rebuilding its vertices from the input positions. Returns false on a miss or bad entry.
+bool AtlasCacheRead(const wchar_t* dir, const std::wstring& key, const DirectX::XMFLOAT3* positions, size_t nVerts, UVAtlasResult& result);
+
+// Stores a result, best effort, failures just mean a later miss.
+void AtlasCacheWrite(const wchar_t* dir, const std::wstring& key, const UVAtlasResult& result);
+
+// Result files, as used by the cache and by out of process atlasing. Reading without positions keeps only the uvs
+// of the output vertices. Reading fails, leaving result empty, unless every index is in range of the output vertices
+// and every remap entry is in range of the nVerts input vertices. Writing goes through a temporary file so that a
+// partial result is never seen.
+bool AtlasResultRead(const std::wstring& path, const DirectX::XMFLOAT3* positions, size_t nVerts, UVAtlasResult& result);
+bool AtlasResultWrite(const std::wstring& path, const UVAtlasResult& result);
+
+// Writes a job file of an input and its parameters, with the outcome of atlasing it if not null.
+bool AtlasJobWrite(const wchar_t* path, const UVAtlasInput* input, const AtlasParams& params, const UVAtlasJobOutcome* outcome);
+
+// Writes a job file of the call into params.control->captureDir if any of its capture conditions hold.
+void AtlasCapture(const UVAtlasInput* input, const AtlasParams& params, int returnCode, double wallSec, const UVAtlasResult& result);
+
+// Lays every face out as its own chart, with its longest edge along u, and packs them. This never depends on
+// the topology, so it is the last resort of a ladder, but it does fail on zero area faces.
+int NaiveBuffers(UVAtlasResult& result, std::vector<uint32_t>& partitionAdjacency, const DirectX::XMFLOAT3* positions, const uint32_t* indices, size_t nFaces,
+	const AtlasParams& params, const AtlasDeadline& deadline);
+
+// Runs the preflight requested in params.control, if any, replacing the mesh with the repaired one held in ctx
+// and its adjacency. Returns a UVAtlasNET return code.
+int Preflight(UVAtlasContext& ctx, const DirectX::XMFLOAT3*& positions, size_t& nVerts, const uint32_t*& indices, size_t& nFaces, AtlasParams& params);
+
+// Maps a result of the repaired mesh back to the vertices of the input.
+void PreflightRemap(const UVAtlasContext& ctx, UVAtlasResult& result);
+
+// Validates an interleaved input and packs its positions into ctx if they can't be used in place.
+// Returns a UVAtlasNET return code, on success positions points at float3 positions valid while ctx and input are,
+// and inputParams are params with the topology of the input.
+int ReadInput(UVAtlasContext& ctx, const UVAtlasInput* input, const AtlasParams& params, const DirectX::XMFLOAT3*& positions, AtlasParams& inputParams);
+
+// Atlases an interleaved input with each strategy in turn, generating adjacency only once, until one succeeds.
+// Cancellation and timeouts stop the ladder. On success strategyIndex is the strategy used, otherwise -1.
+int AtlasLadder(UVAtlasContext& ctx, const UVAtlasInput* input, const UVAtlasStrategy* strategies, uint32_t numStrategies, const AtlasParams& params, int& strategyIndex);
+
+// Validates an interleaved input, packs its positions into ctx if they can't be used in place, and atlases it,
+// going through the cache in UVAtlasControl::cacheDir if one is given.
+int AtlasInput(UVAtlasContext& ctx, const UVAtlasInput* input, const AtlasParams& params);
+
+// Checks that a bake or sample mesh has all its arrays and that its indices are in range, printing what is wrong.
+bool ValidUVMesh(const UVAtlasBakeMesh& mesh, const wchar_t* what);
+
+// Texel space rasterization of the uvs of a mesh, as used for baking and sampling. Texel (c, r) samples
+// uv ((c + offset) / width, 1 - (r + offset) / height).
+// BinUVRows lists each face in every band of bandRows rows that its uv bounds overlap, skipping faces off the texture.
+// RasterizeUVRows gives each texel of rows [row0, row1) the first of faces covering it (UINT32_MAX for none) and the
+// barycentric weights of its second and third vertices, packed from texel (0, row0).
+void BinUVRows(const UVAtlasBakeMesh& mesh, uint32_t width, uint32_t height, uint32_t bandRows, double offset, std::vector<std::vector<uint32_t>>& bands);
+void RasterizeUVRows(const UVAtlasBakeMesh& mesh, const std::vector<uint32_t>& faces, uint32_t width, uint32_t height, uint32_t row0, uint32_t row1,
+	double offset, uint32_t* texelFaces, double* texelWeights);
@@ -0,0 +1,236 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <new>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <emmintrin.h>
+
+namespace
+{
+	// Row of the nearest covered texel above or below when there is none, far enough that distances never overflow.
+	const int32_t NONE_ABOVE = -(1 << 29);
+	const int32_t NONE_BELOW = 1 << 29;
+
+	// 4 coverage bytes widened to a mask of 4 int32 lanes, all ones where covered.
+	__m128i CoverageMask(const uint8_t* coverage)
+	{
+		int32_t bytes;
+		memcpy(&bytes, coverage, sizeof(bytes));
+		__m128i zero = _mm_setzero_si128();
+		__m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+		return _mm_xor_si128(_mm_cmpeq_epi32(wide, zero), _mm_set1_epi32(-1));
+	}
+
+	__m128i Select(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	// First pass of the exact Euclidean distance transform (Meijster et al. 2000): for columns [c0, c1) find the row of
+	// the nearest covered texel in the same column. Both sweeps run a whole row of columns at a time, 4 lanes per step.
+	void NearestInColumns(const uint8_t* coverage, uint32_t width, uint32_t height, uint32_t c0, uint32_t c1, int32_t* nearest)
+	{
+		uint32_t simdEnd = c0 + (c1 - c0) / 4 * 4;
+		for (uint32_t r = 0; r < height; r++) {
+			const uint8_t* cov = coverage + (size_t)r * width;
+			int32_t* row = nearest + (size_t)r * width;
+			const int32_t* above = r ? row - width : nullptr;
+			__m128i rr = _mm_set1_epi32((int32_t)r);
+			__m128i none = _mm_set1_epi32(NONE_ABOVE);
+			for (uint32_t c = c0; c < simdEnd; c += 4) {
+				__m128i prev = above ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + c)) : none;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + c), Select(CoverageMask(cov + c), rr, prev));
+			}
+			for (uint32_t c = simdEnd; c < c1; c++) {
+				row[c] = cov[c] ? (int32_t)r : above ? above[c] : NONE_ABOVE;
+			}
+		}
+
+		// Sweeping back up, keep whichever of the nearest covered rows above and below is closer.
+		std::vector<int32_t> below(c1 - c0, NONE_BELOW);
+		for (uint32_t r = height; r-- > 0;) {
+			const uint8_t* cov = coverage + (size_t)r * width;
+			int32_t* row = nearest + (size_t)r * width;
+			__m128i rr = _mm_set1_epi32((int32_t)r);
+			for (uint32_t c = c0; c < simdEnd; c += 4) {
+				__m128i* pBelow = reinterpret_cast<__m128i*>(below.data() + (c - c0));
+				__m128i down = Select(CoverageMask(cov + c), rr, _mm_loadu_si128(pBelow));
+				_mm_storeu_si128(pBelow, down);
+				__m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + c));
+				__m128i upCloser = _mm_cmplt_epi32(_mm_sub_epi32(rr, up), _mm_sub_epi32(down, rr));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + c), Select(upCloser, up, down));
+			}
+			for (uint32_t c = simdEnd; c < c1; c++) {
+				int32_t& down = below[c - c0];
+				down = cov[c] ? (int32_t)r : down;
+				row[c] = (int32_t)r - row[c] < down - (int32_t)r ? row[c] : down;
+			}
+		}
+	}
+
+	struct DilateJob {
+		UVAtlasImage* images;
+		uint32_t numImages;
+		uint8_t* coverage;
+		const int32_t* nearest;
+		double maxDist2;
+		std::atomic<uint32_t> nextRow;
+		std::atomic<bool> failed;
+	};
+
+	double ColumnDist2(const int32_t* nearest, uint32_t r, uint32_t c)
+	{
+		double d = (double)nearest[c] - r;
+		return d * d;
+	}
+
+	bool HasSite(const int32_t* nearest, uint32_t c)
+	{
+		return nearest[c] != NONE_ABOVE && nearest[c] != NONE_BELOW;
+	}
+
+	// Second pass: the lower envelope of the parabolas rooted at each column's nearest covered texel gives the nearest
+	// covered texel of every texel in the row, from which uncovered texels within range are copied. Only this row's
+	// coverage is read, and sites are only read from texels that were covered to begin with, so rows are independent.
+	void DilateRow(DilateJob& job, uint32_t r, std::vector<uint32_t>& v, std::vector<double>& z)
+	{
+		const UVAtlasImage& first = job.images[0];
+		uint32_t width = first.width;
+		const int32_t* nearest = job.nearest + (size_t)r * width;
+		uint8_t* cov = job.coverage + (size_t)r * width;
+
+		int k = -1;
+		for (uint32_t q = 0; q < width; q++) {
+			if (!HasSite(nearest, q)) {
+				continue;
+			}
+			double fq = ColumnDist2(nearest, r, q) + (double)q * q;
+			double s = -HUGE_VAL;
+			while (k >= 0) {
+				uint32_t p = v[k];
+				s = (fq - ColumnDist2(nearest, r, p) - (double)p * p) / (2.0 * ((double)q - p));
+				if (s > z[k]) {
+					break;
+				}
+				k--;
+			}
+			k++;
+			v[k] = q;
+			z[k] = k ? s : -HUGE_VAL;
+		}
+		if (k < 0) {
+			return;
+		}
+
+		int numParabolas = k + 1;
+		k = 0;
+		for (uint32_t c = 0; c < width; c++) {
+			while (k + 1 < numParabolas && z[k + 1] < c) {
+				k++;
+			}
+			if (cov[c]) {
+				continue;
+			}
+			uint32_t sc = v[k];
+			double dc = (double)c - sc;
+			if (dc * dc + ColumnDist2(nearest, r, sc) > job.maxDist2) {
+				continue;
+			}
+			size_t src = (size_t)nearest[sc] * width + sc;
+			size_t dst = (size_t)r * width + c;
+			for (uint32_t i = 0; i < job.numImages; i++) {
+				const UVAtlasImage& image = job.images[i];
+				for (uint32_t b = 0; b < image.numBands; b++) {
+					image.bands[b][dst] = image.bands[b][src];
+				}
+			}
+			cov[c] = 1;
+		}
+	}
+
+	void RunDilateWorker(DilateJob& job)
+	{
+		uint32_t width = job.images[0].width, height = job.images[0].height;
+		try {
+			std::vector<uint32_t> v(width);
+			std::vector<double> z(width);
+			uint32_t r;
+			while (!job.failed && (r = job.nextRow++) < height) {
+				DilateRow(job, r, v, z);
+			}
+		}
+		catch (...) {
+			job.failed = true;
+		}
+	}
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasDilate(UVAtlasImage* images, uint32_t numImages, uint8_t* coverage, int radius, int maxThreads)
+{
+	if (!images || !numImages || !coverage || !radius) {
+		return 0;
+	}
+	uint32_t width = images[0].width, height = images[0].height;
+	for (uint32_t i = 0; i < numImages; i++) {
+		if (!images[i].bands || images[i].width != width || images[i].height != height) {
+			wprintf(L"\nERROR: Dilate images must all be %ux%u\n", width, height);
+			return 1;
+		}
+	}
+	if (!width || !height) {
+		return 0;
+	}
+
+	std::vector<int32_t> nearest;
+	try {
+		nearest.resize((size_t)width * height);
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Out of memory dilating %ux%u texels\n", width, height);
+		return 1;
+	}
+
+	size_t numThreads = maxThreads > 0 ? (size_t)maxThreads : (size_t)(std::max)(1u, std::thread::hardware_concurrency());
+
+	// Columns are independent in the first pass, so each thread sweeps its own strips of a whole number of lanes.
+	uint32_t stripWidth = (std::max)(64u, (width / (uint32_t)(4 * numThreads) + 3) / 4 * 4);
+	uint32_t numStrips = (width + stripWidth - 1) / stripWidth;
+	std::atomic<uint32_t> nextStrip(0);
+	std::atomic<bool> failed(false);
+	RunWorkers((std::min)(numThreads, (size_t)numStrips), [&](size_t) {
+		try {
+			uint32_t s;
+			while (!failed && (s = nextStrip++) < numStrips) {
+				NearestInColumns(coverage, width, height, s * stripWidth, (std::min)((s + 1) * stripWidth, width), nearest.data());
+			}
+		}
+		catch (...) {
+			failed = true;
+		}
+	});
+	if (failed) {
+		wprintf(L"\nERROR: Failed dilating %ux%u texels\n", width, height);
+		return 1;
+	}
+
+	DilateJob job;
+	job.images = images;
+	job.numImages = numImages;
+	job.coverage = coverage;
+	job.nearest = nearest.data();
+	job.maxDist2 = radius < 0 ? HUGE_VAL : (double)radius * radius;
+	job.nextRow = 0;
+	job.failed = false;
+	RunWorkers((std::min)(numThreads, (size_t)height), [&job](size_t) { RunDilateWorker(job); });
+	if (job.failed) {
+		wprintf(L"\nERROR: Failed dilating %ux%u texels\n", width, height);
+		return 1;
+	}
+	return 0;
+}
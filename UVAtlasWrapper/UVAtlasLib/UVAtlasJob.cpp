@@ -0,0 +1,321 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t JOB_MAGIC = 0x4A415655; // "UVAJ"
+	const uint32_t JOB_VERSION = 2;
+
+	// Every section starts on this boundary so that a mapped job can be atlased in place.
+	const uint64_t JOB_ALIGNMENT = 16;
+
+	// A job file is this header followed by tightly packed positions, indices and optional adjacency at the given
+	// offsets, so the worker maps it and points UVAtlasInput straight into the mapping. Captured jobs also record
+	// how the original call went.
+	struct JobHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numVertices;
+		uint32_t numFaces;
+		uint32_t positionFormat;
+		int32_t maxCharts;
+		float maxStretch;
+		float gutter;
+		int32_t width;
+		int32_t height;
+		uint32_t uvOptions;
+		float adjacencyEpsilon;
+		uint32_t welded;
+		uint32_t preflight;
+		int32_t optimize;
+		int32_t lowMemory;
+		double maxSec;
+		UVAtlasJobOutcome recorded;
+		uint64_t positionsOffset;
+		uint64_t indicesOffset;
+		uint64_t adjacencyOffset; // 0 for none
+		uint64_t fileSize;
+	};
+
+	uint64_t Align(uint64_t offset)
+	{
+		return (offset + JOB_ALIGNMENT - 1) & ~(JOB_ALIGNMENT - 1);
+	}
+
+	bool Pad(FILE* file, uint64_t offset)
+	{
+		static const uint8_t zeros[JOB_ALIGNMENT] = {};
+		size_t n = size_t(Align(offset) - offset);
+		return fwrite(zeros, 1, n, file) == n;
+	}
+
+	// Read only view of a whole file, unmapped when destroyed.
+	class MappedFile {
+	public:
+		explicit MappedFile(const wchar_t* path)
+		{
+			mFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			LARGE_INTEGER size;
+			if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &size) || !size.QuadPart) {
+				return;
+			}
+			mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mMapping) {
+				mData = reinterpret_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+				mSize = mData ? uint64_t(size.QuadPart) : 0;
+			}
+		}
+
+		~MappedFile()
+		{
+			if (mData) {
+				UnmapViewOfFile(mData);
+			}
+			if (mMapping) {
+				CloseHandle(mMapping);
+			}
+			if (mFile != INVALID_HANDLE_VALUE) {
+				CloseHandle(mFile);
+			}
+		}
+
+		const uint8_t* Data() const { return mData; }
+		uint64_t Size() const { return mSize; }
+
+	private:
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		const uint8_t* mData = nullptr;
+		uint64_t mSize = 0;
+	};
+}
+
+bool AtlasJobWrite(const wchar_t* path, const UVAtlasInput* input, const AtlasParams& params, const UVAtlasJobOutcome* outcome)
+{
+	if (!input->numVertices || !input->positions || !input->numFaces || !input->indices ||
+		(input->positionFormat != UVATLAS_POSITION_FLOAT3 && input->positionFormat != UVATLAS_POSITION_DOUBLE3)) {
+		return false;
+	}
+	size_t elementSize = input->positionFormat == UVATLAS_POSITION_DOUBLE3 ? 3 * sizeof(double) : sizeof(XMFLOAT3);
+	size_t stride = input->positionStride ? input->positionStride : elementSize;
+	size_t indicesSize = size_t(input->numFaces) * 3 * sizeof(uint32_t);
+
+	JobHeader header = {};
+	header.magic = JOB_MAGIC;
+	header.version = JOB_VERSION;
+	header.numVertices = input->numVertices;
+	header.numFaces = input->numFaces;
+	header.positionFormat = input->positionFormat;
+	header.maxCharts = params.maxCharts;
+	header.maxStretch = params.maxStretch;
+	header.gutter = params.gutter;
+	header.width = params.width;
+	header.height = params.height;
+	header.uvOptions = params.uvOptions;
+	header.adjacencyEpsilon = params.adjacencyEpsilon;
+	header.welded = input->welded;
+	if (params.control) {
+		header.preflight = params.control->preflight;
+		header.optimize = params.control->optimize;
+		header.lowMemory = params.control->lowMemory;
+		header.maxSec = params.control->maxSec;
+	}
+	header.recorded = outcome ? *outcome : UVAtlasJobOutcome();
+	header.positionsOffset = Align(sizeof(JobHeader));
+	header.indicesOffset = Align(header.positionsOffset + uint64_t(input->numVertices) * elementSize);
+	header.adjacencyOffset = input->adjacency ? Align(header.indicesOffset + indicesSize) : 0;
+	header.fileSize = (input->adjacency ? header.adjacencyOffset : header.indicesOffset) + indicesSize;
+
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, path, L"wb") || !file) {
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && Pad(file, sizeof(header));
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(input->positions);
+	if (stride == elementSize) {
+		ok = ok && fwrite(src, elementSize, input->numVertices, file) == input->numVertices;
+	}
+	else {
+		for (size_t i = 0; ok && i < input->numVertices; i++, src += stride) {
+			ok = fwrite(src, elementSize, 1, file) == 1;
+		}
+	}
+	ok = ok && Pad(file, header.positionsOffset + uint64_t(input->numVertices) * elementSize) &&
+		fwrite(input->indices, 1, indicesSize, file) == indicesSize;
+	if (input->adjacency) {
+		ok = ok && Pad(file, header.indicesOffset + indicesSize) &&
+			fwrite(input->adjacency, 1, indicesSize, file) == indicesSize;
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok) {
+		DeleteFileW(path);
+	}
+	return ok;
+}
+
+void AtlasCapture(const UVAtlasInput* input, const AtlasParams& params, int returnCode, double wallSec, const UVAtlasResult& result)
+{
+	const UVAtlasControl* control = params.control;
+	if (!control || !control->captureDir || !control->capture) {
+		return;
+	}
+	static std::atomic<uint64_t> numCalls(0);
+	uint64_t call = numCalls++;
+	bool capture = (control->capture & UVATLAS_CAPTURE_FAILED) && returnCode != 0;
+	capture = capture || ((control->capture & UVATLAS_CAPTURE_SLOW) && wallSec > control->captureSlowSec);
+	if (!capture && (control->capture & UVATLAS_CAPTURE_SAMPLED)) {
+		// splitmix64 of the call count, so sampling needs no shared generator state.
+		uint64_t z = (call + 1) * 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		z ^= z >> 31;
+		capture = double(z >> 11) / double(1ull << 53) < control->captureSampleRate;
+	}
+	if (!capture) {
+		return;
+	}
+
+	UVAtlasJobOutcome outcome;
+	outcome.returnCode = returnCode;
+	outcome.wallSec = wallSec;
+	if (returnCode == 0) {
+		outcome.numVertices = result.GetVertexCount();
+		outcome.numCharts = result.numCharts;
+		outcome.stretch = result.stretch;
+	}
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	SYSTEMTIME utc;
+	FileTimeToSystemTime(&now, &utc);
+	wchar_t name[96];
+	swprintf_s(name, L"%04u%02u%02u-%02u%02u%02u-%u-%llu.uvajob", utc.wYear, utc.wMonth, utc.wDay, utc.wHour, utc.wMinute,
+		utc.wSecond, GetCurrentProcessId(), (unsigned long long)call);
+	std::wstring path(control->captureDir);
+	if (!path.empty() && path.back() != L'\\' && path.back() != L'/') {
+		path += L'\\';
+	}
+	CreateDirectoryW(control->captureDir, nullptr);
+	if (!AtlasJobWrite((path + name).c_str(), input, params, &outcome)) {
+		wprintf(L"\nWARNING: Failed capturing atlas job %s\n", (path + name).c_str());
+	}
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Write(const wchar_t* path, const UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, unsigned long uvOptions, float adjacencyEpsilon, const UVAtlasControl* control)
+{
+	AtlasParams params = { maxCharts, maxStretch, gutter, width, height, uvOptions, adjacencyEpsilon, control };
+	if (!AtlasJobWrite(path, input, params, nullptr)) {
+		wprintf(L"\nERROR: Failed writing atlas job %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+namespace
+{
+	// Validates a mapped job and points input into it, returning its header or null.
+	const JobHeader* OpenJob(const MappedFile& job, UVAtlasInput& input)
+	{
+		const JobHeader* header = reinterpret_cast<const JobHeader*>(job.Data());
+		if (job.Size() < sizeof(JobHeader) || header->magic != JOB_MAGIC || header->version != JOB_VERSION ||
+			header->fileSize > job.Size()) {
+			return nullptr;
+		}
+		size_t elementSize = header->positionFormat == UVATLAS_POSITION_DOUBLE3 ? 3 * sizeof(double) : sizeof(XMFLOAT3);
+		uint64_t indicesSize = uint64_t(header->numFaces) * 3 * sizeof(uint32_t);
+		if (header->positionsOffset + uint64_t(header->numVertices) * elementSize > header->indicesOffset ||
+			header->indicesOffset + indicesSize > header->fileSize ||
+			(header->adjacencyOffset && header->adjacencyOffset + indicesSize > header->fileSize)) {
+			return nullptr;
+		}
+		input.positions = job.Data() + header->positionsOffset;
+		input.positionStride = 0;
+		input.positionFormat = header->positionFormat;
+		input.numVertices = header->numVertices;
+		input.indices = reinterpret_cast<const uint32_t*>(job.Data() + header->indicesOffset);
+		input.numFaces = header->numFaces;
+		input.adjacency = header->adjacencyOffset ? reinterpret_cast<const uint32_t*>(job.Data() + header->adjacencyOffset) : nullptr;
+		input.welded = header->welded;
+		return header;
+	}
+
+	UVAtlasResult* RunJob(const JobHeader& header, const UVAtlasInput& input, const UVAtlasControl& control, int& returnCode)
+	{
+		return UVAtlasResult_Create(&input, header.maxCharts, header.maxStretch, header.gutter, header.width, header.height,
+			header.uvOptions, header.adjacencyEpsilon, &control, returnCode);
+	}
+}
+
+// Maps the job and atlases it in place, writing the result file on success. Returns a UVAtlasNET return code, which
+// is also the worker's exit code.
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Run(const wchar_t* jobPath, const wchar_t* resultPath)
+{
+	MappedFile job(jobPath);
+	UVAtlasInput input;
+	const JobHeader* header = OpenJob(job, input);
+	if (!header) {
+		wprintf(L"\nERROR: Failed reading atlas job %s\n", jobPath);
+		return 1;
+	}
+
+	// Only uvs go back in the result file, so the worker always runs lean.
+	UVAtlasControl control = UVAtlasControl();
+	control.maxSec = header->maxSec;
+	control.preflight = header->preflight;
+	control.optimize = header->optimize;
+	control.lowMemory = 1;
+
+	int returnCode = 1;
+	std::unique_ptr<UVAtlasResult> result(RunJob(*header, input, control, returnCode));
+	if (returnCode == 0 && !AtlasResultWrite(resultPath, *result)) {
+		wprintf(L"\nERROR: Failed writing atlas result %s\n", resultPath);
+		returnCode = 1;
+	}
+	return returnCode;
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasJob_Replay(const wchar_t* jobPath, double maxSec, uint32_t& numFaces, UVAtlasJobOutcome* recorded, UVAtlasJobOutcome* replayed)
+{
+	MappedFile job(jobPath);
+	UVAtlasInput input;
+	const JobHeader* header = OpenJob(job, input);
+	if (!header) {
+		wprintf(L"\nERROR: Failed reading atlas job %s\n", jobPath);
+		return 1;
+	}
+	numFaces = header->numFaces;
+	*recorded = header->recorded;
+
+	UVAtlasControl control = UVAtlasControl();
+	control.maxSec = maxSec;
+	control.preflight = header->preflight;
+	control.optimize = header->optimize;
+	control.lowMemory = header->lowMemory;
+
+	*replayed = UVAtlasJobOutcome();
+	auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<UVAtlasResult> result(RunJob(*header, input, control, replayed->returnCode));
+	replayed->wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (result) {
+		replayed->numVertices = result->GetVertexCount();
+		replayed->numCharts = result->numCharts;
+		replayed->stretch = result->stretch;
+	}
+	return 0;
+}
+
+extern "C" __declspec(dllexport) UVAtlasResult* __cdecl UVAtlasResult_Read(const wchar_t* path, uint32_t numVertices, int& returnCode)
+{
+	std::unique_ptr<UVAtlasResult> result(new (std::nothrow) UVAtlasResult);
+	returnCode = result && AtlasResultRead(path, nullptr, numVertices, *result) ? 0 : 1;
+	return returnCode == 0 ? result.release() : nullptr;
+}
@@ -0,0 +1,274 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct UVAtlasSamples {
+	std::vector<uint32_t> pixels;
+	std::vector<uint32_t> faces;
+	std::vector<double> barycentrics;
+	std::vector<double> points;
+
+	size_t Count() const { return pixels.size(); }
+};
+
+namespace
+{
+	const uint32_t SAMPLE_BAND_ROWS = 16;
+
+	// Face bounds are widened by this many texels so that a texel on an edge, which rounding put just outside the
+	// bounds, still gets the inclusive edge test.
+	const double BOUNDS_TOLERANCE = 1e-6;
+
+	struct SampleJob {
+		const UVAtlasBakeMesh* mesh;
+		uint32_t width;
+		uint32_t height;
+		std::vector<std::vector<uint32_t>> bandFaces;
+		std::vector<UVAtlasSamples> bandSamples;
+		std::atomic<uint32_t> nextBand;
+		std::atomic<bool> failed;
+	};
+
+	void SampleBand(SampleJob& job, uint32_t band, std::vector<uint32_t>& faces, std::vector<double>& weights)
+	{
+		const UVAtlasBakeMesh& mesh = *job.mesh;
+		uint32_t row0 = band * SAMPLE_BAND_ROWS;
+		uint32_t row1 = (std::min)(row0 + SAMPLE_BAND_ROWS, job.height);
+		size_t numTexels = (size_t)(row1 - row0) * job.width;
+
+		// Texel centers, where the texture is sampled.
+		RasterizeUVRows(mesh, job.bandFaces[band], job.width, job.height, row0, row1, 0.5, faces.data(), weights.data());
+
+		UVAtlasSamples& out = job.bandSamples[band];
+		for (size_t t = 0; t < numTexels; t++) {
+			if (faces[t] == UINT32_MAX) {
+				continue;
+			}
+			const uint32_t* face = mesh.indices + 3 * size_t(faces[t]);
+			double w[3] = { 1 - weights[2 * t] - weights[2 * t + 1], weights[2 * t], weights[2 * t + 1] };
+			double p[3] = { 0, 0, 0 };
+			for (int v = 0; v < 3; v++) {
+				for (int k = 0; k < 3; k++) {
+					p[k] += w[v] * mesh.positions[3 * size_t(face[v]) + k];
+				}
+			}
+			out.pixels.push_back((uint32_t)((size_t)row0 * job.width + t));
+			out.faces.push_back(faces[t]);
+			out.barycentrics.insert(out.barycentrics.end(), w, w + 3);
+			out.points.insert(out.points.end(), p, p + 3);
+		}
+	}
+
+	void RunSampleWorker(SampleJob& job)
+	{
+		try {
+			size_t bandTexels = (size_t)SAMPLE_BAND_ROWS * job.width;
+			std::vector<uint32_t> faces(bandTexels);
+			std::vector<double> weights(2 * bandTexels);
+			uint32_t band;
+			while (!job.failed && (band = job.nextBand++) < job.bandFaces.size()) {
+				SampleBand(job, band, faces, weights);
+			}
+		}
+		catch (...) {
+			job.failed = true;
+		}
+	}
+}
+
+bool ValidUVMesh(const UVAtlasBakeMesh& mesh, const wchar_t* what)
+{
+	if (!mesh.positions || !mesh.uvs || !mesh.indices) {
+		wprintf(L"\nERROR: %ls mesh is missing positions, uvs or indices\n", what);
+		return false;
+	}
+	for (size_t i = 0; i < size_t(mesh.numFaces) * 3; i++) {
+		if (mesh.indices[i] >= mesh.numVertices) {
+			wprintf(L"\nERROR: %ls mesh index %u out of range\n", what, mesh.indices[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+void BinUVRows(const UVAtlasBakeMesh& mesh, uint32_t width, uint32_t height, uint32_t bandRows, double offset, std::vector<std::vector<uint32_t>>& bands)
+{
+	bands.assign((height + bandRows - 1) / bandRows, std::vector<uint32_t>());
+	for (uint32_t f = 0; f < mesh.numFaces; f++) {
+		double minX = HUGE_VAL, maxX = -HUGE_VAL, minY = HUGE_VAL, maxY = -HUGE_VAL;
+		for (int v = 0; v < 3; v++) {
+			const double* uv = mesh.uvs + 2 * size_t(mesh.indices[3 * size_t(f) + v]);
+			double x = uv[0] * width - offset, y = (1 - uv[1]) * height - offset;
+			minX = (std::min)(minX, x - BOUNDS_TOLERANCE);
+			maxX = (std::max)(maxX, x + BOUNDS_TOLERANCE);
+			minY = (std::min)(minY, y - BOUNDS_TOLERANCE);
+			maxY = (std::max)(maxY, y + BOUNDS_TOLERANCE);
+		}
+		// Faces off the texture, or with a NaN uv, are never rasterized.
+		if (!(maxX >= 0 && minX <= width - 1.0 && maxY >= 0 && minY <= height - 1.0)) {
+			continue;
+		}
+		uint32_t b0 = (uint32_t)(std::max)(std::ceil(minY), 0.0) / bandRows;
+		uint32_t b1 = (uint32_t)(std::min)(std::floor(maxY), height - 1.0) / bandRows;
+		for (uint32_t b = b0; b <= b1; b++) {
+			bands[b].push_back(f);
+		}
+	}
+}
+
+void RasterizeUVRows(const UVAtlasBakeMesh& mesh, const std::vector<uint32_t>& faces, uint32_t width, uint32_t height, uint32_t row0, uint32_t row1,
+	double offset, uint32_t* texelFaces, double* texelWeights)
+{
+	std::fill(texelFaces, texelFaces + (size_t)(row1 - row0) * width, UINT32_MAX);
+
+	// Edges are inclusive, like Triangle.UVToBarycentric, so texels on a shared edge go to the first face.
+	const double eps = 1e-9;
+	for (uint32_t f : faces) {
+		double x[3], y[3];
+		for (int v = 0; v < 3; v++) {
+			const double* uv = mesh.uvs + 2 * size_t(mesh.indices[3 * size_t(f) + v]);
+			x[v] = uv[0] * width - offset;
+			y[v] = (1 - uv[1]) * height - offset;
+		}
+		double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0 || !std::isfinite(area)) {
+			continue;
+		}
+		double minX = (std::min)((std::min)(x[0], x[1]), x[2]) - BOUNDS_TOLERANCE;
+		double maxX = (std::max)((std::max)(x[0], x[1]), x[2]) + BOUNDS_TOLERANCE;
+		double minY = (std::min)((std::min)(y[0], y[1]), y[2]) - BOUNDS_TOLERANCE;
+		double maxY = (std::max)((std::max)(y[0], y[1]), y[2]) + BOUNDS_TOLERANCE;
+		// Clamped in double before the casts, which are undefined outside the range of int.
+		if (!(maxX >= 0 && minX <= width - 1.0 && maxY >= row0 && minY <= row1 - 1.0)) {
+			continue;
+		}
+		int c0 = (int)(std::max)(std::ceil(minX), 0.0), c1 = (int)(std::min)(std::floor(maxX), width - 1.0);
+		int r0 = (int)(std::max)(std::ceil(minY), (double)row0), r1 = (int)(std::min)(std::floor(maxY), row1 - 1.0);
+		for (int r = r0; r <= r1; r++) {
+			for (int c = c0; c <= c1; c++) {
+				size_t t = (size_t)(r - row0) * width + c;
+				if (texelFaces[t] != UINT32_MAX) {
+					continue;
+				}
+				double w1 = ((c - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (r - y[0])) / area;
+				double w2 = ((x[1] - x[0]) * (r - y[0]) - (c - x[0]) * (y[1] - y[0])) / area;
+				double w0 = 1 - w1 - w2;
+				if (w0 >= -eps && w1 >= -eps && w2 >= -eps) {
+					texelFaces[t] = f;
+					texelWeights[2 * t] = w1;
+					texelWeights[2 * t + 1] = w2;
+				}
+			}
+		}
+	}
+}
+
+extern "C" __declspec(dllexport) UVAtlasSamples* __cdecl UVAtlasSamples_Create(const UVAtlasBakeMesh* mesh, uint32_t width, uint32_t height, double fraction, int maxThreads, int& returnCode)
+{
+	returnCode = 1;
+	if (!mesh || !ValidUVMesh(*mesh, L"Sample")) {
+		return nullptr;
+	}
+	// Pixel indices are returned as ints on the managed side.
+	if (!width || !height || (uint64_t)width * height > INT32_MAX) {
+		wprintf(L"\nERROR: Cannot sample %ux%u texels\n", width, height);
+		return nullptr;
+	}
+
+	SampleJob job;
+	job.mesh = mesh;
+	job.width = width;
+	job.height = height;
+	job.nextBand = 0;
+	job.failed = false;
+	std::unique_ptr<UVAtlasSamples> samples;
+	try {
+		BinUVRows(*mesh, width, height, SAMPLE_BAND_ROWS, 0.5, job.bandFaces);
+		job.bandSamples.resize(job.bandFaces.size());
+		samples.reset(new UVAtlasSamples());
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Out of memory binning %u sample faces\n", mesh->numFaces);
+		return nullptr;
+	}
+
+	size_t numThreads = maxThreads > 0 ? (size_t)maxThreads : (size_t)(std::max)(1u, std::thread::hardware_concurrency());
+	RunWorkers((std::min)(numThreads, job.bandFaces.size()), [&job](size_t) { RunSampleWorker(job); });
+	if (job.failed) {
+		wprintf(L"\nERROR: Failed sampling %ux%u texels\n", width, height);
+		return nullptr;
+	}
+
+	// Bands are joined in order, so samples are in row major order whatever the threads did. A subsample keeps one
+	// sample out of every run of skip, the same ones MeshOperator.SubsampleUVSpace keeps.
+	size_t total = 0;
+	for (const auto& band : job.bandSamples) {
+		total += band.Count();
+	}
+	size_t skip = 1;
+	if (fraction > 0 && fraction < 1 && total) {
+		skip = total / (std::max)((size_t)1, (size_t)(total * fraction));
+	}
+	try {
+		size_t kept = (total + skip - 1) / skip;
+		samples->pixels.reserve(kept);
+		samples->faces.reserve(kept);
+		samples->barycentrics.reserve(3 * kept);
+		samples->points.reserve(3 * kept);
+		size_t index = 0;
+		for (auto& band : job.bandSamples) {
+			for (size_t i = 0; i < band.Count(); i++, index++) {
+				if (index % skip) {
+					continue;
+				}
+				samples->pixels.push_back(band.pixels[i]);
+				samples->faces.push_back(band.faces[i]);
+				samples->barycentrics.insert(samples->barycentrics.end(), &band.barycentrics[3 * i], &band.barycentrics[3 * i] + 3);
+				samples->points.insert(samples->points.end(), &band.points[3 * i], &band.points[3 * i] + 3);
+			}
+			band = UVAtlasSamples();
+		}
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Out of memory collecting %zu samples\n", total);
+		return nullptr;
+	}
+	returnCode = 0;
+	return samples.release();
+}
+
+extern "C" __declspec(dllexport) uint32_t __cdecl UVAtlasSamples_GetCount(const UVAtlasSamples* samples)
+{
+	return samples ? (uint32_t)samples->Count() : 0;
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasSamples_Copy(const UVAtlasSamples* samples, uint32_t* pixels, uint32_t* faces, double* barycentrics, double* points)
+{
+	if (!samples) {
+		return;
+	}
+	if (pixels) {
+		std::copy(samples->pixels.begin(), samples->pixels.end(), pixels);
+	}
+	if (faces) {
+		std::copy(samples->faces.begin(), samples->faces.end(), faces);
+	}
+	if (barycentrics) {
+		std::copy(samples->barycentrics.begin(), samples->barycentrics.end(), barycentrics);
+	}
+	if (points) {
+		std::copy(samples->points.begin(), samples->points.end(), points);
+	}
+}
+
+extern "C" __declspec(dllexport) void __cdecl UVAtlasSamples_Destroy(UVAtlasSamples* samples)
+{
+	delete samples;
+}
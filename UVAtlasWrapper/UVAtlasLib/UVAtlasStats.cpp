@@ -0,0 +1,303 @@
+#include "UVAtlasClass.h"
+#include "UVAtlasContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <emmintrin.h>
+
+namespace
+{
+	// Faces per chunk of the face pass. Chunks are reduced in order, so sums don't depend on the number of threads.
+	const uint32_t STATS_CHUNK_FACES = 1 << 14;
+
+	// Numerically stable triangle area, the same as Triangle.Area.
+	double KahanArea(const double* v0, const double* v1, const double* v2, int dims)
+	{
+		auto dist = [dims](const double* p, const double* q) {
+			double d2 = 0;
+			for (int k = 0; k < dims; k++) {
+				d2 += (p[k] - q[k]) * (p[k] - q[k]);
+			}
+			return std::sqrt(d2);
+		};
+		double a = dist(v0, v1), b = dist(v1, v2), c = dist(v2, v0);
+		if (a < b) {
+			std::swap(a, b);
+		}
+		if (b < c) {
+			std::swap(b, c);
+		}
+		if (a < b) {
+			std::swap(a, b);
+		}
+		if (c - (a - b) < 0) {
+			return 0;
+		}
+		return std::sqrt((a + (b + c)) * (c - (a - b)) * (c + (a - b)) * (a + (b - c))) / 4;
+	}
+
+	// Singular values of the map from the plane of a 3D triangle to its texel space triangle.
+	bool FaceStretch(const double* p[3], const double* t[3], double& maxStretch, double& minStretch)
+	{
+		double e1[3], e2[3];
+		for (int k = 0; k < 3; k++) {
+			e1[k] = p[1][k] - p[0][k];
+			e2[k] = p[2][k] - p[0][k];
+		}
+		double l1 = std::sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double twiceArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (!(l1 > 0 && twiceArea > 0)) {
+			return false;
+		}
+
+		// The 3D triangle in a frame of its plane with e1 along x is (0, 0), (l1, 0), (x2, y2).
+		double x2 = (e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2]) / l1, y2 = twiceArea / l1;
+		double du1 = t[1][0] - t[0][0], dv1 = t[1][1] - t[0][1];
+		double du2 = t[2][0] - t[0][0], dv2 = t[2][1] - t[0][1];
+		double a = du1 / l1, c = dv1 / l1;
+		double b = (du2 - a * x2) / y2, d = (dv2 - c * x2) / y2;
+
+		double s = std::sqrt((a + d) * (a + d) + (c - b) * (c - b));
+		double r = std::sqrt((a - d) * (a - d) + (b + c) * (b + c));
+		maxStretch = (s + r) / 2;
+		minStretch = std::fabs(s - r) / 2;
+		return true;
+	}
+
+	struct FaceStats {
+		double area = 0;
+		double uvArea = 0;
+		double pixelArea = 0;
+		double minFaceArea = HUGE_VAL;
+		double maxFaceArea = -HUGE_VAL;
+		double minStretch = HUGE_VAL;
+		double maxStretch = -HUGE_VAL;
+		bool nan = false;
+		std::vector<double> bins;
+	};
+
+	struct StatsJob {
+		const UVAtlasBakeMesh* mesh;
+		const double* uvs;
+		double scale[2];
+		const UVAtlasUVHistogram* histogram;
+		double* faceStretch;
+		std::vector<FaceStats> chunks;
+		std::atomic<uint32_t> nextChunk;
+		std::atomic<bool> failed;
+	};
+
+	void ChunkStats(StatsJob& job, uint32_t chunk)
+	{
+		const UVAtlasBakeMesh& mesh = *job.mesh;
+		const UVAtlasUVHistogram* histogram = job.histogram;
+		FaceStats& out = job.chunks[chunk];
+		if (histogram) {
+			out.bins.assign(histogram->numBins, 0);
+		}
+		double log2Min = 0, binsPerOctave = 0;
+		if (histogram && histogram->numBins) {
+			log2Min = std::log2(histogram->minDensity);
+			binsPerOctave = histogram->numBins / (std::log2(histogram->maxDensity) - log2Min);
+		}
+
+		uint32_t f0 = chunk * STATS_CHUNK_FACES, f1 = (std::min)(f0 + STATS_CHUNK_FACES, mesh.numFaces);
+		for (uint32_t f = f0; f < f1; f++) {
+			const double* p[3];
+			const double* uv[3];
+			double texel[3][2];
+			const double* t[3];
+			for (int v = 0; v < 3; v++) {
+				uint32_t i = mesh.indices[3 * size_t(f) + v];
+				p[v] = mesh.positions + 3 * size_t(i);
+				uv[v] = job.uvs + 2 * size_t(i);
+				texel[v][0] = uv[v][0] * job.scale[0];
+				texel[v][1] = (1 - uv[v][1]) * job.scale[1];
+				t[v] = texel[v];
+			}
+			double area = KahanArea(p[0], p[1], p[2], 3);
+			double uvArea = KahanArea(uv[0], uv[1], uv[2], 2);
+			double pixelArea = KahanArea(t[0], t[1], t[2], 2);
+			out.nan |= std::isnan(area) || std::isnan(uvArea) || std::isnan(pixelArea);
+			out.area += area;
+			out.uvArea += uvArea;
+			out.pixelArea += pixelArea;
+			out.minFaceArea = (std::min)(out.minFaceArea, area);
+			out.maxFaceArea = (std::max)(out.maxFaceArea, area);
+
+			double maxStretch = 0, minStretch = 0;
+			if (FaceStretch(p, t, maxStretch, minStretch)) {
+				out.minStretch = (std::min)(out.minStretch, minStretch);
+				out.maxStretch = (std::max)(out.maxStretch, maxStretch);
+			}
+			if (job.faceStretch) {
+				job.faceStretch[2 * size_t(f)] = maxStretch;
+				job.faceStretch[2 * size_t(f) + 1] = minStretch;
+			}
+
+			if (histogram && histogram->numBins && area > 0) {
+				double bin = std::floor((std::log2(std::sqrt(pixelArea / area)) - log2Min) * binsPerOctave);
+				bin = (std::max)(0.0, (std::min)(bin, histogram->numBins - 1.0));
+				out.bins[(size_t)bin] += area;
+			}
+		}
+	}
+
+	void RunStatsWorker(StatsJob& job)
+	{
+		try {
+			uint32_t chunk;
+			while (!job.failed && (chunk = job.nextChunk++) < job.chunks.size()) {
+				ChunkStats(job, chunk);
+			}
+		}
+		catch (...) {
+			job.failed = true;
+		}
+	}
+
+	// Bounds of n interleaved uvs, one uv per SSE2 register.
+	void UVBounds(const double* uvs, uint32_t n, double* uvMin, double* uvMax)
+	{
+		__m128d lo = _mm_set1_pd(HUGE_VAL), hi = _mm_set1_pd(-HUGE_VAL);
+		for (uint32_t i = 0; i < n; i++) {
+			__m128d uv = _mm_loadu_pd(uvs + 2 * size_t(i));
+			lo = _mm_min_pd(lo, uv);
+			hi = _mm_max_pd(hi, uv);
+		}
+		_mm_storeu_pd(uvMin, lo);
+		_mm_storeu_pd(uvMax, hi);
+	}
+
+	// Scale factors that MeshUVs.RescaleUVs would apply, false if the uvs are to be left as they are.
+	bool RescaleFactors(const UVAtlasUVRescale& rescale, const double* uvMin, const double* uvMax, double* factors)
+	{
+		double sz[2], targetSz[2];
+		bool contained = true, within = true;
+		for (int k = 0; k < 2; k++) {
+			sz[k] = uvMax[k] - uvMin[k];
+			targetSz[k] = rescale.targetMax[k] - rescale.targetMin[k];
+			contained &= uvMin[k] >= rescale.targetMin[k] && uvMax[k] <= rescale.targetMax[k];
+			within &= targetSz[k] - sz[k] <= rescale.growThreshold;
+		}
+		if (rescale.growThreshold > 0 && contained && within) {
+			return false;
+		}
+
+		const double eps = 1e-10;
+		for (int k = 0; k < 2; k++) {
+			factors[k] = std::fabs(sz[k]) > eps ? targetSz[k] / sz[k] : 1;
+		}
+		int lo = factors[0] <= factors[1] ? 0 : 1;
+		if (rescale.maxStretch <= 0) {
+			factors[1 - lo] = factors[lo];
+		}
+		else if (rescale.maxStretch < 1) {
+			double maxAspect = 1.0 / (1.0 - rescale.maxStretch);
+			factors[1 - lo] = (std::min)(factors[1 - lo], maxAspect * factors[lo]);
+		}
+		return true;
+	}
+}
+
+extern "C" __declspec(dllexport) int __cdecl UVAtlasUVStats_Compute(const UVAtlasBakeMesh* mesh, uint32_t width, uint32_t height, const UVAtlasUVRescale* rescale, double* uvs, const UVAtlasUVHistogram* histogram, double* faceStretch, UVAtlasUVStats* stats, int maxThreads)
+{
+	if (!mesh || !stats || !ValidUVMesh(*mesh, L"UV stats")) {
+		return 1;
+	}
+	if (rescale && !uvs) {
+		wprintf(L"\nERROR: UV stats rescale needs an output uv array\n");
+		return 1;
+	}
+	if (histogram && histogram->numBins && !(histogram->bins && histogram->minDensity > 0 && histogram->maxDensity > histogram->minDensity)) {
+		wprintf(L"\nERROR: UV stats histogram needs bins and 0 < minDensity < maxDensity\n");
+		return 1;
+	}
+
+	*stats = UVAtlasUVStats();
+	UVBounds(mesh->uvs, mesh->numVertices, stats->uvMin, stats->uvMax);
+
+	const double* statUVs = mesh->uvs;
+	if (rescale && mesh->numVertices) {
+		double factors[2];
+		if (RescaleFactors(*rescale, stats->uvMin, stats->uvMax, factors)) {
+			// The same operations in the same order as the managed rescale, and new bounds on the way.
+			__m128d uvMin = _mm_loadu_pd(stats->uvMin), targetMin = _mm_loadu_pd(rescale->targetMin);
+			__m128d scale = _mm_loadu_pd(factors);
+			__m128d lo = _mm_set1_pd(HUGE_VAL), hi = _mm_set1_pd(-HUGE_VAL);
+			for (uint32_t i = 0; i < mesh->numVertices; i++) {
+				__m128d uv = _mm_add_pd(targetMin, _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(mesh->uvs + 2 * size_t(i)), uvMin), scale));
+				_mm_storeu_pd(uvs + 2 * size_t(i), uv);
+				lo = _mm_min_pd(lo, uv);
+				hi = _mm_max_pd(hi, uv);
+			}
+			_mm_storeu_pd(stats->uvMin, lo);
+			_mm_storeu_pd(stats->uvMax, hi);
+			stats->rescaled = 1;
+		}
+		else if (uvs != mesh->uvs) {
+			std::copy(mesh->uvs, mesh->uvs + 2 * size_t(mesh->numVertices), uvs);
+		}
+		statUVs = uvs;
+	}
+
+	StatsJob job;
+	job.mesh = mesh;
+	job.uvs = statUVs;
+	job.scale[0] = width && height ? width : 1.0;
+	job.scale[1] = width && height ? height : 1.0;
+	job.histogram = histogram && histogram->numBins ? histogram : nullptr;
+	job.faceStretch = faceStretch;
+	job.nextChunk = 0;
+	job.failed = false;
+	try {
+		job.chunks.resize((mesh->numFaces + STATS_CHUNK_FACES - 1) / STATS_CHUNK_FACES);
+	}
+	catch (...) {
+		wprintf(L"\nERROR: Out of memory for stats of %u faces\n", mesh->numFaces);
+		return 1;
+	}
+
+	size_t numThreads = maxThreads > 0 ? (size_t)maxThreads : (size_t)(std::max)(1u, std::thread::hardware_concurrency());
+	RunWorkers((std::min)(numThreads, job.chunks.size()), [&job](size_t) { RunStatsWorker(job); });
+	if (job.failed) {
+		wprintf(L"\nERROR: Failed computing stats of %u faces\n", mesh->numFaces);
+		return 1;
+	}
+
+	FaceStats total;
+	if (job.histogram) {
+		std::fill(histogram->bins, histogram->bins + histogram->numBins, 0.0);
+	}
+	for (const auto& chunk : job.chunks) {
+		total.nan |= chunk.nan;
+		total.area += chunk.area;
+		total.uvArea += chunk.uvArea;
+		total.pixelArea += chunk.pixelArea;
+		total.minFaceArea = (std::min)(total.minFaceArea, chunk.minFaceArea);
+		total.maxFaceArea = (std::max)(total.maxFaceArea, chunk.maxFaceArea);
+		total.minStretch = (std::min)(total.minStretch, chunk.minStretch);
+		total.maxStretch = (std::max)(total.maxStretch, chunk.maxStretch);
+		for (size_t b = 0; b < chunk.bins.size(); b++) {
+			histogram->bins[b] += chunk.bins[b];
+		}
+	}
+	if (total.nan) {
+		wprintf(L"\nERROR: Face area not a number\n");
+		return 1;
+	}
+	stats->area = total.area;
+	stats->uvArea = total.uvArea;
+	stats->pixelArea = total.pixelArea;
+	stats->minFaceArea = mesh->numFaces ? total.minFaceArea : 0;
+	stats->maxFaceArea = mesh->numFaces ? total.maxFaceArea : 0;
+	stats->minStretch = total.minStretch <= total.maxStretch ? total.minStretch : 0;
+	stats->maxStretch = total.minStretch <= total.maxStretch ? total.maxStretch : 0;
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include "UVAtlasClass.h"
+
+#include <windows.h>
+
+#include <string>
+#include <vector>
+
+// Reruns atlas jobs captured per UVAtlasControl.captureDir, or written by UVAtlasJob_Write, and reports how each
+// replay compares with the recorded call, one CSV row per job.
+//
+// usage: UVAtlasReplay [--maxSec S] [--csv PATH] JOB_OR_DIR...
+//   --maxSec S            wall clock limit per job, 0 for none (default 0)
+//   --csv PATH            write CSV to PATH instead of stdout
+//
+// Directories are searched for *.uvajob files, not recursively.
+
+namespace
+{
+	void AddJobs(const std::wstring& path, std::vector<std::wstring>& jobs)
+	{
+		DWORD attributes = GetFileAttributesW(path.c_str());
+		if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+			jobs.push_back(path);
+			return;
+		}
+		std::wstring dir = path;
+		if (dir.back() != L'\\' && dir.back() != L'/') {
+			dir += L'\\';
+		}
+		WIN32_FIND_DATAW found;
+		HANDLE find = FindFirstFileW((dir + L"*.uvajob").c_str(), &found);
+		if (find == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		do {
+			jobs.push_back(dir + found.cFileName);
+		} while (FindNextFileW(find, &found));
+		FindClose(find);
+	}
+
+	bool SameResult(const UVAtlasJobOutcome& a, const UVAtlasJobOutcome& b)
+	{
+		return a.returnCode == b.returnCode && a.numVertices == b.numVertices && a.numCharts == b.numCharts &&
+			a.stretch == b.stretch;
+	}
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	double maxSec = 0;
+	const wchar_t* csvPath = nullptr;
+	std::vector<std::wstring> jobs;
+	for (int i = 1; i < argc; i++) {
+		std::wstring arg = argv[i];
+		if (arg == L"--maxSec" && i + 1 < argc) {
+			maxSec = _wtof(argv[++i]);
+		}
+		else if (arg == L"--csv" && i + 1 < argc) {
+			csvPath = argv[++i];
+		}
+		else if (arg.compare(0, 2, L"--") == 0) {
+			jobs.clear();
+			break;
+		}
+		else {
+			AddJobs(arg, jobs);
+		}
+	}
+	if (jobs.empty()) {
+		fwprintf(stderr, L"usage: UVAtlasReplay [--maxSec S] [--csv PATH] JOB_OR_DIR...\n");
+		return 1;
+	}
+
+	FILE* csv = stdout;
+	if (csvPath && (_wfopen_s(&csv, csvPath, L"w") || !csv)) {
+		fwprintf(stderr, L"failed to open %s\n", csvPath);
+		return 1;
+	}
+	fwprintf(csv, L"job,faces,recordedReturnCode,returnCode,recordedSec,sec,recordedVertices,vertices,"
+		L"recordedCharts,charts,recordedStretch,stretch,changed\n");
+
+	int numFailed = 0, numChanged = 0;
+	double recordedSec = 0, replayedSec = 0;
+	for (const std::wstring& job : jobs) {
+		uint32_t numFaces = 0;
+		UVAtlasJobOutcome recorded, replayed;
+		if (UVAtlasJob_Replay(job.c_str(), maxSec, numFaces, &recorded, &replayed)) {
+			numFailed++;
+			continue;
+		}
+		// Jobs not captured from a call have nothing to compare with.
+		bool changed = recorded.returnCode >= 0 && !SameResult(recorded, replayed);
+		numChanged += changed ? 1 : 0;
+		recordedSec += recorded.wallSec;
+		replayedSec += replayed.wallSec;
+		fwprintf(csv, L"\"%s\",%u,%d,%d,%.6f,%.6f,%u,%u,%u,%u,%g,%g,%d\n", job.c_str(), numFaces,
+			recorded.returnCode, replayed.returnCode, recorded.wallSec, replayed.wallSec,
+			recorded.numVertices, replayed.numVertices, recorded.numCharts, replayed.numCharts,
+			recorded.stretch, replayed.stretch, changed ? 1 : 0);
+		fflush(csv);
+	}
+	if (csv != stdout) {
+		fclose(csv);
+	}
+
+	fwprintf(stderr, L"replayed %u jobs, %d unreadable, %d changed, %.3fs recorded, %.3fs replayed\n",
+		unsigned(jobs.size() - numFailed), numFailed, numChanged, recordedSec, replayedSec);
+	return numFailed ? 1 : 0;
+}
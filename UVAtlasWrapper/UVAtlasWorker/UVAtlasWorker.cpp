@@ -0,0 +1,18 @@
+#include "UVAtlasClass.h"
+
+#include <windows.h>
+
+// Atlases one job file written by UVAtlasJob_Write in its own process, so that the caller can enforce a hard wall
+// clock limit by killing it. The exit code is the UVAtlasNET return code.
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc != 3) {
+		wprintf(L"usage: UVAtlasWorker <job> <result>\n");
+		return 1;
+	}
+
+	// Don't let a crash pop up an error dialog and hang the caller until its timeout.
+	SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX);
+
+	return UVAtlasJob_Run(argv[1], argv[2]);
+}
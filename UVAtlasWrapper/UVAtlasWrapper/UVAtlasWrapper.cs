@@ -1,9 +1,12 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.ComponentModel;
+using System.Diagnostics;
 using System.IO;
 using System.Linq;
 using System.Runtime.InteropServices;
 using System.Text;
+using System.Threading;
 using System.Threading.Tasks;
 
 
@@ -27,6 +30,9 @@ namespace UVAtlasNET
             SET_VERTEX_FAILED = 3,
             GENERATE_ADJACENCY_FAILED  = 4,
             CREATE_ATLAS_FAILED = 5,
+            CANCELLED = 6,
+            TIMED_OUT = 7,
+            NO_INDEX = 8, //Baker.Bake() baked the image but not the index
         }
 
         [StructLayout(LayoutKind.Sequential, Pack = 1)]
@@ -43,6 +49,457 @@ namespace UVAtlasNET
             public IntPtr indices;
 
             public IntPtr vertexRemap;
+
+            public float stretch;
+            public UInt32 numCharts;
+            public IntPtr facePartitioning;
+        };
+
+        /// <summary>
+        /// Chart information from the partition of a successful atlas.
+        /// </summary>
+        public class ChartInfo
+        {
+            /// <summary>
+            /// Stretch of the atlas as measured by the partition.
+            /// </summary>
+            public float Stretch;
+
+            /// <summary>
+            /// Number of charts.
+            /// </summary>
+            public int NumCharts;
+
+            /// <summary>
+            /// Chart id in [0, NumCharts) of each output face.
+            /// </summary>
+            public int[] FacePartitioning;
+        }
+
+        public enum PositionFormat : uint
+        {
+            FLOAT3 = 0,
+            DOUBLE3 = 1,
+        }
+
+        /// <summary>
+        /// Interleaved mesh input that the native side reads in place.
+        /// Both buffers must stay pinned for the duration of the call.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct UVAtlasInput
+        {
+            public IntPtr positions;
+            public UInt32 positionStride;
+            public PositionFormat positionFormat;
+            public UInt32 numVertices;
+
+            public IntPtr indices;
+            public UInt32 numFaces;
+
+            public IntPtr adjacency;
+            public UInt32 welded;
+        };
+
+        /// <summary>
+        /// Output index formats, values are the matching DXGI_FORMAT.
+        /// </summary>
+        public enum IndexFormat : uint
+        {
+            R32_UINT = 42,
+            R16_UINT = 57,
+        }
+
+        public enum Phase
+        {
+            INPUT = 0,
+            ADJACENCY = 1,
+            PARTITION = 2,
+            PACK = 3,
+            OUTPUT = 4,
+        }
+
+        public const int NUM_PHASES = 5;
+
+        /// <summary>
+        /// Wall time of one phase of an atlas call.
+        /// Memory is process wide, sampled at the end of the phase, except peakPrivateBytes which is the most private
+        /// memory sampled at any point during the phase.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct PhaseStats
+        {
+            public double wallSec;
+            public UInt64 privateBytes;
+            public UInt64 peakWorkingSetBytes;
+            public UInt64 peakPrivateBytes;
+        };
+
+        [Flags]
+        public enum Preflight
+        {
+            NONE = 0,
+            CLEAN = 0x1,
+            BREAK_BOWTIES = 0x2,
+            WELD = 0x4,
+        }
+
+        [Flags]
+        public enum Capture
+        {
+            NONE = 0,
+            FAILED = 0x1,
+            SLOW = 0x2,
+            SAMPLED = 0x4,
+        }
+
+        /// <summary>
+        /// What preflight found and repaired, validateResult is the HRESULT of validating the mesh.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct PreflightStats
+        {
+            public UInt32 degenerateFaces;
+            public UInt32 removedFaces;
+            public UInt32 duplicatedVertices;
+            public int validateResult;
+            public UInt32 weldedVertices;
+        };
+
+        /// <summary>
+        /// Optional controls and telemetry for an atlas call.
+        /// </summary>
+        public class AtlasControl
+        {
+            /// <summary>
+            /// Wall clock limit enforced natively, after which TIMED_OUT is returned, 0 for none.
+            /// For AtlasBatch() this applies to each mesh separately.
+            /// </summary>
+            public double MaxSec;
+
+            /// <summary>
+            /// Stops the native call promptly with CANCELLED when cancelled.
+            /// </summary>
+            public CancellationToken Cancel;
+
+            /// <summary>
+            /// Called on the atlasing thread with the progress of the current phase in [0, 1].  Not used by
+            /// AtlasBatch().  Exceptions are swallowed since they can't propagate through native code.
+            /// </summary>
+            public Action<Phase, float> Progress;
+
+            /// <summary>
+            /// Indexed by Phase, refilled by each call even if it fails.  Not used by AtlasBatch().
+            /// </summary>
+            public readonly PhaseStats[] Phases = new PhaseStats[NUM_PHASES];
+
+            /// <summary>
+            /// Optional directory of results keyed by a hash of the input and all parameters.  A hit skips atlasing
+            /// entirely and a miss stores its result, so re-atlasing an identical mesh is nearly free.  Safe to share
+            /// between threads and processes.  Not used by CreateCharts() and PackCharts().
+            /// </summary>
+            public string CacheDir;
+
+            /// <summary>
+            /// Asserts that the input is already welded, so faces are adjacent exactly when their edges share vertex
+            /// indices and adjacency is found without the epsilon search over positions.
+            /// </summary>
+            public bool Welded;
+
+            /// <summary>
+            /// Optional precomputed adjacency, 3 neighboring faces per face (-1 for none), used as is.
+            /// Takes precedence over Welded.  Neither is used by AtlasBatch(), which takes them per BatchMesh.
+            /// </summary>
+            public int[] Adjacency;
+
+            /// <summary>
+            /// CLEAN drops faces with repeated vertices or no area, then validates the mesh and cleans it if invalid,
+            /// with BREAK_BOWTIES also splitting bowtie vertices.  WELD merges coincident vertices (within the adjacency
+            /// epsilon), dropping faces that collapse.  Either way the output vertex remap still refers to the input.
+            /// </summary>
+            public Preflight Preflight;
+
+            /// <summary>
+            /// Refilled by each call.  Not used by AtlasBatch().
+            /// </summary>
+            public PreflightStats PreflightStats;
+
+            /// <summary>
+            /// Reorders the output faces for vertex cache locality and the output vertices for fetch locality, which
+            /// makes the result cheaper to render and compress.  Output vertex remap and chart ids follow along.
+            /// </summary>
+            public bool Optimize;
+
+            /// <summary>
+            /// Frees each native stage's buffers as soon as the next stage has consumed them, even in a reused context,
+            /// and keeps only the uvs of the output, for atlasing very large meshes.  Not used by CreateCharts() and
+            /// CreateResultLadder().  Phases[].peakPrivateBytes shows the effect.
+            /// </summary>
+            public bool LowMemory;
+
+            /// <summary>
+            /// Optional directory where a call's input, parameters and outcome are written as a .uvajob file when any
+            /// of the Capture conditions hold, for replay with UVAtlasReplay.  FAILED captures calls that don't succeed,
+            /// SLOW those taking over CaptureSlowSec, and SAMPLED a random CaptureSampleRate fraction of calls.
+            /// Not used by CreateCharts(), CreateResultLadder() and CreateResultOutOfProcess().
+            /// </summary>
+            public string CaptureDir;
+            public Capture Capture;
+            public double CaptureSlowSec;
+            public float CaptureSampleRate;
+        }
+
+        /// <summary>
+        /// How an atlas call ended, as captured in a job and when it is replayed, see ReplayJob().
+        /// returnCode is a ReturnCode, or -1 if the job was not captured from a call.  numVertices is the output
+        /// vertex count.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct JobOutcome
+        {
+            public int returnCode;
+            public double wallSec;
+            public UInt32 numVertices;
+            public UInt32 numCharts;
+            public float stretch;
+        };
+
+        /// <summary>
+        /// Per-vertex input attribute, e.g. normals, colors or extra floats, expanded natively through the output
+        /// vertex remap.  Input holds ComponentsPerVertex primitive elements per input vertex.  Output is allocated to
+        /// match the result if null, and otherwise must hold ComponentsPerVertex elements per output vertex.
+        /// </summary>
+        public class AttributeStream
+        {
+            public Array Input;
+            public int ComponentsPerVertex = 1;
+            public Array Output;
+        }
+
+        /// <summary>
+        /// One attempt of an atlas ladder, see CreateResultLadder().
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct Strategy
+        {
+            public int naive;
+            public int maxCharts;
+            public float maxStretch;
+            public Quality quality;
+
+            public static Strategy Atlas(int maxCharts, float maxStretch, Quality quality)
+            {
+                return new Strategy() { maxCharts = maxCharts, maxStretch = maxStretch, quality = quality };
+            }
+
+            /// <summary>
+            /// Gives every face its own chart, which can only fail on zero area faces.
+            /// </summary>
+            public static Strategy Naive()
+            {
+                return new Strategy() { naive = 1 };
+            }
+        }
+
+        /// <summary>
+        /// Geodesic quality, then fast, then with relaxed stretch, then with unlimited charts, then naive.
+        /// </summary>
+        public static Strategy[] DefaultLadder(int maxCharts = 0, float maxStretch = 0.1666f)
+        {
+            float relaxedStretch = 0.5f * (maxStretch + 1);
+            var ladder = new List<Strategy>();
+            ladder.Add(Strategy.Atlas(maxCharts, maxStretch, Quality.UVATLAS_GEODESIC_QUALITY));
+            ladder.Add(Strategy.Atlas(maxCharts, maxStretch, Quality.UVATLAS_GEODESIC_FAST));
+            ladder.Add(Strategy.Atlas(maxCharts, relaxedStretch, Quality.UVATLAS_GEODESIC_FAST));
+            if (maxCharts > 0)
+            {
+                ladder.Add(Strategy.Atlas(0, relaxedStretch, Quality.UVATLAS_GEODESIC_FAST));
+            }
+            ladder.Add(Strategy.Naive());
+            return ladder.ToArray();
+        }
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void UVAtlasProgressCallback(int phase, float percentComplete, IntPtr userData);
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasControl
+        {
+            public IntPtr cancel;
+            public double maxSec;
+
+            public IntPtr progress;
+            public IntPtr progressUserData;
+            public IntPtr phaseStats;
+
+            public IntPtr cacheDir;
+
+            public UInt32 preflight;
+            public IntPtr preflightStats;
+
+            public int optimize;
+            public int lowMemory;
+
+            public IntPtr captureDir;
+            public UInt32 capture;
+            public double captureSlowSec;
+            public float captureSampleRate;
+        };
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasStream
+        {
+            public IntPtr input;
+            public IntPtr output;
+            public UInt32 elementSize;
+            public UInt32 numElements;
+        };
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasBatchItem
+        {
+            public UVAtlasInput input;
+            public int maxCharts;
+            public float maxStretch;
+            public float gutter;
+            public int width;
+            public int height;
+            public Quality quality;
+            public float adjacencyEpsilon;
+        };
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void UVAtlasBatchCallback(UInt32 index, int returnCode, IntPtr result, IntPtr userData);
+
+        /// <summary>
+        /// One mesh of an AtlasBatch() call.
+        /// Parameters have the same meaning as in Atlas().
+        /// </summary>
+        public class BatchMesh
+        {
+            public float[] Positions; //interleaved x, y, z
+            public double[] DoublePositions; //interleaved x, y, z, used instead of Positions if not null
+            public int[] Indices;
+            public int MaxCharts = 0;
+            public float MaxStretch = 0.1666f;
+            public float Gutter = 2;
+            public int Width = 512;
+            public int Height = 512;
+            public Quality Quality = Quality.UVATLAS_DEFAULT;
+            public float AdjacencyEpsilon = 0;
+            public bool Welded = false; //see AtlasControl.Welded
+            public int[] Adjacency; //optional, see AtlasControl.Adjacency
+
+            /// <summary>
+            /// Optional per-vertex attributes expanded through the vertex remap of a successful result, as by
+            /// ExpandResult(), before the completion handler is invoked.
+            /// </summary>
+            public AttributeStream[] Attributes;
+        }
+
+        /// <summary>
+        /// Per mesh completion handler for AtlasBatch(), the output arrays are null unless returnCode is SUCCESS.
+        /// </summary>
+        public delegate void BatchMeshDone(int index, ReturnCode returnCode,
+                                           float[] outU, float[] outV, int[] outIndices, int[] outVertexRemap);
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasImage
+        {
+            public IntPtr bands;
+            public UInt32 numBands;
+            public UInt32 width;
+            public UInt32 height;
+        };
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasBakeMesh
+        {
+            public IntPtr positions;
+            public IntPtr uvs;
+            public UInt32 numVertices;
+            public IntPtr indices;
+            public UInt32 numFaces;
+        };
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasBakeSource
+        {
+            public UVAtlasBakeMesh mesh;
+            public UVAtlasImage image;
+            public UVAtlasImage index;
+        };
+
+        /// <summary>
+        /// Float image for baking, with one row major array of Width * Height texels per band.
+        /// </summary>
+        public class BakeImage
+        {
+            public float[][] Bands;
+            public int Width;
+            public int Height;
+        }
+
+        /// <summary>
+        /// Textured mesh for baking.
+        /// </summary>
+        public class BakeMesh
+        {
+            public double[] Positions; //interleaved x, y, z
+            public double[] UVs; //interleaved u, v
+            public int[] Indices;
+        }
+
+        /// <summary>
+        /// One source of a Baker, the index image is optional.
+        /// </summary>
+        public class BakeSource
+        {
+            public BakeMesh Mesh;
+            public BakeImage Image;
+            public BakeImage Index;
+        }
+
+        /// <summary>
+        /// Affine remap of uvs into [minU, maxU] x [minV, maxV] for ComputeUVStats(), with the same maxStretch and
+        /// growThreshold semantics as MeshUVs.RescaleUVs().
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct UVRescale
+        {
+            public double minU, minV;
+            public double maxU, maxV;
+            public double maxStretch;
+            public double growThreshold;
+        };
+
+        /// <summary>
+        /// Output of ComputeUVStats().  Areas are unsigned, pixelArea is in texels.  Stretch is the largest and
+        /// smallest singular value of the map from a face to texel space, in texels per unit length, over faces with
+        /// nonzero area.  rescaled is nonzero if the uvs were remapped.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        public struct UVStats
+        {
+            public double minU, minV;
+            public double maxU, maxV;
+            public double area;
+            public double uvArea;
+            public double pixelArea;
+            public double minFaceArea;
+            public double maxFaceArea;
+            public double minStretch;
+            public double maxStretch;
+            public int rescaled;
+        };
+
+        [StructLayout(LayoutKind.Sequential, Pack = 1)]
+        private struct UVAtlasUVHistogram
+        {
+            public IntPtr bins;
+            public UInt32 numBins;
+            public double minDensity;
+            public double maxDensity;
         };
 
         const string DLL_NAME = "UVAtlasLib_";
@@ -50,15 +507,201 @@ namespace UVAtlasNET
         [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlas", CallingConvention = CallingConvention.Cdecl)]
         private static unsafe extern UVAtlasData* UVAtlas32(UVAtlasData* data, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, out int returnCode);
 
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasResultCreate32(UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_GetSize", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultGetSize32(IntPtr result, out UInt32 numVertices, out UInt32 numFaces);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_Copy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultCopy32(IntPtr result, float* us, float* vs, int* indices, int* vertexRemap);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_GetIndexFormat", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IndexFormat UVAtlasResultGetIndexFormat32(IntPtr result);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_CopyIndices", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasResultCopyIndices32(IntPtr result, IndexFormat format, void* indices);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_Expand", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasResultExpand32(IntPtr result, UVAtlasStream* streams, UInt32 numStreams);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_GetCharts", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultGetCharts32(IntPtr result, out float stretch, out UInt32 numCharts, int* facePartitioning);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultDestroy32(IntPtr result);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasContext_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextCreate32();
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasContext_Atlas", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextAtlas32(IntPtr context, UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_CreateLadder", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasResultCreateLadder32(UVAtlasInput* input, Strategy* strategies, UInt32 numStrategies, float gutter, int width, int height, float adjacencyEpsilon, UVAtlasControl* control, out int strategyIndex, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasContext_AtlasLadder", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextAtlasLadder32(IntPtr context, UVAtlasInput* input, Strategy* strategies, UInt32 numStrategies, float gutter, int width, int height, float adjacencyEpsilon, UVAtlasControl* control, out int strategyIndex, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasContext_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasContextDestroy32(IntPtr context);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasCharts_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasChartsCreate32(UVAtlasInput* input, int maxCharts, float maxStretch, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasCharts_Pack", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasChartsPack32(IntPtr charts, float gutter, int width, int height, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasCharts_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasChartsDestroy32(IntPtr charts);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasBatch", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasBatch32(UVAtlasBatchItem* items, UInt32 numItems, int maxThreads, UVAtlasBatchCallback callback, IntPtr userData, UVAtlasControl* control);
+
         [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasData_Destroy", CallingConvention = CallingConvention.Cdecl)]
         private static unsafe extern void UVAtlasDestroy32(UVAtlasData* data);
 
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasJob_Write", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static unsafe extern int UVAtlasJobWrite32(string path, UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasResult_Read", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static extern IntPtr UVAtlasResultRead32(string path, int numVertices, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasJob_Replay", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static extern int UVAtlasJobReplay32(string jobPath, double maxSec, out int numFaces, out JobOutcome recorded, out JobOutcome replayed);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasBaker_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasBakerCreate32(UVAtlasBakeSource* sources, UInt32 numSources, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasBaker_Bake", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasBakerBake32(IntPtr baker, UVAtlasBakeMesh* dest, UVAtlasImage* image, UVAtlasImage* index, byte* coverage, int maxThreads);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasBaker_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void UVAtlasBakerDestroy32(IntPtr baker);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasDilate", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasDilate32(UVAtlasImage* images, UInt32 numImages, byte* coverage, int radius, int maxThreads);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasSamples_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasSamplesCreate32(UVAtlasBakeMesh* mesh, UInt32 width, UInt32 height, double fraction, int maxThreads, out int returnCode);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasSamples_GetCount", CallingConvention = CallingConvention.Cdecl)]
+        private static extern UInt32 UVAtlasSamplesGetCount32(IntPtr samples);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasSamples_Copy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasSamplesCopy32(IntPtr samples, int* pixels, int* faces, double* barycentrics, double* points);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasSamples_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void UVAtlasSamplesDestroy32(IntPtr samples);
+
+        [DllImport(DLL_NAME + "x32.dll", EntryPoint = "UVAtlasUVStats_Compute", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasUVStatsCompute32(UVAtlasBakeMesh* mesh, UInt32 width, UInt32 height, UVRescale* rescale, double* uvs, UVAtlasUVHistogram* histogram, double* faceStretch, UVStats* stats, int maxThreads);
+
         [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlas", CallingConvention = CallingConvention.Cdecl)]
         private static unsafe extern UVAtlasData* UVAtlas64(UVAtlasData* data, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, out int returnCode);
 
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasResultCreate64(UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_GetSize", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultGetSize64(IntPtr result, out UInt32 numVertices, out UInt32 numFaces);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_Copy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultCopy64(IntPtr result, float* us, float* vs, int* indices, int* vertexRemap);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_GetIndexFormat", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IndexFormat UVAtlasResultGetIndexFormat64(IntPtr result);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_CopyIndices", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasResultCopyIndices64(IntPtr result, IndexFormat format, void* indices);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_Expand", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasResultExpand64(IntPtr result, UVAtlasStream* streams, UInt32 numStreams);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_GetCharts", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultGetCharts64(IntPtr result, out float stretch, out UInt32 numCharts, int* facePartitioning);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasResultDestroy64(IntPtr result);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasContext_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextCreate64();
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasContext_Atlas", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextAtlas64(IntPtr context, UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_CreateLadder", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasResultCreateLadder64(UVAtlasInput* input, Strategy* strategies, UInt32 numStrategies, float gutter, int width, int height, float adjacencyEpsilon, UVAtlasControl* control, out int strategyIndex, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasContext_AtlasLadder", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasContextAtlasLadder64(IntPtr context, UVAtlasInput* input, Strategy* strategies, UInt32 numStrategies, float gutter, int width, int height, float adjacencyEpsilon, UVAtlasControl* control, out int strategyIndex, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasContext_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasContextDestroy64(IntPtr context);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasCharts_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasChartsCreate64(UVAtlasInput* input, int maxCharts, float maxStretch, Quality quality, float adjacencyEpsilon, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasCharts_Pack", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasChartsPack64(IntPtr charts, float gutter, int width, int height, UVAtlasControl* control, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasCharts_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasChartsDestroy64(IntPtr charts);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasBatch", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasBatch64(UVAtlasBatchItem* items, UInt32 numItems, int maxThreads, UVAtlasBatchCallback callback, IntPtr userData, UVAtlasControl* control);
+
         [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasData_Destroy", CallingConvention = CallingConvention.Cdecl)]
         private static unsafe extern void UVAtlasDestroy64(UVAtlasData* data);
 
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasJob_Write", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static unsafe extern int UVAtlasJobWrite64(string path, UVAtlasInput* input, int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon, UVAtlasControl* control);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasResult_Read", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static extern IntPtr UVAtlasResultRead64(string path, int numVertices, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasJob_Replay", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static extern int UVAtlasJobReplay64(string jobPath, double maxSec, out int numFaces, out JobOutcome recorded, out JobOutcome replayed);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasBaker_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasBakerCreate64(UVAtlasBakeSource* sources, UInt32 numSources, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasBaker_Bake", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasBakerBake64(IntPtr baker, UVAtlasBakeMesh* dest, UVAtlasImage* image, UVAtlasImage* index, byte* coverage, int maxThreads);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasBaker_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void UVAtlasBakerDestroy64(IntPtr baker);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasDilate", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasDilate64(UVAtlasImage* images, UInt32 numImages, byte* coverage, int radius, int maxThreads);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasSamples_Create", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern IntPtr UVAtlasSamplesCreate64(UVAtlasBakeMesh* mesh, UInt32 width, UInt32 height, double fraction, int maxThreads, out int returnCode);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasSamples_GetCount", CallingConvention = CallingConvention.Cdecl)]
+        private static extern UInt32 UVAtlasSamplesGetCount64(IntPtr samples);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasSamples_Copy", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern void UVAtlasSamplesCopy64(IntPtr samples, int* pixels, int* faces, double* barycentrics, double* points);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasSamples_Destroy", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void UVAtlasSamplesDestroy64(IntPtr samples);
+
+        [DllImport(DLL_NAME + "x64.dll", EntryPoint = "UVAtlasUVStats_Compute", CallingConvention = CallingConvention.Cdecl)]
+        private static unsafe extern int UVAtlasUVStatsCompute64(UVAtlasBakeMesh* mesh, UInt32 width, UInt32 height, UVRescale* rescale, double* uvs, UVAtlasUVHistogram* histogram, double* faceStretch, UVStats* stats, int maxThreads);
+
+        /// <summary>
+        /// Path of the worker executable used by CreateResultOutOfProcess(), by default the one matching the process
+        /// bitness next to the application, where UVAtlas.NET.targets puts it.
+        /// </summary>
+        public static string WorkerPath = Path.Combine(AppDomain.CurrentDomain.BaseDirectory,
+                                                       Environment.Is64BitProcess ? "UVAtlasWorker_x64.exe" : "UVAtlasWorker_x32.exe");
+
+        /// <summary>
+        /// Extra time a worker gets past AtlasControl.MaxSec to stop on its own before it is killed.
+        /// </summary>
+        public static double WorkerGraceSec = 5;
+
         /// <summary>
         /// Generates UVs for a mesh
         /// </summary>
@@ -138,26 +781,1436 @@ namespace UVAtlasNET
             {
                 res = UVAtlas32(&data, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, out rc);
             }
-            ReturnCode returnCode = (ReturnCode)rc;
-            if (res == (UVAtlasData*) 0 || returnCode != ReturnCode.SUCCESS)
-            {
-                return returnCode;
-            }
-            outU = new float[res->numVertices];
-            outV = new float[res->numVertices];
-            outIndices = new int[res->numFaces * 3];
-            outVertexRemap = new int[res->numVertices];
-
-            Marshal.Copy(res->us, outU, 0, outU.Length);
-            Marshal.Copy(res->vs, outV, 0, outV.Length);
-            Marshal.Copy(res->indices, outIndices, 0, outIndices.Length);
-            Marshal.Copy(res->vertexRemap, outVertexRemap, 0, outVertexRemap.Length);
-
             Marshal.FreeHGlobal(data.xs);
             Marshal.FreeHGlobal(data.ys);
             Marshal.FreeHGlobal(data.zs);
             Marshal.FreeHGlobal(data.indices);
 
+            return TakeResult(res, (ReturnCode)rc, out outU, out outV, out outIndices, out outVertexRemap);
+        }
+
+        /// <summary>
+        /// Generates UVs for a mesh given interleaved xyz positions, avoiding the per-axis copies of the overload above.
+        /// The positions and indices are pinned and read in place by the native library.
+        /// </summary>
+        /// <param name="inPositions">Interleaved per vertex x, y, z positions</param>
+        /// <param name="inIndices">Array specifying vertex indices for faces.  Each 3 elements specify a face.</param>
+        /// <param name="context">Optional context from CreateContext() whose scratch memory is reused, must not be shared between threads</param>
+        /// <param name="control">Optional deadline, cancellation, progress and per phase telemetry</param>
+        /// <param name="charts">Optional, filled with the stretch, chart count and per face chart ids on success</param>
+        /// <param name="attributes">Optional per-vertex attributes to expand through the vertex remap on success, see ExpandResult()</param>
+        /// <remarks>All other parameters are the same as the per-axis overload.</remarks>
+        public static unsafe ReturnCode Atlas(
+            float[] inPositions, int[] inIndices,
+            out float[] outU, out float[] outV, out int[] outIndices, out int[] outVertexRemap,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            IntPtr context = default(IntPtr), AtlasControl control = null, ChartInfo charts = null,
+            AttributeStream[] attributes = null)
+        {
+            if (inPositions.Length % 3 != 0)
+            {
+                throw new ArgumentException("Atlas input positions not divisible by 3");
+            }
+            fixed (float* positions = inPositions)
+            {
+                fixed (int* indices = inIndices)
+                {
+                    return Atlas((IntPtr)positions, 0, PositionFormat.FLOAT3, inPositions.Length / 3, (IntPtr)indices, inIndices.Length,
+                                 out outU, out outV, out outIndices, out outVertexRemap,
+                                 maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, context, control, charts,
+                                 attributes);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Same as the interleaved float overload but with double precision positions, which are recentered about their
+        /// centroid and narrowed natively, so that meshes far from the origin keep their precision.
+        /// </summary>
+        public static unsafe ReturnCode Atlas(
+            double[] inPositions, int[] inIndices,
+            out float[] outU, out float[] outV, out int[] outIndices, out int[] outVertexRemap,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            IntPtr context = default(IntPtr), AtlasControl control = null, ChartInfo charts = null,
+            AttributeStream[] attributes = null)
+        {
+            if (inPositions.Length % 3 != 0)
+            {
+                throw new ArgumentException("Atlas input positions not divisible by 3");
+            }
+            fixed (double* positions = inPositions)
+            {
+                fixed (int* indices = inIndices)
+                {
+                    return Atlas((IntPtr)positions, 0, PositionFormat.DOUBLE3, inPositions.Length / 3, (IntPtr)indices, inIndices.Length,
+                                 out outU, out outV, out outIndices, out outVertexRemap,
+                                 maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, context, control, charts,
+                                 attributes);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Generates UVs for a mesh whose positions and indices are already in caller-pinned native memory.
+        /// </summary>
+        /// <param name="positions">Pointer to the first vertex position</param>
+        /// <param name="positionStride">Bytes between consecutive positions, 0 if tightly packed</param>
+        /// <param name="positionFormat">Whether each position is three floats or three doubles</param>
+        /// <param name="numVertices">Number of vertex positions</param>
+        /// <param name="indices">Pointer to 32 bit vertex indices, each 3 elements specify a face</param>
+        /// <param name="numIndices">Number of indices, must be divisible by 3</param>
+        /// <param name="context">Optional context from CreateContext() whose scratch memory is reused, must not be shared between threads</param>
+        /// <param name="control">Optional deadline, cancellation, progress and per phase telemetry</param>
+        /// <param name="charts">Optional, filled with the stretch, chart count and per face chart ids on success</param>
+        /// <param name="attributes">Optional per-vertex attributes to expand through the vertex remap on success, see ExpandResult()</param>
+        /// <remarks>All other parameters are the same as the per-axis overload.</remarks>
+        public static unsafe ReturnCode Atlas(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out float[] outU, out float[] outV, out int[] outIndices, out int[] outVertexRemap,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            IntPtr context = default(IntPtr), AtlasControl control = null, ChartInfo charts = null,
+            AttributeStream[] attributes = null)
+        {
+            ushort[] outIndices16;
+            return Atlas(positions, positionStride, positionFormat, numVertices, indices, numIndices,
+                         out outU, out outV, false, out outIndices16, out outIndices, out outVertexRemap,
+                         maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, context, control, charts,
+                         attributes);
+        }
+
+        /// <summary>
+        /// Same as the raw pointer overload but emits 16 bit indices when the output vertex count allows, which is
+        /// the common case for tiles, halving the index memory and copy.  Exactly one of outIndices16 and
+        /// outIndices32 is set on success.
+        /// </summary>
+        public static unsafe ReturnCode Atlas(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out float[] outU, out float[] outV, out ushort[] outIndices16, out int[] outIndices32, out int[] outVertexRemap,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            IntPtr context = default(IntPtr), AtlasControl control = null, ChartInfo charts = null,
+            AttributeStream[] attributes = null)
+        {
+            return Atlas(positions, positionStride, positionFormat, numVertices, indices, numIndices,
+                         out outU, out outV, true, out outIndices16, out outIndices32, out outVertexRemap,
+                         maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, context, control, charts,
+                         attributes);
+        }
+
+        private static unsafe ReturnCode Atlas(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out float[] outU, out float[] outV, bool allow16, out ushort[] outIndices16, out int[] outIndices, out int[] outVertexRemap,
+            int maxCharts, float maxStretch, float gutter, int width, int height, Quality quality, float adjacencyEpsilon,
+            IntPtr context, AtlasControl control, ChartInfo charts, AttributeStream[] attributes)
+        {
+            outU = null;
+            outV = null;
+            outIndices16 = null;
+            outIndices = null;
+            outVertexRemap = null;
+
+            IntPtr result;
+            ReturnCode returnCode = context != IntPtr.Zero ?
+                ContextAtlas(context, positions, positionStride, positionFormat, numVertices, indices, numIndices,
+                             out result, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon,
+                             control) :
+                CreateResult(positions, positionStride, positionFormat, numVertices, indices, numIndices,
+                             out result, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon,
+                             control);
+            if (returnCode != ReturnCode.SUCCESS)
+            {
+                return returnCode;
+            }
+            try
+            {
+                var stopwatch = Stopwatch.StartNew();
+                UInt64 startPrivateBytes = 0;
+                if (control != null)
+                {
+                    using (var process = Process.GetCurrentProcess())
+                    {
+                        startPrivateBytes = (UInt64)process.PrivateMemorySize64;
+                    }
+                }
+                int numOutVertices, numOutIndices;
+                GetResultSize(result, out numOutVertices, out numOutIndices);
+                outU = new float[numOutVertices];
+                outV = new float[numOutVertices];
+                outVertexRemap = new int[numOutVertices];
+                if (allow16 && GetResultIndexFormat(result) == IndexFormat.R16_UINT)
+                {
+                    outIndices16 = new ushort[numOutIndices];
+                    CopyResultIndices(result, outIndices16);
+                }
+                else
+                {
+                    outIndices = new int[numOutIndices];
+                }
+                CopyResult(result, outU, outV, outIndices, outVertexRemap);
+                if (attributes != null)
+                {
+                    ExpandResult(result, attributes);
+                }
+                if (charts != null)
+                {
+                    charts.FacePartitioning = new int[numOutIndices / 3];
+                    GetResultCharts(result, out charts.Stretch, out charts.NumCharts, charts.FacePartitioning);
+                }
+                if (control != null)
+                {
+                    //like the native phases, the peak is the most of the samples taken, here at the start and end
+                    using (var process = Process.GetCurrentProcess())
+                    {
+                        UInt64 privateBytes = (UInt64)process.PrivateMemorySize64;
+                        control.Phases[(int)Phase.OUTPUT].wallSec = stopwatch.Elapsed.TotalSeconds;
+                        control.Phases[(int)Phase.OUTPUT].privateBytes = privateBytes;
+                        control.Phases[(int)Phase.OUTPUT].peakWorkingSetBytes = (UInt64)process.PeakWorkingSet64;
+                        control.Phases[(int)Phase.OUTPUT].peakPrivateBytes = Math.Max(startPrivateBytes, privateBytes);
+                    }
+                }
+            }
+            finally
+            {
+                if (context == IntPtr.Zero)
+                {
+                    DestroyResult(result);
+                }
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// First phase of the two phase atlas API.
+        /// Runs the atlas and retains the output natively so that the caller can query its size with GetResultSize(),
+        /// fill its own (possibly pooled) arrays with CopyResult(), and finally release it with DestroyResult().
+        /// On failure result is IntPtr.Zero and nothing needs to be released.
+        /// </summary>
+        /// <remarks>Parameters are the same as the raw pointer overload of Atlas().</remarks>
+        public static unsafe ReturnCode CreateResult(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out IntPtr result,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            AtlasControl control = null)
+        {
+            UVAtlasInput input = MakeInput(positions, positionStride, positionFormat, numVertices, indices, numIndices);
+
+            int rc;
+            using (var nativeControl = new NativeControl(control, perCall: true))
+            {
+                nativeControl.ApplyTopology(ref input);
+                UVAtlasControl nc = nativeControl.Control;
+                if (Environment.Is64BitProcess)
+                {
+                    result = UVAtlasResultCreate64(&input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc, out rc);
+                }
+                else
+                {
+                    result = UVAtlasResultCreate32(&input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc, out rc);
+                }
+            }
+            ReturnCode returnCode = (ReturnCode)rc;
+            if (result == IntPtr.Zero && returnCode == ReturnCode.SUCCESS)
+            {
+                returnCode = ReturnCode.UNKNOWN;
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// Same as CreateResult() but atlases in a separate UVAtlasWorker process, so that a call stuck in native code
+        /// or exhausting memory can be killed instead of taking down or hanging this process.  The input is written to
+        /// a job file in workDir (default the temp directory) that the worker maps in place.  The worker is killed with
+        /// TIMED_OUT if it outlives control.MaxSec plus WorkerGraceSec, or with CANCELLED when control.Cancel fires, and
+        /// a crash or a worker missing from WorkerPath gives UNKNOWN.  The result only holds uvs and is released with
+        /// DestroyResult().
+        /// control.Progress, Phases, PreflightStats, CacheDir and CaptureDir are not used.
+        /// </summary>
+        public static unsafe ReturnCode CreateResultOutOfProcess(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out IntPtr result,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            AtlasControl control = null, string workDir = null)
+        {
+            UVAtlasInput input = MakeInput(positions, positionStride, positionFormat, numVertices, indices, numIndices);
+
+            result = IntPtr.Zero;
+            string basePath = Path.Combine(workDir ?? Path.GetTempPath(), "uvatlas-" + Guid.NewGuid().ToString("N"));
+            string jobPath = basePath + ".job", resultPath = basePath + ".result";
+            try
+            {
+                int rc;
+                using (var nativeControl = new NativeControl(control, perCall: false))
+                {
+                    nativeControl.ApplyTopology(ref input);
+                    UVAtlasControl nc = nativeControl.Control;
+                    rc = Environment.Is64BitProcess ?
+                        UVAtlasJobWrite64(jobPath, &input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc) :
+                        UVAtlasJobWrite32(jobPath, &input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc);
+                }
+                if (rc != 0)
+                {
+                    return ReturnCode.UNKNOWN;
+                }
+
+                ReturnCode returnCode = RunWorker(jobPath, resultPath, control);
+                if (returnCode != ReturnCode.SUCCESS)
+                {
+                    return returnCode;
+                }
+                //the result file is checked against the input, so a stale or corrupt one reads as a failure
+                result = Environment.Is64BitProcess ? UVAtlasResultRead64(resultPath, numVertices, out rc) :
+                    UVAtlasResultRead32(resultPath, numVertices, out rc);
+                return result != IntPtr.Zero ? ReturnCode.SUCCESS : ReturnCode.UNKNOWN;
+            }
+            finally
+            {
+                foreach (var path in new[] { jobPath, resultPath })
+                {
+                    if (File.Exists(path))
+                    {
+                        File.Delete(path);
+                    }
+                }
+            }
+        }
+
+        private static ReturnCode RunWorker(string jobPath, string resultPath, AtlasControl control)
+        {
+            var info = new ProcessStartInfo(WorkerPath, "\"" + jobPath + "\" \"" + resultPath + "\"")
+            {
+                UseShellExecute = false,
+                CreateNoWindow = true
+            };
+            double limitSec = control != null && control.MaxSec > 0 ? control.MaxSec + WorkerGraceSec : 0;
+            var stopwatch = Stopwatch.StartNew();
+            Process started;
+            try
+            {
+                started = Process.Start(info);
+            }
+            catch (Win32Exception)
+            {
+                //missing or not executable
+                return ReturnCode.UNKNOWN;
+            }
+            catch (FileNotFoundException)
+            {
+                return ReturnCode.UNKNOWN;
+            }
+            if (started == null)
+            {
+                return ReturnCode.UNKNOWN;
+            }
+            using (var process = started)
+            {
+                while (!process.WaitForExit(100))
+                {
+                    ReturnCode killCode;
+                    if (control != null && control.Cancel.IsCancellationRequested)
+                    {
+                        killCode = ReturnCode.CANCELLED;
+                    }
+                    else if (limitSec > 0 && stopwatch.Elapsed.TotalSeconds > limitSec)
+                    {
+                        killCode = ReturnCode.TIMED_OUT;
+                    }
+                    else
+                    {
+                        continue;
+                    }
+                    try
+                    {
+                        process.Kill();
+                    }
+                    catch (InvalidOperationException)
+                    {
+                        //already exited
+                    }
+                    process.WaitForExit();
+                    return killCode;
+                }
+                int exitCode = process.ExitCode;
+                return Enum.IsDefined(typeof(ReturnCode), exitCode) ? (ReturnCode)exitCode : ReturnCode.UNKNOWN;
+            }
+        }
+
+        /// <summary>
+        /// Atlases a job captured per AtlasControl.CaptureDir in this process, as UVAtlasReplay does, with maxSec as
+        /// the time limit (0 for none).  recorded is the outcome stored in the job and replayed the outcome now.
+        /// Returns false if the job can't be read.
+        /// </summary>
+        public static bool ReplayJob(string jobPath, out JobOutcome recorded, out JobOutcome replayed, out int numFaces,
+                                     double maxSec = 0)
+        {
+            int rc = Environment.Is64BitProcess ?
+                UVAtlasJobReplay64(jobPath, maxSec, out numFaces, out recorded, out replayed) :
+                UVAtlasJobReplay32(jobPath, maxSec, out numFaces, out recorded, out replayed);
+            return rc == 0;
+        }
+
+        /// <summary>
+        /// Creates a native context that owns scratch memory reused across atlas calls.
+        /// Create one per worker thread and release it with DestroyContext().
+        /// </summary>
+        public static IntPtr CreateContext()
+        {
+            IntPtr context = Environment.Is64BitProcess ? UVAtlasContextCreate64() : UVAtlasContextCreate32();
+            if (context == IntPtr.Zero)
+            {
+                throw new OutOfMemoryException("failed to create UVAtlas context");
+            }
+            return context;
+        }
+
+        /// <summary>
+        /// Releases a context returned by CreateContext(), including any result it still holds.
+        /// </summary>
+        public static void DestroyContext(IntPtr context)
+        {
+            if (context == IntPtr.Zero)
+            {
+                return;
+            }
+            if (Environment.Is64BitProcess)
+            {
+                UVAtlasContextDestroy64(context);
+            }
+            else
+            {
+                UVAtlasContextDestroy32(context);
+            }
+        }
+
+        /// <summary>
+        /// Same as CreateResult() but using the scratch memory of a context from CreateContext().
+        /// The result is owned by the context and stays valid until the next call on it, so it must NOT be passed to
+        /// DestroyResult().
+        /// </summary>
+        public static unsafe ReturnCode ContextAtlas(
+            IntPtr context,
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out IntPtr result,
+            int maxCharts = 0, float maxStretch = 0.1666f, float gutter = 2, int width = 512, int height = 512, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            AtlasControl control = null)
+        {
+            UVAtlasInput input = MakeInput(positions, positionStride, positionFormat, numVertices, indices, numIndices);
+
+            int rc;
+            using (var nativeControl = new NativeControl(control, perCall: true))
+            {
+                nativeControl.ApplyTopology(ref input);
+                UVAtlasControl nc = nativeControl.Control;
+                if (Environment.Is64BitProcess)
+                {
+                    result = UVAtlasContextAtlas64(context, &input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc, out rc);
+                }
+                else
+                {
+                    result = UVAtlasContextAtlas32(context, &input, maxCharts, maxStretch, gutter, width, height, quality, adjacencyEpsilon, &nc, out rc);
+                }
+            }
+            ReturnCode returnCode = (ReturnCode)rc;
+            if (result == IntPtr.Zero && returnCode == ReturnCode.SUCCESS)
+            {
+                returnCode = ReturnCode.UNKNOWN;
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// Same as CreateResult() but tries each strategy in turn until one succeeds, generating adjacency only once.
+        /// Each strategy overrides maxCharts, maxStretch and quality.  Cancellation or timeout stops the ladder.
+        /// If context is not IntPtr.Zero its scratch memory is used and it owns the result, as with ContextAtlas(),
+        /// otherwise release the result with DestroyResult().  strategyIndex is the strategy that succeeded, else -1.
+        /// Results are never cached.
+        /// </summary>
+        public static unsafe ReturnCode CreateResultLadder(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            Strategy[] strategies, out IntPtr result, out int strategyIndex,
+            float gutter = 2, int width = 512, int height = 512, float adjacencyEpsilon = 0,
+            IntPtr context = default(IntPtr), AtlasControl control = null)
+        {
+            UVAtlasInput input = MakeInput(positions, positionStride, positionFormat, numVertices, indices, numIndices);
+
+            int rc;
+            using (var nativeControl = new NativeControl(control, perCall: true))
+            {
+                nativeControl.ApplyTopology(ref input);
+                UVAtlasControl nc = nativeControl.Control;
+                fixed (Strategy* pStrategies = strategies)
+                {
+                    UInt32 numStrategies = strategies != null ? (UInt32)strategies.Length : 0;
+                    if (Environment.Is64BitProcess)
+                    {
+                        result = context != IntPtr.Zero ?
+                            UVAtlasContextAtlasLadder64(context, &input, pStrategies, numStrategies, gutter, width, height, adjacencyEpsilon, &nc, out strategyIndex, out rc) :
+                            UVAtlasResultCreateLadder64(&input, pStrategies, numStrategies, gutter, width, height, adjacencyEpsilon, &nc, out strategyIndex, out rc);
+                    }
+                    else
+                    {
+                        result = context != IntPtr.Zero ?
+                            UVAtlasContextAtlasLadder32(context, &input, pStrategies, numStrategies, gutter, width, height, adjacencyEpsilon, &nc, out strategyIndex, out rc) :
+                            UVAtlasResultCreateLadder32(&input, pStrategies, numStrategies, gutter, width, height, adjacencyEpsilon, &nc, out strategyIndex, out rc);
+                    }
+                }
+            }
+            ReturnCode returnCode = (ReturnCode)rc;
+            if (result == IntPtr.Zero && returnCode == ReturnCode.SUCCESS)
+            {
+                returnCode = ReturnCode.UNKNOWN;
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// Number of output vertices (length of the u, v and vertex remap arrays) and output indices in a result.
+        /// </summary>
+        public static unsafe void GetResultSize(IntPtr result, out int numVertices, out int numIndices)
+        {
+            UInt32 nv, nf;
+            if (Environment.Is64BitProcess)
+            {
+                UVAtlasResultGetSize64(result, out nv, out nf);
+            }
+            else
+            {
+                UVAtlasResultGetSize32(result, out nv, out nf);
+            }
+            numVertices = (int)nv;
+            numIndices = (int)nf * 3;
+        }
+
+        /// <summary>
+        /// Fills caller allocated arrays from a result in a single native pass.
+        /// Arrays may be longer than the sizes reported by GetResultSize(), and any of them may be null to skip it.
+        /// </summary>
+        public static unsafe void CopyResult(IntPtr result, float[] outU, float[] outV, int[] outIndices, int[] outVertexRemap)
+        {
+            int numVertices, numIndices;
+            GetResultSize(result, out numVertices, out numIndices);
+            if ((outU != null && outU.Length < numVertices) || (outV != null && outV.Length < numVertices) ||
+                (outVertexRemap != null && outVertexRemap.Length < numVertices) ||
+                (outIndices != null && outIndices.Length < numIndices))
+            {
+                throw new ArgumentException("Atlas output array too small for result");
+            }
+            fixed (float* us = outU, vs = outV)
+            {
+                fixed (int* indices = outIndices, vertexRemap = outVertexRemap)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        UVAtlasResultCopy64(result, us, vs, indices, vertexRemap);
+                    }
+                    else
+                    {
+                        UVAtlasResultCopy32(result, us, vs, indices, vertexRemap);
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Narrowest index format that can hold the indices of a result, R16_UINT unless it has 65535 or more vertices.
+        /// </summary>
+        public static IndexFormat GetResultIndexFormat(IntPtr result)
+        {
+            return Environment.Is64BitProcess ? UVAtlasResultGetIndexFormat64(result) : UVAtlasResultGetIndexFormat32(result);
+        }
+
+        /// <summary>
+        /// Fills a caller allocated array with the 16 bit indices of a result, narrowed natively.
+        /// Returns false without copying anything if GetResultIndexFormat() is not R16_UINT.
+        /// </summary>
+        public static unsafe bool CopyResultIndices(IntPtr result, ushort[] outIndices)
+        {
+            int numVertices, numIndices;
+            GetResultSize(result, out numVertices, out numIndices);
+            if (outIndices == null || outIndices.Length < numIndices)
+            {
+                throw new ArgumentException("Atlas output array too small for result");
+            }
+            fixed (ushort* indices = outIndices)
+            {
+                int rc = Environment.Is64BitProcess ?
+                    UVAtlasResultCopyIndices64(result, IndexFormat.R16_UINT, indices) :
+                    UVAtlasResultCopyIndices32(result, IndexFormat.R16_UINT, indices);
+                return rc == 0;
+            }
+        }
+
+        /// <summary>
+        /// Expands per-vertex input attributes through the vertex remap of a result in a single native pass, so that
+        /// output meshes can be built from flat arrays instead of copying input vertices one at a time.
+        /// </summary>
+        public static unsafe void ExpandResult(IntPtr result, params AttributeStream[] streams)
+        {
+            int numVertices, numIndices;
+            GetResultSize(result, out numVertices, out numIndices);
+            var native = new UVAtlasStream[streams.Length];
+            var handles = new List<GCHandle>();
+            try
+            {
+                for (int i = 0; i < streams.Length; i++)
+                {
+                    var stream = streams[i];
+                    var type = stream.Input != null ? stream.Input.GetType().GetElementType() : null;
+                    if (type == null || !type.IsPrimitive || stream.ComponentsPerVertex < 1 ||
+                        stream.Input.Length % stream.ComponentsPerVertex != 0)
+                    {
+                        throw new ArgumentException("Atlas attribute stream must be a primitive array with whole vertices");
+                    }
+                    int outLength = numVertices * stream.ComponentsPerVertex;
+                    if (stream.Output == null)
+                    {
+                        stream.Output = Array.CreateInstance(type, outLength);
+                    }
+                    else if (stream.Output.GetType().GetElementType() != type || stream.Output.Length < outLength)
+                    {
+                        throw new ArgumentException("Atlas attribute output array too small for result");
+                    }
+                    var input = GCHandle.Alloc(stream.Input, GCHandleType.Pinned);
+                    handles.Add(input);
+                    var output = GCHandle.Alloc(stream.Output, GCHandleType.Pinned);
+                    handles.Add(output);
+                    native[i].input = input.AddrOfPinnedObject();
+                    native[i].output = output.AddrOfPinnedObject();
+                    native[i].elementSize = (UInt32)(Marshal.SizeOf(type) * stream.ComponentsPerVertex);
+                    native[i].numElements = (UInt32)(stream.Input.Length / stream.ComponentsPerVertex);
+                }
+                int rc;
+                fixed (UVAtlasStream* ns = native)
+                {
+                    rc = Environment.Is64BitProcess ?
+                        UVAtlasResultExpand64(result, ns, (UInt32)native.Length) :
+                        UVAtlasResultExpand32(result, ns, (UInt32)native.Length);
+                }
+                if (rc != 0)
+                {
+                    throw new ArgumentException("Atlas attribute stream has fewer vertices than the atlas input");
+                }
+            }
+            finally
+            {
+                foreach (var handle in handles)
+                {
+                    handle.Free();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Stretch and number of charts of a result, and optionally the chart id of each of its faces.
+        /// outFacePartitioning may be null to skip it, otherwise it must hold at least numIndices / 3 elements.
+        /// </summary>
+        public static unsafe void GetResultCharts(IntPtr result, out float stretch, out int numCharts,
+                                                  int[] outFacePartitioning = null)
+        {
+            int numVertices, numIndices;
+            GetResultSize(result, out numVertices, out numIndices);
+            if (outFacePartitioning != null && outFacePartitioning.Length < numIndices / 3)
+            {
+                throw new ArgumentException("Atlas output array too small for result");
+            }
+            UInt32 nc;
+            fixed (int* facePartitioning = outFacePartitioning)
+            {
+                if (Environment.Is64BitProcess)
+                {
+                    UVAtlasResultGetCharts64(result, out stretch, out nc, facePartitioning);
+                }
+                else
+                {
+                    UVAtlasResultGetCharts32(result, out stretch, out nc, facePartitioning);
+                }
+            }
+            numCharts = (int)nc;
+        }
+
+        /// <summary>
+        /// Releases a result returned by CreateResult().
+        /// </summary>
+        public static void DestroyResult(IntPtr result)
+        {
+            if (result == IntPtr.Zero)
+            {
+                return;
+            }
+            if (Environment.Is64BitProcess)
+            {
+                UVAtlasResultDestroy64(result);
+            }
+            else
+            {
+                UVAtlasResultDestroy32(result);
+            }
+        }
+
+        /// <summary>
+        /// Partitions a mesh into charts without packing them, so that the expensive partition can be packed any number
+        /// of times at different resolutions and gutters with PackCharts().  The input is only read during this call.
+        /// On failure charts is IntPtr.Zero, otherwise release it with DestroyCharts().
+        /// </summary>
+        /// <remarks>Parameters are the same as the raw pointer overload of Atlas().</remarks>
+        public static unsafe ReturnCode CreateCharts(
+            IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices, IntPtr indices, int numIndices,
+            out IntPtr charts,
+            int maxCharts = 0, float maxStretch = 0.1666f, Quality quality = Quality.UVATLAS_DEFAULT, float adjacencyEpsilon = 0,
+            AtlasControl control = null)
+        {
+            UVAtlasInput input = MakeInput(positions, positionStride, positionFormat, numVertices, indices, numIndices);
+
+            int rc;
+            using (var nativeControl = new NativeControl(control, perCall: true))
+            {
+                nativeControl.ApplyTopology(ref input);
+                UVAtlasControl nc = nativeControl.Control;
+                if (Environment.Is64BitProcess)
+                {
+                    charts = UVAtlasChartsCreate64(&input, maxCharts, maxStretch, quality, adjacencyEpsilon, &nc, out rc);
+                }
+                else
+                {
+                    charts = UVAtlasChartsCreate32(&input, maxCharts, maxStretch, quality, adjacencyEpsilon, &nc, out rc);
+                }
+            }
+            ReturnCode returnCode = (ReturnCode)rc;
+            if (charts == IntPtr.Zero && returnCode == ReturnCode.SUCCESS)
+            {
+                returnCode = ReturnCode.UNKNOWN;
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// Packs charts from CreateCharts() into a new result, to be read with GetResultSize() and CopyResult() and
+        /// released with DestroyResult().  The charts are not modified, so they may be packed concurrently.
+        /// </summary>
+        public static unsafe ReturnCode PackCharts(IntPtr charts, out IntPtr result,
+                                                   float gutter = 2, int width = 512, int height = 512,
+                                                   AtlasControl control = null)
+        {
+            int rc;
+            using (var nativeControl = new NativeControl(control, perCall: true))
+            {
+                UVAtlasControl nc = nativeControl.Control;
+                if (Environment.Is64BitProcess)
+                {
+                    result = UVAtlasChartsPack64(charts, gutter, width, height, &nc, out rc);
+                }
+                else
+                {
+                    result = UVAtlasChartsPack32(charts, gutter, width, height, &nc, out rc);
+                }
+            }
+            ReturnCode returnCode = (ReturnCode)rc;
+            if (result == IntPtr.Zero && returnCode == ReturnCode.SUCCESS)
+            {
+                returnCode = ReturnCode.UNKNOWN;
+            }
+            return returnCode;
+        }
+
+        /// <summary>
+        /// Releases charts returned by CreateCharts().
+        /// </summary>
+        public static void DestroyCharts(IntPtr charts)
+        {
+            if (charts == IntPtr.Zero)
+            {
+                return;
+            }
+            if (Environment.Is64BitProcess)
+            {
+                UVAtlasChartsDestroy64(charts);
+            }
+            else
+            {
+                UVAtlasChartsDestroy32(charts);
+            }
+        }
+
+        /// <summary>
+        /// Atlases many meshes in one native call on a work stealing pool of up to maxThreads threads
+        /// (0 for one per core).  Each native worker reuses its own scratch memory across meshes.
+        /// onDone is invoked as each mesh finishes, from the native worker threads and possibly concurrently, so it
+        /// must be thread safe.  If it throws, the remaining meshes are still atlased but their results are dropped,
+        /// and the first exception is rethrown when the batch completes.
+        /// Each mesh is limited to control.MaxSec (0 for no limit), and once control.Cancel is cancelled the running
+        /// meshes stop and the remaining ones are reported as CANCELLED without being atlased.
+        /// Returns the number of meshes that were atlased successfully.
+        /// </summary>
+        public static unsafe int AtlasBatch(IList<BatchMesh> meshes, BatchMeshDone onDone, int maxThreads = 0,
+                                            AtlasControl control = null)
+        {
+            var items = new UVAtlasBatchItem[meshes.Count];
+            var pins = new List<GCHandle>(2 * meshes.Count);
+            Exception error = null;
+            UVAtlasBatchCallback callback = (index, rc, result, userData) =>
+            {
+                if (error != null)
+                {
+                    return;
+                }
+                try
+                {
+                    float[] outU = null, outV = null;
+                    int[] outIndices = null, outVertexRemap = null;
+                    if (result != IntPtr.Zero)
+                    {
+                        int numOutVertices, numOutIndices;
+                        GetResultSize(result, out numOutVertices, out numOutIndices);
+                        outU = new float[numOutVertices];
+                        outV = new float[numOutVertices];
+                        outIndices = new int[numOutIndices];
+                        outVertexRemap = new int[numOutVertices];
+                        CopyResult(result, outU, outV, outIndices, outVertexRemap);
+                        if (meshes[(int)index].Attributes != null)
+                        {
+                            ExpandResult(result, meshes[(int)index].Attributes);
+                        }
+                    }
+                    onDone((int)index, (ReturnCode)rc, outU, outV, outIndices, outVertexRemap);
+                }
+                catch (Exception ex)
+                {
+                    //exceptions must not propagate into native code
+                    Interlocked.CompareExchange(ref error, ex, null);
+                }
+            };
+            int numSucceeded = 0;
+            try
+            {
+                for (int i = 0; i < meshes.Count; i++)
+                {
+                    var mesh = meshes[i];
+                    //double positions are narrowed natively, saving a float copy of every mesh
+                    Array positionArray = mesh.DoublePositions != null ? (Array)mesh.DoublePositions : mesh.Positions;
+                    PositionFormat positionFormat = mesh.DoublePositions != null ?
+                        PositionFormat.DOUBLE3 : PositionFormat.FLOAT3;
+                    if (positionArray.Length % 3 != 0)
+                    {
+                        throw new ArgumentException("Atlas input positions not divisible by 3");
+                    }
+                    var positions = GCHandle.Alloc(positionArray, GCHandleType.Pinned);
+                    pins.Add(positions);
+                    var indices = GCHandle.Alloc(mesh.Indices, GCHandleType.Pinned);
+                    pins.Add(indices);
+                    items[i].input = MakeInput(positions.AddrOfPinnedObject(), 0, positionFormat,
+                                               positionArray.Length / 3, indices.AddrOfPinnedObject(),
+                                               mesh.Indices.Length);
+                    items[i].input.welded = mesh.Welded ? 1u : 0u;
+                    if (mesh.Adjacency != null)
+                    {
+                        if (mesh.Adjacency.Length != mesh.Indices.Length)
+                        {
+                            throw new ArgumentException("Atlas input adjacency must have 3 entries per face");
+                        }
+                        var adjacency = GCHandle.Alloc(mesh.Adjacency, GCHandleType.Pinned);
+                        pins.Add(adjacency);
+                        items[i].input.adjacency = adjacency.AddrOfPinnedObject();
+                    }
+                    items[i].maxCharts = mesh.MaxCharts;
+                    items[i].maxStretch = mesh.MaxStretch;
+                    items[i].gutter = mesh.Gutter;
+                    items[i].width = mesh.Width;
+                    items[i].height = mesh.Height;
+                    items[i].quality = mesh.Quality;
+                    items[i].adjacencyEpsilon = mesh.AdjacencyEpsilon;
+                }
+                using (var nativeControl = new NativeControl(control, perCall: false))
+                {
+                    UVAtlasControl nc = nativeControl.Control;
+                    fixed (UVAtlasBatchItem* pItems = items)
+                    {
+                        if (Environment.Is64BitProcess)
+                        {
+                            numSucceeded = UVAtlasBatch64(pItems, (UInt32)items.Length, maxThreads, callback, IntPtr.Zero, &nc);
+                        }
+                        else
+                        {
+                            numSucceeded = UVAtlasBatch32(pItems, (UInt32)items.Length, maxThreads, callback, IntPtr.Zero, &nc);
+                        }
+                    }
+                }
+                GC.KeepAlive(callback);
+            }
+            finally
+            {
+                foreach (var pin in pins)
+                {
+                    pin.Free();
+                }
+            }
+            if (error != null)
+            {
+                throw error;
+            }
+            return numSucceeded;
+        }
+
+        /// <summary>
+        /// Bakes textures from a fixed set of source meshes onto any number of destination meshes, see CreateBaker().
+        /// The source images stay pinned until the baker is disposed.
+        /// </summary>
+        public sealed class Baker : IDisposable
+        {
+            private IntPtr baker;
+            private List<GCHandle> pins;
+
+            internal Baker(IntPtr baker, List<GCHandle> pins)
+            {
+                this.baker = baker;
+                this.pins = pins;
+            }
+
+            ~Baker()
+            {
+                Release();
+            }
+
+            public void Dispose()
+            {
+                Release();
+                GC.SuppressFinalize(this);
+            }
+
+            /// <summary>
+            /// Fills each texel of image whose uv, taken at the texel corner as Image.PixelToUV() does, lies in a dest
+            /// triangle with the bicubic sample of the source texture at the source point closest to the dest point.
+            /// If index is not null it is filled likewise with nearest samples of the source indices.  If any source
+            /// lacks an index with at least as many bands, or index differs in size from image, image is still baked
+            /// but index is left untouched and NO_INDEX is returned instead of SUCCESS.
+            /// coverage, if not null, gets Width * Height entries set to 1 for baked texels and 0 for others, which are
+            /// left untouched in image and index.
+            /// Rows are baked in bands on up to maxThreads threads (0 for one per core).
+            /// </summary>
+            public unsafe ReturnCode Bake(BakeMesh dest, BakeImage image, BakeImage index = null, byte[] coverage = null,
+                                          int maxThreads = 0)
+            {
+                if (baker == IntPtr.Zero)
+                {
+                    throw new ObjectDisposedException("Baker");
+                }
+                if (coverage != null && coverage.Length != image.Width * image.Height)
+                {
+                    throw new ArgumentException("Bake coverage must have one entry per texel");
+                }
+                var destPins = new List<GCHandle>();
+                try
+                {
+                    UVAtlasBakeMesh nativeDest = PinBakeMesh(dest, destPins);
+                    UVAtlasImage nativeImage = PinBakeImage(image, destPins);
+                    UVAtlasImage nativeIndex = index != null ? PinBakeImage(index, destPins) : new UVAtlasImage();
+                    int returnCode;
+                    fixed (byte* pCoverage = coverage)
+                    {
+                        UVAtlasImage* pIndex = index != null ? &nativeIndex : null;
+                        if (Environment.Is64BitProcess)
+                        {
+                            returnCode = UVAtlasBakerBake64(baker, &nativeDest, &nativeImage, pIndex, pCoverage, maxThreads);
+                        }
+                        else
+                        {
+                            returnCode = UVAtlasBakerBake32(baker, &nativeDest, &nativeImage, pIndex, pCoverage, maxThreads);
+                        }
+                    }
+                    return (ReturnCode)returnCode;
+                }
+                finally
+                {
+                    foreach (var pin in destPins)
+                    {
+                        pin.Free();
+                    }
+                }
+            }
+
+            private void Release()
+            {
+                if (baker != IntPtr.Zero)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        UVAtlasBakerDestroy64(baker);
+                    }
+                    else
+                    {
+                        UVAtlasBakerDestroy32(baker);
+                    }
+                    baker = IntPtr.Zero;
+                }
+                if (pins != null)
+                {
+                    foreach (var pin in pins)
+                    {
+                        pin.Free();
+                    }
+                    pins = null;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Builds a native BVH over the triangles of the sources, which must all have UVs and the same number of image
+        /// bands, for Baker.Bake().  The source meshes are only read during this call.
+        /// On failure baker is null, otherwise dispose it when done.
+        /// </summary>
+        public static unsafe ReturnCode CreateBaker(IList<BakeSource> sources, out Baker baker)
+        {
+            baker = null;
+            var meshPins = new List<GCHandle>();
+            var imagePins = new List<GCHandle>();
+            try
+            {
+                var nativeSources = new UVAtlasBakeSource[sources.Count];
+                for (int i = 0; i < sources.Count; i++)
+                {
+                    nativeSources[i].mesh = PinBakeMesh(sources[i].Mesh, meshPins);
+                    nativeSources[i].image = PinBakeImage(sources[i].Image, imagePins);
+                    if (sources[i].Index != null)
+                    {
+                        nativeSources[i].index = PinBakeImage(sources[i].Index, imagePins);
+                    }
+                }
+                IntPtr nativeBaker;
+                int returnCode;
+                fixed (UVAtlasBakeSource* pSources = nativeSources)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        nativeBaker = UVAtlasBakerCreate64(pSources, (UInt32)nativeSources.Length, out returnCode);
+                    }
+                    else
+                    {
+                        nativeBaker = UVAtlasBakerCreate32(pSources, (UInt32)nativeSources.Length, out returnCode);
+                    }
+                }
+                if (nativeBaker != IntPtr.Zero)
+                {
+                    baker = new Baker(nativeBaker, imagePins);
+                    imagePins = null;
+                }
+                return (ReturnCode)returnCode;
+            }
+            finally
+            {
+                foreach (var pin in meshPins.Concat(imagePins ?? Enumerable.Empty<GCHandle>()))
+                {
+                    pin.Free();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Pads charts into the gutter in place: every texel not set in coverage whose nearest covered texel is within
+        /// radius texels (Euclidean, negative for unlimited) is copied from that texel in all bands of all images, which
+        /// must have the same size, and is then set in coverage.  Typically coverage comes from Baker.Bake().
+        /// Uses up to maxThreads threads (0 for one per core).
+        /// </summary>
+        public static unsafe ReturnCode Dilate(IList<BakeImage> images, byte[] coverage, int radius, int maxThreads = 0)
+        {
+            if (images.Count == 0 || coverage.Length != images[0].Width * images[0].Height)
+            {
+                throw new ArgumentException("Dilate coverage must have one entry per texel");
+            }
+            var pins = new List<GCHandle>();
+            try
+            {
+                var nativeImages = images.Select(image => PinBakeImage(image, pins)).ToArray();
+                fixed (UVAtlasImage* pImages = nativeImages)
+                fixed (byte* pCoverage = coverage)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        return (ReturnCode)UVAtlasDilate64(pImages, (UInt32)nativeImages.Length, pCoverage, radius, maxThreads);
+                    }
+                    else
+                    {
+                        return (ReturnCode)UVAtlasDilate32(pImages, (UInt32)nativeImages.Length, pCoverage, radius, maxThreads);
+                    }
+                }
+            }
+            finally
+            {
+                foreach (var pin in pins)
+                {
+                    pin.Free();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Rasterizes the uvs of mesh into a width x height texture, finding the face covering each texel center along
+        /// with its barycentric coordinates and the 3D point there.  Samples are in row major order, pixels holding
+        /// row * width + col, with 3 barycentrics and 3 point coordinates per sample.  Texels on an edge shared by
+        /// several faces go to the first of them.
+        /// If fraction is in (0, 1) only every 1/fraction-th sample is kept, which spreads the subsample evenly over the
+        /// covered texels and always picks the same ones.
+        /// Uses up to maxThreads threads (0 for one per core).
+        /// </summary>
+        public static unsafe ReturnCode SampleUVs(BakeMesh mesh, int width, int height, out int[] pixels, out int[] faces,
+                                                  out double[] barycentrics, out double[] points, double fraction = 1,
+                                                  int maxThreads = 0)
+        {
+            pixels = null;
+            faces = null;
+            barycentrics = null;
+            points = null;
+            if (width <= 0 || height <= 0)
+            {
+                throw new ArgumentException("SampleUVs width and height must be positive");
+            }
+            var pins = new List<GCHandle>();
+            IntPtr samples = IntPtr.Zero;
+            try
+            {
+                var nativeMesh = PinBakeMesh(mesh, pins);
+                int returnCode;
+                if (Environment.Is64BitProcess)
+                {
+                    samples = UVAtlasSamplesCreate64(&nativeMesh, (UInt32)width, (UInt32)height, fraction, maxThreads, out returnCode);
+                }
+                else
+                {
+                    samples = UVAtlasSamplesCreate32(&nativeMesh, (UInt32)width, (UInt32)height, fraction, maxThreads, out returnCode);
+                }
+                if (samples == IntPtr.Zero)
+                {
+                    return (ReturnCode)returnCode;
+                }
+                int count = (int)(Environment.Is64BitProcess ? UVAtlasSamplesGetCount64(samples) : UVAtlasSamplesGetCount32(samples));
+                pixels = new int[count];
+                faces = new int[count];
+                barycentrics = new double[3 * count];
+                points = new double[3 * count];
+                fixed (int* pPixels = pixels)
+                fixed (int* pFaces = faces)
+                fixed (double* pBarycentrics = barycentrics)
+                fixed (double* pPoints = points)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        UVAtlasSamplesCopy64(samples, pPixels, pFaces, pBarycentrics, pPoints);
+                    }
+                    else
+                    {
+                        UVAtlasSamplesCopy32(samples, pPixels, pFaces, pBarycentrics, pPoints);
+                    }
+                }
+                return (ReturnCode)returnCode;
+            }
+            finally
+            {
+                if (samples != IntPtr.Zero)
+                {
+                    if (Environment.Is64BitProcess)
+                    {
+                        UVAtlasSamplesDestroy64(samples);
+                    }
+                    else
+                    {
+                        UVAtlasSamplesDestroy32(samples);
+                    }
+                }
+                foreach (var pin in pins)
+                {
+                    pin.Free();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Gathers uv bounds, 3D, uv and texel areas, the face area range and stretch of mesh in one native pass, with
+        /// texel space being uv scaled by width and height and flipped in v as by Image.UVToPixel(), or uv itself if
+        /// either is 0.
+        /// If rescale is not null mesh.UVs are first remapped in place, unless they already fit per its growThreshold,
+        /// and the stats are of the remapped uvs.
+        /// If histogram is not null it gets the 3D area of faces binned by texel density, in texels per unit length,
+        /// evenly in log2 from minDensity to maxDensity, clamped at both ends.
+        /// If faceStretch is not null it gets the largest and smallest stretch of each face.
+        /// Uses up to maxThreads threads (0 for one per core).
+        /// </summary>
+        public static unsafe ReturnCode ComputeUVStats(BakeMesh mesh, int width, int height, out UVStats stats,
+                                                       UVRescale? rescale = null, double[] histogram = null,
+                                                       double minDensity = 0, double maxDensity = 0,
+                                                       double[] faceStretch = null, int maxThreads = 0)
+        {
+            stats = new UVStats();
+            if (faceStretch != null && faceStretch.Length != 2 * (mesh.Indices.Length / 3))
+            {
+                throw new ArgumentException("ComputeUVStats faceStretch must have two entries per face");
+            }
+            var pins = new List<GCHandle>();
+            try
+            {
+                var nativeMesh = PinBakeMesh(mesh, pins);
+                var nativeRescale = rescale ?? new UVRescale();
+                var nativeHistogram = new UVAtlasUVHistogram();
+                if (histogram != null)
+                {
+                    var bins = GCHandle.Alloc(histogram, GCHandleType.Pinned);
+                    pins.Add(bins);
+                    nativeHistogram.bins = bins.AddrOfPinnedObject();
+                    nativeHistogram.numBins = (UInt32)histogram.Length;
+                    nativeHistogram.minDensity = minDensity;
+                    nativeHistogram.maxDensity = maxDensity;
+                }
+                UVStats nativeStats;
+                fixed (double* pFaceStretch = faceStretch)
+                {
+                    var pRescale = rescale.HasValue ? &nativeRescale : null;
+                    var pUVs = rescale.HasValue ? (double*)nativeMesh.uvs : null;
+                    var pHistogram = histogram != null ? &nativeHistogram : null;
+                    int returnCode;
+                    if (Environment.Is64BitProcess)
+                    {
+                        returnCode = UVAtlasUVStatsCompute64(&nativeMesh, (UInt32)width, (UInt32)height, pRescale, pUVs,
+                                                             pHistogram, pFaceStretch, &nativeStats, maxThreads);
+                    }
+                    else
+                    {
+                        returnCode = UVAtlasUVStatsCompute32(&nativeMesh, (UInt32)width, (UInt32)height, pRescale, pUVs,
+                                                             pHistogram, pFaceStretch, &nativeStats, maxThreads);
+                    }
+                    if (returnCode == 0)
+                    {
+                        stats = nativeStats;
+                    }
+                    return (ReturnCode)returnCode;
+                }
+            }
+            finally
+            {
+                foreach (var pin in pins)
+                {
+                    pin.Free();
+                }
+            }
+        }
+
+        private static UVAtlasBakeMesh PinBakeMesh(BakeMesh mesh, List<GCHandle> pins)
+        {
+            if (mesh.Positions.Length % 3 != 0 || mesh.UVs.Length != 2 * (mesh.Positions.Length / 3))
+            {
+                throw new ArgumentException("Bake mesh must have 3 positions and 2 uvs per vertex");
+            }
+            if (mesh.Indices.Length % 3 != 0)
+            {
+                throw new ArgumentException("Bake mesh indices not divisible by 3");
+            }
+            var positions = GCHandle.Alloc(mesh.Positions, GCHandleType.Pinned);
+            pins.Add(positions);
+            var uvs = GCHandle.Alloc(mesh.UVs, GCHandleType.Pinned);
+            pins.Add(uvs);
+            var indices = GCHandle.Alloc(mesh.Indices, GCHandleType.Pinned);
+            pins.Add(indices);
+            return new UVAtlasBakeMesh
+            {
+                positions = positions.AddrOfPinnedObject(),
+                uvs = uvs.AddrOfPinnedObject(),
+                numVertices = (UInt32)(mesh.Positions.Length / 3),
+                indices = indices.AddrOfPinnedObject(),
+                numFaces = (UInt32)(mesh.Indices.Length / 3)
+            };
+        }
+
+        private static UVAtlasImage PinBakeImage(BakeImage image, List<GCHandle> pins)
+        {
+            var bands = new IntPtr[image.Bands.Length];
+            for (int b = 0; b < bands.Length; b++)
+            {
+                if (image.Bands[b].Length != image.Width * image.Height)
+                {
+                    throw new ArgumentException("Bake image bands must have one entry per texel");
+                }
+                var band = GCHandle.Alloc(image.Bands[b], GCHandleType.Pinned);
+                pins.Add(band);
+                bands[b] = band.AddrOfPinnedObject();
+            }
+            var table = GCHandle.Alloc(bands, GCHandleType.Pinned);
+            pins.Add(table);
+            return new UVAtlasImage
+            {
+                bands = table.AddrOfPinnedObject(),
+                numBands = (UInt32)bands.Length,
+                width = (UInt32)image.Width,
+                height = (UInt32)image.Height
+            };
+        }
+
+        /// <summary>
+        /// Native view of an AtlasControl, valid until disposed.
+        /// The cache and capture directories are copied to unmanaged UTF-16 strings and the adjacency is pinned.
+        /// The cancellation token maps to an unmanaged int that is set to 1 when the token is cancelled.
+        /// Progress and phase stats are only wired up for single (perCall) atlas calls.
+        /// </summary>
+        private sealed class NativeControl : IDisposable
+        {
+            public UVAtlasControl Control;
+
+            private CancellationTokenRegistration registration;
+            private GCHandle phases;
+            private GCHandle adjacency;
+            private AtlasControl perCallControl;
+            private UVAtlasProgressCallback progress;
+            private bool welded;
+
+            public NativeControl(AtlasControl control, bool perCall)
+            {
+                if (control == null)
+                {
+                    return;
+                }
+                Control.maxSec = control.MaxSec;
+                Control.preflight = (UInt32)control.Preflight;
+                Control.optimize = control.Optimize ? 1 : 0;
+                Control.lowMemory = control.LowMemory ? 1 : 0;
+                welded = control.Welded;
+                if (control.Adjacency != null)
+                {
+                    adjacency = GCHandle.Alloc(control.Adjacency, GCHandleType.Pinned);
+                }
+                if (control.Cancel.CanBeCanceled)
+                {
+                    IntPtr flag = Marshal.AllocHGlobal(sizeof(int));
+                    Marshal.WriteInt32(flag, 0);
+                    Control.cancel = flag;
+                    registration = control.Cancel.Register(() => Marshal.WriteInt32(flag, 1));
+                }
+                if (!string.IsNullOrEmpty(control.CacheDir))
+                {
+                    Control.cacheDir = Marshal.StringToHGlobalUni(control.CacheDir);
+                }
+                if (!string.IsNullOrEmpty(control.CaptureDir))
+                {
+                    Control.captureDir = Marshal.StringToHGlobalUni(control.CaptureDir);
+                    Control.capture = (UInt32)control.Capture;
+                    Control.captureSlowSec = control.CaptureSlowSec;
+                    Control.captureSampleRate = control.CaptureSampleRate;
+                }
+                if (perCall)
+                {
+                    phases = GCHandle.Alloc(control.Phases, GCHandleType.Pinned);
+                    Control.phaseStats = phases.AddrOfPinnedObject();
+                    perCallControl = control;
+                    control.PreflightStats = new PreflightStats();
+                    Control.preflightStats = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(PreflightStats)));
+                    Marshal.StructureToPtr(control.PreflightStats, Control.preflightStats, false);
+                    if (control.Progress != null)
+                    {
+                        var handler = control.Progress;
+                        progress = (phase, percentComplete, userData) =>
+                        {
+                            try
+                            {
+                                handler((Phase)phase, percentComplete);
+                            }
+                            catch (Exception)
+                            {
+                                //exceptions must not propagate into native code
+                            }
+                        };
+                        Control.progress = Marshal.GetFunctionPointerForDelegate(progress);
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Passes the known topology, if any, along with the input.
+            /// </summary>
+            public void ApplyTopology(ref UVAtlasInput input)
+            {
+                input.welded = welded ? 1u : 0u;
+                if (adjacency.IsAllocated)
+                {
+                    if (((int[])adjacency.Target).Length != input.numFaces * 3)
+                    {
+                        throw new ArgumentException("Atlas input adjacency must have 3 entries per face");
+                    }
+                    input.adjacency = adjacency.AddrOfPinnedObject();
+                }
+            }
+
+            public void Dispose()
+            {
+                //waits for a concurrently running registration callback, so the flag can't be written after free
+                registration.Dispose();
+                if (Control.cancel != IntPtr.Zero)
+                {
+                    Marshal.FreeHGlobal(Control.cancel);
+                    Control.cancel = IntPtr.Zero;
+                }
+                if (Control.cacheDir != IntPtr.Zero)
+                {
+                    Marshal.FreeHGlobal(Control.cacheDir);
+                    Control.cacheDir = IntPtr.Zero;
+                }
+                if (Control.captureDir != IntPtr.Zero)
+                {
+                    Marshal.FreeHGlobal(Control.captureDir);
+                    Control.captureDir = IntPtr.Zero;
+                }
+                if (Control.preflightStats != IntPtr.Zero)
+                {
+                    perCallControl.PreflightStats =
+                        (PreflightStats)Marshal.PtrToStructure(Control.preflightStats, typeof(PreflightStats));
+                    Marshal.FreeHGlobal(Control.preflightStats);
+                    Control.preflightStats = IntPtr.Zero;
+                }
+                if (phases.IsAllocated)
+                {
+                    phases.Free();
+                }
+                if (adjacency.IsAllocated)
+                {
+                    adjacency.Free();
+                }
+                GC.KeepAlive(progress);
+            }
+        }
+
+        private static UVAtlasInput MakeInput(IntPtr positions, int positionStride, PositionFormat positionFormat, int numVertices,
+                                              IntPtr indices, int numIndices)
+        {
+            if (numIndices % 3 != 0)
+            {
+                throw new ArgumentException("Atlas input indicies not divisible by 3");
+            }
+
+            UVAtlasInput input = new UVAtlasInput();
+            input.positions = positions;
+            input.positionStride = (UInt32)positionStride;
+            input.positionFormat = positionFormat;
+            input.numVertices = (UInt32)numVertices;
+            input.indices = indices;
+            input.numFaces = (UInt32)(numIndices / 3);
+            return input;
+        }
+
+        /// <summary>
+        /// Copies a native result into managed arrays and frees it.
+        /// </summary>
+        private static unsafe ReturnCode TakeResult(UVAtlasData* res, ReturnCode returnCode,
+                                                    out float[] outU, out float[] outV, out int[] outIndices, out int[] outVertexRemap)
+        {
+            outU = null;
+            outV = null;
+            outIndices = null;
+            outVertexRemap = null;
+            if (res == (UVAtlasData*) 0 || returnCode != ReturnCode.SUCCESS)
+            {
+                return returnCode;
+            }
+            outU = new float[res->numVertices];
+            outV = new float[res->numVertices];
+            outIndices = new int[res->numFaces * 3];
+            outVertexRemap = new int[res->numVertices];
+
+            Marshal.Copy(res->us, outU, 0, outU.Length);
+            Marshal.Copy(res->vs, outV, 0, outV.Length);
+            Marshal.Copy(res->indices, outIndices, 0, outIndices.Length);
+            Marshal.Copy(res->vertexRemap, outVertexRemap, 0, outVertexRemap.Length);
+
             if (Environment.Is64BitProcess)
             {
                 UVAtlasDestroy64(res);
@@ -170,4 +2223,3 @@ namespace UVAtlasNET
         }
     }
  }
-                                                                             
\ No newline at end of file